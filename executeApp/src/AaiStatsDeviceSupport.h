@@ -0,0 +1,104 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_AAI_STATS_DEVICE_SUPPORT_H
+#define EPICS_EXEC_AAI_STATS_DEVICE_SUPPORT_H
+
+#include <algorithm>
+#include <stdexcept>
+
+extern "C" {
+#include <aaiRecord.h>
+#include <menuFtype.h>
+} // extern "C"
+
+#include "BaseDeviceSupport.h"
+#include "StatsDeviceSupport.h"
+
+namespace epics {
+namespace execute {
+
+/**
+ * Device support class for aai records reading the durations recorded for a
+ * phase of the command's runs (see RunStatistics).
+ *
+ * The record's value is set to the durations (in seconds) that are currently
+ * in the window, starting with the oldest one. This device support code only
+ * handles record address of type stats.
+ */
+class AaiStatsDeviceSupport : public BaseDeviceSupport<::aaiRecord> {
+
+public:
+
+  /**
+   * Constructor. The parameters are passed to the parent constructor.
+   *
+   * @throws std::invalid_argument if the record's FTVL field is not set to
+   *     DOUBLE or if the metric does not refer to the durations of a phase.
+   */
+  AaiStatsDeviceSupport(::aaiRecord *record, RecordAddress const &address)
+      : BaseDeviceSupport<::aaiRecord>(record, address),
+        metric(StatsMetric::parse(address.getValueName())) {
+    if (record->ftvl != menuFtypeDOUBLE) {
+      throw std::invalid_argument(
+          "The record's FTVL field must be set to DOUBLE.");
+    }
+    if (metric.kind != StatsMetric::Kind::durations) {
+      throw std::invalid_argument(
+          "An aai record can only read the durations of a phase (e.g. \"wall_time\").");
+    }
+  }
+
+  /**
+   * Updates the record's value with the durations of the phase. If there are
+   * more durations than the record can hold, the newest ones are used.
+   */
+  void processRecord() {
+    auto durations = this->getCommand()->getStatistics().getDurations(
+        metric.phase);
+    auto recordBuffer = static_cast<double *>(this->getRecord()->bptr);
+    std::size_t count = std::min<std::size_t>(durations.size(),
+        this->getRecord()->nelm);
+    auto first = durations.end() - count;
+    for (std::size_t i = 0; i < count; ++i) {
+      recordBuffer[i] = first[i].count() / 1e9;
+    }
+    this->getRecord()->nord = count;
+  }
+
+private:
+
+  StatsMetric metric;
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_AAI_STATS_DEVICE_SUPPORT_H
@@ -1,6 +1,6 @@
 /*
- * Copyright 2018-2021 aquenos GmbH.
- * Copyright 2018-2021 Karlsruhe Institute of Technology.
+ * Copyright 2018-2026 aquenos GmbH.
+ * Copyright 2018-2026 Karlsruhe Institute of Technology.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as
@@ -84,8 +84,9 @@ public:
       // null-terminated, so we cannot use std::strlen.
       bufferLength = std::find(buffer, buffer + bufferLength, 0) - buffer;
     }
-    getCommand()->setStdInBuffer(
-        std::vector<char>(buffer, buffer + bufferLength));
+    // The data is copied directly from the record's buffer, so it is only
+    // copied once.
+    getCommand()->setStdInBuffer(buffer, bufferLength);
   }
 
 };
@@ -1,6 +1,6 @@
 /*
- * Copyright 2018-2023 aquenos GmbH.
- * Copyright 2018-2023 Karlsruhe Institute of Technology.
+ * Copyright 2018-2026 aquenos GmbH.
+ * Copyright 2018-2026 Karlsruhe Institute of Technology.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as
@@ -35,6 +35,10 @@
 #include <stdexcept>
 #include <string>
 
+extern "C" {
+#include <dbScan.h>
+} // extern "C"
+
 #include "CommandRegistry.h"
 #include "RecordAddress.h"
 
@@ -73,6 +77,15 @@ public:
    */
   virtual void processRecord() = 0;
 
+  /**
+   * Returns the I/O scan list that triggers processing of the record when the
+   * record's SCAN field is set to "I/O Intr". The default implementation
+   * returns null because most records do not support I/O Intr scanning.
+   */
+  virtual ::IOSCANPVT getIoScanPvt() const {
+    return nullptr;
+  }
+
 protected:
 
   /**
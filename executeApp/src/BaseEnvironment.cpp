@@ -0,0 +1,100 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#include <cstring>
+
+#include "BaseEnvironment.h"
+
+extern "C" {
+extern char **environ;
+}
+
+namespace epics {
+namespace execute {
+
+BaseEnvironment BaseEnvironment::instance;
+
+BaseEnvironment::BaseEnvironment() : lastGeneration(0), mode(Mode::inherit) {
+}
+
+std::shared_ptr<BaseEnvironment::Snapshot const>
+BaseEnvironment::getSnapshot() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!this->snapshot) {
+    this->snapshot = takeSnapshot();
+  }
+  return this->snapshot;
+}
+
+void BaseEnvironment::refresh() {
+  std::lock_guard<std::mutex> lock(mutex);
+  this->snapshot = takeSnapshot();
+}
+
+void BaseEnvironment::setMode(Mode mode,
+    std::vector<std::string> const &names) {
+  std::lock_guard<std::mutex> lock(mutex);
+  this->mode = mode;
+  this->whitelist.clear();
+  if (mode == Mode::whitelist) {
+    this->whitelist.insert(names.begin(), names.end());
+  }
+  this->snapshot = takeSnapshot();
+}
+
+std::shared_ptr<BaseEnvironment::Snapshot const>
+BaseEnvironment::takeSnapshot() {
+  // This method is only called while holding the mutex.
+  auto snapshot = std::make_shared<Snapshot>();
+  snapshot->generation = ++this->lastGeneration;
+  if (this->mode == Mode::empty) {
+    return snapshot;
+  }
+  // The environ variable is an array of pointers to null-terminated strings.
+  // The last entry in this array is the null pointer. Each string has the form
+  // NAME=VALUE. Entries that do not contain an equals sign are not valid, so
+  // we ignore them.
+  for (char **nextEnvironEntry = environ; *nextEnvironEntry;
+      ++nextEnvironEntry) {
+    char const *entry = *nextEnvironEntry;
+    char const *eqSign = std::strchr(entry, '=');
+    if (!eqSign) {
+      continue;
+    }
+    if (this->mode == Mode::whitelist
+        && !this->whitelist.count(std::string(entry, eqSign))) {
+      continue;
+    }
+    snapshot->entries.emplace_back(entry);
+  }
+  return snapshot;
+}
+
+} // namespace execute
+} // namespace epics
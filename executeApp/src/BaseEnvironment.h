@@ -0,0 +1,157 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_BASE_ENVIRONMENT_H
+#define EPICS_EXEC_BASE_ENVIRONMENT_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace epics {
+namespace execute {
+
+/**
+ * Environment that is passed to the commands before applying the environment
+ * variables that have been set for each command.
+ *
+ * Instead of reading this process's environment (the environ variable) each
+ * time a command is run, this class takes a snapshot of the environment and
+ * uses this snapshot until refresh() is called. This is faster (the strings
+ * only have to be copied once) and safer (the environment might be modified
+ * by another thread while it is read, e.g. by epicsEnvSet). By default, the
+ * snapshot is taken when it is needed for the first time. The IOC refreshes
+ * it during iocInit, so that variables set in the startup script are
+ * included.
+ */
+class BaseEnvironment {
+
+public:
+
+  /**
+   * Mode that defines which variables from this process's environment are
+   * included in the snapshot.
+   */
+  enum class Mode {
+
+    /**
+     * Include all variables.
+     */
+    inherit,
+
+    /**
+     * Do not include any variables, so commands only see the variables that
+     * have been set for them explicitly.
+     */
+    empty,
+
+    /**
+     * Only include variables whose names are in the whitelist.
+     */
+    whitelist,
+
+  };
+
+  /**
+   * Snapshot of the environment. A snapshot never changes after it has been
+   * created, so it can be used without holding a lock.
+   */
+  struct Snapshot {
+
+    /**
+     * Entries of the environment in the form "name=value".
+     */
+    std::vector<std::string> entries;
+
+    /**
+     * Generation of the snapshot. Each new snapshot has a generation that is
+     * greater than the generation of all previous snapshots, so code that
+     * caches data derived from a snapshot can compare the generation in
+     * order to detect whether its data is outdated.
+     */
+    std::uint64_t generation;
+
+  };
+
+  /**
+   * Returns the only instance of this class.
+   */
+  inline static BaseEnvironment &getInstance() {
+    return instance;
+  }
+
+  /**
+   * Returns the current snapshot. If no snapshot has been taken yet, a
+   * snapshot is taken first.
+   */
+  std::shared_ptr<Snapshot const> getSnapshot();
+
+  /**
+   * Takes a new snapshot of this process's environment. This method must not
+   * be called while another thread might modify the environment.
+   */
+  void refresh();
+
+  /**
+   * Sets the mode that defines which variables are included in the snapshot
+   * and takes a new snapshot. The names are only used if the mode is
+   * Mode::whitelist.
+   */
+  void setMode(Mode mode,
+      std::vector<std::string> const &names = std::vector<std::string>());
+
+private:
+
+  static BaseEnvironment instance;
+
+  std::uint64_t lastGeneration;
+  Mode mode;
+  std::mutex mutex;
+  std::shared_ptr<Snapshot const> snapshot;
+  std::set<std::string> whitelist;
+
+  // We do not want to allow copy or move construction or assignment.
+  BaseEnvironment(BaseEnvironment const &) = delete;
+  BaseEnvironment(BaseEnvironment &&) = delete;
+  BaseEnvironment &operator=(BaseEnvironment const &) = delete;
+  BaseEnvironment &operator=(BaseEnvironment &&) = delete;
+
+  BaseEnvironment();
+
+  std::shared_ptr<Snapshot const> takeSnapshot();
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_BASE_ENVIRONMENT_H
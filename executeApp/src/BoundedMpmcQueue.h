@@ -0,0 +1,188 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_BOUNDED_MPMC_QUEUE_H
+#define EPICS_EXEC_BOUNDED_MPMC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace epics {
+namespace execute {
+
+/**
+ * Bounded, lock-free queue that may be used by multiple producers and multiple
+ * consumers concurrently.
+ *
+ * The queue is a ring buffer where each cell carries a sequence number that
+ * tells producers and consumers whether the cell is ready to be written or
+ * read (the algorithm is the one described by Dmitry Vyukov). Producers and
+ * consumers only contend on the respective position counter and do not block
+ * each other, and neither pushing nor popping an element allocates memory.
+ *
+ * The element type must be default constructible and move assignable. Moving
+ * an element out of the queue must leave the cell in a state where it does
+ * not hold any resources that should be released (e.g. an empty Task).
+ */
+template<typename T>
+class BoundedMpmcQueue {
+
+public:
+
+  /**
+   * Creates a queue that can hold at least the specified number of elements.
+   * The capacity is rounded up to the next power of two.
+   *
+   * @throws std::invalid_argument if the capacity is zero or too large.
+   */
+  explicit BoundedMpmcQueue(std::size_t capacity)
+      : dequeuePosition(0), enqueuePosition(0) {
+    if (capacity == 0 || capacity > (std::size_t(1) << 30)) {
+      throw std::invalid_argument(
+          "The capacity must be greater than zero and less than 2^30.");
+    }
+    std::size_t roundedCapacity = 1;
+    while (roundedCapacity < capacity) {
+      roundedCapacity <<= 1;
+    }
+    this->cells.reset(new Cell[roundedCapacity]);
+    for (std::size_t i = 0; i < roundedCapacity; ++i) {
+      this->cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    this->mask = roundedCapacity - 1;
+  }
+
+  /**
+   * Returns the number of elements that can be stored in this queue.
+   */
+  std::size_t getCapacity() const noexcept {
+    return this->mask + 1;
+  }
+
+  /**
+   * Removes the oldest element from the queue and moves it into the
+   * specified element. Returns false (without changing the element) if the
+   * queue is empty.
+   */
+  bool tryPop(T &element) noexcept {
+    Cell *cell;
+    auto position = this->dequeuePosition.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &this->cells[position & this->mask];
+      auto sequence = cell->sequence.load(std::memory_order_acquire);
+      auto difference = static_cast<std::intptr_t>(sequence)
+          - static_cast<std::intptr_t>(position + 1);
+      if (difference == 0) {
+        if (this->dequeuePosition.compare_exchange_weak(
+            position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        // The producer has not written to this cell yet, so the queue is
+        // empty.
+        return false;
+      } else {
+        // Another consumer has already taken this cell.
+        position = this->dequeuePosition.load(std::memory_order_relaxed);
+      }
+    }
+    element = std::move(cell->element);
+    // The cell is going to be used again when the enqueue position has
+    // wrapped around.
+    cell->sequence.store(position + this->mask + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Adds an element to the queue. Returns false (without moving from the
+   * element) if the queue is full.
+   */
+  bool tryPush(T &&element) noexcept {
+    Cell *cell;
+    auto position = this->enqueuePosition.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &this->cells[position & this->mask];
+      auto sequence = cell->sequence.load(std::memory_order_acquire);
+      auto difference = static_cast<std::intptr_t>(sequence)
+          - static_cast<std::intptr_t>(position);
+      if (difference == 0) {
+        if (this->enqueuePosition.compare_exchange_weak(
+            position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        // The consumer has not taken the element from the last round yet, so
+        // the queue is full.
+        return false;
+      } else {
+        // Another producer has already taken this cell.
+        position = this->enqueuePosition.load(std::memory_order_relaxed);
+      }
+    }
+    cell->element = std::move(element);
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+
+  // Size of a cache line on the platforms that we care about. We keep the
+  // enqueue and dequeue position in separate cache lines, so that producers
+  // and consumers do not invalidate each other's cache lines.
+  static constexpr std::size_t cacheLineSize = 64;
+
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    T element;
+  };
+
+  std::unique_ptr<Cell[]> cells;
+  std::size_t mask;
+  char padding0[cacheLineSize];
+  std::atomic<std::size_t> dequeuePosition;
+  char padding1[cacheLineSize - sizeof(std::atomic<std::size_t>)];
+  std::atomic<std::size_t> enqueuePosition;
+  char padding2[cacheLineSize - sizeof(std::atomic<std::size_t>)];
+
+  // We do not want to allow copy or move construction and assignment.
+  BoundedMpmcQueue(BoundedMpmcQueue const &) = delete;
+  BoundedMpmcQueue(BoundedMpmcQueue &&) = delete;
+  BoundedMpmcQueue &operator=(BoundedMpmcQueue const &) = delete;
+  BoundedMpmcQueue &operator=(BoundedMpmcQueue &&) = delete;
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_BOUNDED_MPMC_QUEUE_H
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#include <algorithm>
+#include <utility>
+
+#include "BufferPool.h"
+
+namespace epics {
+namespace execute {
+
+BufferPool::BufferPool(std::size_t maxBuffers) : bytes(0),
+    maxBuffers(maxBuffers), peakBytes(0) {
+  // Reserving the space for the buffers ensures that release() never has to
+  // allocate memory (which might throw).
+  this->buffers.reserve(maxBuffers);
+}
+
+std::vector<char> BufferPool::acquire() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (this->buffers.empty()) {
+    return std::vector<char>();
+  }
+  // We take the buffer that was released last, because its memory is the
+  // most likely to still be in the CPU cache.
+  auto buffer = std::move(this->buffers.back());
+  this->buffers.pop_back();
+  this->bytes -= buffer.capacity();
+  return buffer;
+}
+
+BufferPool::Statistics BufferPool::getStatistics() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  Statistics statistics;
+  statistics.buffers = this->buffers.size();
+  statistics.bytes = this->bytes;
+  statistics.peakBytes = this->peakBytes;
+  return statistics;
+}
+
+void BufferPool::release(std::vector<char> &&buffer) noexcept {
+  if (buffer.capacity() == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  // If the pool is full, we do not take the buffer, so it is freed by the
+  // calling code.
+  if (this->buffers.size() >= this->maxBuffers) {
+    return;
+  }
+  // Clearing a vector of char does not free its memory, so it keeps its
+  // capacity.
+  buffer.clear();
+  this->bytes += buffer.capacity();
+  this->peakBytes = std::max(this->peakBytes, this->bytes);
+  this->buffers.push_back(std::move(buffer));
+}
+
+} // namespace execute
+} // namespace epics
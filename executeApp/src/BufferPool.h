@@ -0,0 +1,120 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_BUFFER_POOL_H
+#define EPICS_EXEC_BUFFER_POOL_H
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace epics {
+namespace execute {
+
+/**
+ * Pool of buffers that are used for capturing the output of a command. A
+ * buffer that is returned to the pool keeps its capacity, so the next run
+ * can reuse the memory instead of allocating it again. The pool only keeps a
+ * limited number of buffers. Buffers returned while the pool is full are
+ * freed.
+ *
+ * This class is thread-safe.
+ */
+class BufferPool {
+
+public:
+
+  /**
+   * Memory usage of a pool.
+   */
+  struct Statistics {
+
+    /**
+     * Number of buffers that are currently in the pool.
+     */
+    std::size_t buffers;
+
+    /**
+     * Number of bytes currently held by the buffers in the pool.
+     */
+    std::size_t bytes;
+
+    /**
+     * Maximum number of bytes that have been held by the buffers in the pool
+     * at the same time.
+     */
+    std::size_t peakBytes;
+
+  };
+
+  /**
+   * Creates a pool that keeps up to the specified number of buffers.
+   */
+  BufferPool(std::size_t maxBuffers);
+
+  /**
+   * Takes a buffer from the pool. The returned buffer is empty, but it might
+   * have a capacity that is greater than zero. If the pool is empty, a new
+   * buffer without any capacity is returned.
+   */
+  std::vector<char> acquire();
+
+  /**
+   * Returns memory usage of this pool.
+   */
+  Statistics getStatistics() const;
+
+  /**
+   * Returns a buffer to the pool. Buffers without any capacity are not
+   * added. If the buffer is not added (because it does not have any capacity
+   * or because the pool is full), it is left untouched, so it is freed when
+   * the calling code destroys it.
+   */
+  void release(std::vector<char> &&buffer) noexcept;
+
+private:
+
+  std::vector<std::vector<char>> buffers;
+  std::size_t bytes;
+  std::size_t maxBuffers;
+  mutable std::mutex mutex;
+  std::size_t peakBytes;
+
+  // We do not want to allow copy or move construction and assignment.
+  BufferPool(BufferPool const &) = delete;
+  BufferPool(BufferPool &&) = delete;
+  BufferPool &operator=(BufferPool const &) = delete;
+  BufferPool &operator=(BufferPool &&) = delete;
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_BUFFER_POOL_H
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_CAPTURE_MODE_H
+#define EPICS_EXEC_CAPTURE_MODE_H
+
+namespace epics {
+namespace execute {
+
+/**
+ * Mode that defines how the standard output or standard error output of a
+ * program is captured.
+ */
+enum class CaptureMode {
+
+  /**
+   * The output is read from a pipe while the program is running.
+   */
+  pipe,
+
+  /**
+   * The output is written to an anonymous memory file that is mapped into
+   * memory after the program has terminated. This avoids a context switch for
+   * every 64 KB of output, but the whole output is kept in memory until the
+   * program terminates. The capacity only limits the data that is kept after
+   * that, so the memory used while the program is running is not bounded.
+   * For this reason, this mode cannot be combined with OverflowPolicy::kill.
+   */
+  file,
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_CAPTURE_MODE_H
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+extern "C" {
+#include <signal.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif // __linux__
+}
+
+#include "ChildProcessHandle.h"
+
+namespace epics {
+namespace execute {
+
+ChildProcessHandle::ChildProcessHandle()
+    : pid(-1), pidFd(-1), reaped(false), spawnedByForkServer(false) {
+}
+
+ChildProcessHandle::~ChildProcessHandle() {
+  if (this->pidFd != -1) {
+    ::close(this->pidFd);
+  }
+}
+
+void ChildProcessHandle::kill() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (this->reaped || this->pid == -1) {
+    return;
+  }
+#if defined(__linux__) && defined(SYS_pidfd_send_signal)
+  if (this->pidFd != -1) {
+    ::syscall(SYS_pidfd_send_signal, this->pidFd, SIGKILL, nullptr, 0);
+    return;
+  }
+#endif // defined(__linux__) && defined(SYS_pidfd_send_signal)
+  // The fork server might reap the child process at any time, so its PID
+  // might already refer to a different process.
+  if (this->spawnedByForkServer) {
+    return;
+  }
+  ::kill(this->pid, SIGKILL);
+}
+
+void ChildProcessHandle::markReaped() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->reaped = true;
+  if (this->pidFd != -1) {
+    ::close(this->pidFd);
+    this->pidFd = -1;
+  }
+}
+
+void ChildProcessHandle::setPid(::pid_t pid, bool openPidFd,
+    bool spawnedByForkServer) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->pid = pid;
+  this->spawnedByForkServer = spawnedByForkServer;
+  if (this->reaped || !openPidFd) {
+    return;
+  }
+#if defined(__linux__) && defined(SYS_pidfd_open)
+  this->pidFd = ::syscall(SYS_pidfd_open, pid, 0);
+#endif // defined(__linux__) && defined(SYS_pidfd_open)
+}
+
+} // namespace execute
+} // namespace epics
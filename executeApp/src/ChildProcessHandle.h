@@ -0,0 +1,120 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_CHILD_PROCESS_HANDLE_H
+#define EPICS_EXEC_CHILD_PROCESS_HANDLE_H
+
+#include <mutex>
+
+extern "C" {
+#include <sys/types.h>
+}
+
+namespace epics {
+namespace execute {
+
+/**
+ * Child process that might have to be killed before it terminates on its own.
+ * Once a child process has been reaped, its PID might be reused by an
+ * unrelated process, so the code reaping the child process has to call
+ * markReaped(), and no signal is sent after that.
+ *
+ * If possible, the signal is sent through a pidfd, which always refers to the
+ * process for which it has been opened, even after that process has been
+ * reaped. If no pidfd is available, the signal is sent to the PID. This is
+ * only safe if this process reaps the child process itself and kill() cannot
+ * run between reaping the child process and calling markReaped(). This is
+ * the case if both happen in the I/O reactor's thread (like for the
+ * ChildReaper) or if markReaped() is called before the child process is
+ * reaped (like when waiting for the child process with WNOWAIT first).
+ *
+ * Child processes that have been created by the fork server are reaped by the
+ * fork server process, so this process cannot know when their PID becomes
+ * invalid. Such a child process is only ever signaled through a pidfd. If the
+ * pidfd cannot be opened (because the kernel does not support pidfds or
+ * because the fork server has already reaped the child process), kill() does
+ * nothing.
+ */
+class ChildProcessHandle {
+
+public:
+
+  /**
+   * Creates a handle that does not refer to any process yet.
+   */
+  ChildProcessHandle();
+
+  /**
+   * Destroys the handle, closing the pidfd if it is still open.
+   */
+  ~ChildProcessHandle();
+
+  /**
+   * Sends SIGKILL to the child process, unless it has already been reaped or
+   * cannot be signaled safely.
+   */
+  void kill();
+
+  /**
+   * Marks the child process as reaped, so that kill() does not send any
+   * signals after this.
+   */
+  void markReaped();
+
+  /**
+   * Sets the PID of the child process. If openPidFd is true, a pidfd is
+   * opened for the process, so that it can be signaled safely. The pidfd
+   * should be opened right after the child process has been created, so
+   * that it is very unlikely that the process has already terminated. If
+   * spawnedByForkServer is true, the process has been created (and is going
+   * to be reaped) by the fork server, so it is never signaled through its
+   * PID.
+   */
+  void setPid(::pid_t pid, bool openPidFd, bool spawnedByForkServer);
+
+private:
+
+  std::mutex mutex;
+  ::pid_t pid;
+  int pidFd;
+  bool reaped;
+  bool spawnedByForkServer;
+
+  // We do not want to allow copy or move construction and assignment.
+  ChildProcessHandle(ChildProcessHandle const&) = delete;
+  ChildProcessHandle(ChildProcessHandle &&) = delete;
+  ChildProcessHandle &operator=(ChildProcessHandle const&) = delete;
+  ChildProcessHandle &operator=(ChildProcessHandle &&) = delete;
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_CHILD_PROCESS_HANDLE_H
@@ -0,0 +1,264 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif // __linux__
+}
+
+#include "ChildReaper.h"
+#include "IoReactor.h"
+#include "fileDescriptors.h"
+
+namespace epics {
+namespace execute {
+
+namespace {
+
+/**
+ * Write end of the pipe that is used by the SIGCHLD handler for waking up the
+ * I/O reactor. This has to be a global variable because it is used from the
+ * signal handler.
+ */
+volatile ::sig_atomic_t signalPipeWriteFd = -1;
+
+/**
+ * Action that was registered for SIGCHLD before the reaper installed its own
+ * handler.
+ */
+struct ::sigaction previousSigChldAction;
+
+void sigChldHandler(int signalNumber, ::siginfo_t *info, void *context) {
+  // The signal handler must not change errno.
+  int savedErrorNumber = errno;
+  char c = 0;
+  // If the pipe is full, the I/O reactor is going to wake up anyway, so we
+  // can ignore errors.
+  if (::write(signalPipeWriteFd, &c, 1)) {
+  }
+  errno = savedErrorNumber;
+  // We call the handler that was registered before (if any), so that we do
+  // not break other code that relies on SIGCHLD.
+  if (previousSigChldAction.sa_flags & SA_SIGINFO) {
+    if (previousSigChldAction.sa_sigaction) {
+      previousSigChldAction.sa_sigaction(signalNumber, info, context);
+    }
+  } else if (previousSigChldAction.sa_handler != SIG_DFL
+      && previousSigChldAction.sa_handler != SIG_IGN) {
+    previousSigChldAction.sa_handler(signalNumber);
+  }
+}
+
+#ifdef __linux__
+
+/**
+ * State of a child process that is watched through a pidfd.
+ */
+struct PidFdWatch {
+  ChildTerminationHandler handler;
+  ::pid_t pid;
+  int pidFd;
+};
+
+void handlePidFdReadable(PidFdWatch &watch) {
+  int waitStatus = 0;
+  auto result = ::waitpid(watch.pid, &waitStatus, WNOHANG);
+  if (result == 0 || (result == -1 && errno == EINTR)) {
+    // The child process has not terminated yet. The pidfd is level-triggered,
+    // so the handler is called again if it becomes readable.
+    return;
+  }
+  std::exception_ptr error;
+  if (result == -1) {
+    error = std::make_exception_ptr(std::system_error(
+        std::error_code(errno, std::system_category()), "waitpid() failed"));
+  }
+  IoReactor::getInstance().removeFd(watch.pidFd);
+  ::close(watch.pidFd);
+  watch.pidFd = -1;
+  watch.handler(waitStatus, error);
+}
+
+#endif // __linux__
+
+} // anonymous namespace
+
+ChildReaper ChildReaper::instance;
+
+ChildReaper::ChildReaper() : pidFdSupported(true), signalPipeReadFd(-1) {
+}
+
+void ChildReaper::watch(::pid_t pid, ChildTerminationHandler handler) {
+  if (watchWithPidFd(pid, handler)) {
+    return;
+  }
+  watchWithSignal(pid, std::move(handler));
+}
+
+void ChildReaper::ensureSignalHandlerInstalled() {
+  // This method is only called while holding the mutex.
+  if (signalPipeReadFd != -1) {
+    return;
+  }
+  int signalPipe[2];
+  createPipe(signalPipe);
+  try {
+    setNonBlocking(signalPipe[0]);
+    setNonBlocking(signalPipe[1]);
+    IoReactor::getInstance().addFd(signalPipe[0], IoReactor::readable,
+        [this, signalPipe]() {
+          char buffer[64];
+          while (::read(signalPipe[0], buffer, sizeof(buffer)) > 0) {
+          }
+          reapSignalWatchedChildren();
+        });
+  } catch (...) {
+    ::close(signalPipe[0]);
+    ::close(signalPipe[1]);
+    throw;
+  }
+  signalPipeWriteFd = signalPipe[1];
+  struct ::sigaction action;
+  std::memset(&action, 0, sizeof(action));
+  action.sa_sigaction = sigChldHandler;
+  action.sa_flags = SA_RESTART | SA_SIGINFO;
+  ::sigemptyset(&action.sa_mask);
+  if (::sigaction(SIGCHLD, &action, &previousSigChldAction)) {
+    std::system_error e(std::error_code(errno, std::system_category()),
+        "sigaction() failed");
+    IoReactor::getInstance().removeFd(signalPipe[0]);
+    ::close(signalPipe[0]);
+    ::close(signalPipe[1]);
+    signalPipeWriteFd = -1;
+    throw e;
+  }
+  signalPipeReadFd = signalPipe[0];
+}
+
+void ChildReaper::reapSignalWatchedChildren() {
+  // We cannot use waitpid(-1, ...), because this would also reap child
+  // processes that are not managed by us, so we check each child process
+  // individually. This is only used when pidfds are not available, so the
+  // linear complexity is acceptable.
+  std::vector<std::pair<ChildTerminationHandler, int>> terminatedChildren;
+  std::vector<std::pair<ChildTerminationHandler, std::exception_ptr>>
+      failedChildren;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto entry = signalWatchedChildren.begin();
+        entry != signalWatchedChildren.end();) {
+      int waitStatus = 0;
+      auto result = ::waitpid(entry->first, &waitStatus, WNOHANG);
+      if (result == entry->first) {
+        terminatedChildren.emplace_back(std::move(entry->second), waitStatus);
+        entry = signalWatchedChildren.erase(entry);
+      } else if (result == -1 && errno != EINTR) {
+        failedChildren.emplace_back(std::move(entry->second),
+            std::make_exception_ptr(std::system_error(
+                std::error_code(errno, std::system_category()),
+                "waitpid() failed")));
+        entry = signalWatchedChildren.erase(entry);
+      } else {
+        ++entry;
+      }
+    }
+  }
+  // We call the handlers without holding the mutex, so that they can start
+  // watching new child processes.
+  for (auto &child : terminatedChildren) {
+    child.first(child.second, std::exception_ptr());
+  }
+  for (auto &child : failedChildren) {
+    child.first(0, child.second);
+  }
+}
+
+bool ChildReaper::watchWithPidFd(::pid_t pid,
+    ChildTerminationHandler &handler) {
+#if defined(__linux__) && defined(SYS_pidfd_open)
+  if (!pidFdSupported.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  // The pidfd always has the close-on-exec flag set.
+  int pidFd = ::syscall(SYS_pidfd_open, pid, 0);
+  if (pidFd == -1) {
+    // If the kernel does not support pidfds, we remember this, so that we do
+    // not have to try again. For other errors (e.g. when the process has
+    // reached the limit for open file descriptors), we only use the fallback
+    // for this child process.
+    if (errno == ENOSYS) {
+      pidFdSupported.store(false, std::memory_order_relaxed);
+    }
+    return false;
+  }
+  auto watch = std::make_shared<PidFdWatch>();
+  watch->handler = std::move(handler);
+  watch->pid = pid;
+  watch->pidFd = pidFd;
+  try {
+    IoReactor::getInstance().addFd(pidFd, IoReactor::readable,
+        [watch]() {handlePidFdReadable(*watch);});
+  } catch (...) {
+    ::close(pidFd);
+    handler = std::move(watch->handler);
+    return false;
+  }
+  return true;
+#else
+  (void) pid;
+  (void) handler;
+  return false;
+#endif // defined(__linux__) && defined(SYS_pidfd_open)
+}
+
+void ChildReaper::watchWithSignal(::pid_t pid,
+    ChildTerminationHandler handler) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ensureSignalHandlerInstalled();
+    signalWatchedChildren[pid] = std::move(handler);
+  }
+  // The child process might have terminated before we started watching it,
+  // so we check it once without waiting for SIGCHLD.
+  IoReactor::getInstance().post([this]() {reapSignalWatchedChildren();});
+}
+
+} // namespace execute
+} // namespace epics
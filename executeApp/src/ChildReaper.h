@@ -0,0 +1,121 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_CHILD_REAPER_H
+#define EPICS_EXEC_CHILD_REAPER_H
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+extern "C" {
+#include <sys/types.h>
+}
+
+namespace epics {
+namespace execute {
+
+/**
+ * Handler that is called when a child process has terminated. waitStatus is
+ * the status as reported by waitpid(). If the status of the child process
+ * cannot be determined, error is set and waitStatus is undefined.
+ */
+using ChildTerminationHandler =
+    std::function<void(int waitStatus, std::exception_ptr error)>;
+
+/**
+ * Reaps child processes that have been created by this library, so that no
+ * thread has to block in waitpid() while a child process is running.
+ *
+ * On Linux, the reaper uses a pidfd (as returned by pidfd_open()) for each
+ * child process. The pidfd is registered with the I/O reactor and becomes
+ * readable when the child process terminates. If pidfds are not available
+ * (older kernels or other platforms), the reaper installs a SIGCHLD handler
+ * that wakes up the I/O reactor, which then checks each of the watched child
+ * processes with waitpid(..., WNOHANG). The reaper never calls waitpid() for
+ * processes that it does not watch, so it does not steal the status of child
+ * processes that are managed by other code (like the fork server process).
+ * A SIGCHLD handler that was installed before the reaper's handler is still
+ * called.
+ */
+class ChildReaper {
+
+public:
+
+  /**
+   * Returns the only instance of this class.
+   */
+  inline static ChildReaper &getInstance() {
+    return instance;
+  }
+
+  /**
+   * Starts watching a child process. Once the child process has terminated,
+   * it is reaped and the handler is called in the I/O reactor's thread, so
+   * the handler must not block and must not throw. The calling code must not
+   * call waitpid() for the child process.
+   *
+   * @throws std::system_error if the child process cannot be watched. In this
+   *     case, the calling code is responsible for reaping the child process.
+   */
+  void watch(::pid_t pid, ChildTerminationHandler handler);
+
+private:
+
+  static ChildReaper instance;
+
+  std::mutex mutex;
+  std::atomic<bool> pidFdSupported;
+  int signalPipeReadFd;
+  std::unordered_map<::pid_t, ChildTerminationHandler> signalWatchedChildren;
+
+  // We do not want to allow copy or move construction or assignment.
+  ChildReaper(ChildReaper const &) = delete;
+  ChildReaper(ChildReaper &&) = delete;
+  ChildReaper &operator=(ChildReaper const &) = delete;
+  ChildReaper &operator=(ChildReaper &&) = delete;
+
+  ChildReaper();
+
+  void ensureSignalHandlerInstalled();
+
+  void reapSignalWatchedChildren();
+
+  bool watchWithPidFd(::pid_t pid, ChildTerminationHandler &handler);
+
+  void watchWithSignal(::pid_t pid, ChildTerminationHandler handler);
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_CHILD_REAPER_H
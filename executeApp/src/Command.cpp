@@ -1,6 +1,6 @@
 /*
- * Copyright 2018-2023 aquenos GmbH.
- * Copyright 2018-2023 Karlsruhe Institute of Technology.
+ * Copyright 2018-2026 aquenos GmbH.
+ * Copyright 2018-2026 Karlsruhe Institute of Technology.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as
@@ -28,8 +28,10 @@
  */
 
 #include <algorithm>
-#include <cassert>
+#include <atomic>
+#include <chrono>
 #include <cstring>
+#include <memory>
 #include <stdexcept>
 #include <system_error>
 #include <utility>
@@ -38,17 +40,23 @@ extern "C" {
 #include <errno.h>
 #include <fcntl.h>
 #include <signal.h>
-#include <sys/mman.h>
 #include <sys/wait.h>
 #include <unistd.h>
 }
 
+#include "BaseEnvironment.h"
+#include "BufferPool.h"
+#include "ChildProcessHandle.h"
+#include "ChildReaper.h"
 #include "Command.h"
+#include "ForkServer.h"
+#include "IoReactor.h"
+#include "LineStream.h"
+#include "Probes.h"
+#include "Supervisor.h"
 #include "ThreadPoolExecutor.h"
-
-extern "C" {
-extern char **environ;
-}
+#include "fileDescriptors.h"
+#include "spawnProcess.h"
 
 namespace epics {
 namespace execute {
@@ -56,33 +64,102 @@ namespace execute {
 namespace {
 
 /**
- * Provides a pipe together with a thread that reads from this pipe. When the
- * pipe is closed on the writer's side, the thread terminates and provides the
- * result. If the writer writes more data than the capacity, any extra data is
- * simply discarded.
+ * Maximum number of read() or write() calls that are made for a single pipe
+ * before returning control to the I/O reactor. This ensures that a process
+ * that produces a lot of output cannot delay the processing of other pipes
+ * indefinitely.
+ */
+int const maxIoCallsPerEvent = 16;
+
+/**
+ * Initial size of a buffer used for capturing output. The buffer grows as
+ * more data is read, so memory is only used for data that has actually been
+ * written by the child process.
+ */
+std::size_t const initialCaptureBufferSize = 4096;
+
+/**
+ * Returns a file descriptor for /dev/null that is opened for writing. The
+ * file is only opened once. If it cannot be opened, -1 is returned.
+ */
+int getDevNullFd() {
+  static int devNullFd = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+  return devNullFd;
+}
+
+/**
+ * Reads data from the file descriptor and discards it. Returns the number of
+ * bytes that have been discarded or -1 if there was an error (and errno is
+ * set).
+ */
+::ssize_t discardData(int fd) {
+#ifdef __linux__
+  // On Linux, we can move the data directly from the pipe to /dev/null,
+  // without copying it to user space. This allows us to discard much more
+  // data per system call than when reading it into a buffer.
+  int devNullFd = getDevNullFd();
+  if (devNullFd != -1) {
+    auto bytesDiscarded = ::splice(fd, nullptr, devNullFd, nullptr,
+        1024 * 1024, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (bytesDiscarded != -1 || (errno != EINVAL && errno != ENOSYS)) {
+      return bytesDiscarded;
+    }
+  }
+#endif // __linux__
+  char buffer[16384];
+  return ::read(fd, buffer, sizeof(buffer));
+}
+
+/**
+ * Provides a pipe together with a handler that reads from this pipe in the
+ * I/O reactor's thread. When the pipe is closed on the writer's side, the
+ * completion handler is called with the result. If the writer writes more
+ * data than the capacity, the overflow policy decides which data is kept.
  */
 class AccumulatingPipe {
 
 public:
 
-  AccumulatingPipe() : AccumulatingPipe(0) {
+  /**
+   * Handler that is called with the data that has been read and the number of
+   * bytes that have been discarded because they exceeded the capacity.
+   * firstDataTime is the time when the first byte was read (or the epoch if
+   * no data was read). If there was an error, error is set and data is empty.
+   */
+  using CompletionHandler = std::function<void(std::vector<char> data,
+      std::size_t discardedBytes,
+      std::chrono::steady_clock::time_point firstDataTime,
+      std::exception_ptr error)>;
+
+  AccumulatingPipe() : AccumulatingPipe(0, OverflowPolicy::keepHead, nullptr,
+      std::shared_ptr<LineStream>()) {
   }
 
-  AccumulatingPipe(std::size_t capacity) : capacity(capacity), readFd(-1),
-      valid(false), writeFd(-1) {
-    if (capacity == 0) {
+  /**
+   * Creates a pipe that reads up to capacity bytes. The buffer for the data is
+   * taken from the buffer pool (if not null). If lineStream is not null, all
+   * data (including data that is not kept because it exceeds the capacity)
+   * is also written to the line stream while it is read.
+   */
+  AccumulatingPipe(std::size_t capacity, OverflowPolicy overflowPolicy,
+      BufferPool *bufferPool, std::shared_ptr<LineStream> lineStream) :
+      bufferPool(bufferPool), capacity(capacity), lineStream(lineStream),
+      overflowPolicy(overflowPolicy), readFd(-1), valid(false), writeFd(-1) {
+    if (capacity == 0 && !lineStream) {
       // If we are not supposed to read any data, we do not have to create
       // a pipe either.
       this->valid = true;
       return;
     }
+    // The pipe is created with the close-on-exec flag set, so that it does
+    // not leak into child processes created for other commands.
     int fileDescriptors[2];
-    if (::pipe(fileDescriptors)) {
-      throw std::system_error(std::error_code(errno, std::system_category()),
-          "pipe() failed");
-    }
+    createPipe(fileDescriptors);
     this->readFd = fileDescriptors[0];
     this->writeFd = fileDescriptors[1];
+    // The read end is only used by the I/O reactor, so it must not block. The
+    // write end that is passed to the child process is not affected by this.
+    setNonBlocking(this->readFd);
     this->valid = true;
   }
 
@@ -97,61 +174,79 @@ public:
     }
   }
 
-  std::future<std::vector<char>> readDataAsync() {
-    // This method is only called on the read side and only after forking. This
-    // means that we can close the write FD. We use some flags in order to
-    // ensure that the calling code actually uses this method correctly
-    // (does not call both readDataAsync and transferWriteFd or call either of
-    // them more than once).
+  /**
+   * Starts reading data. The child process is needed in case the overflow
+   * policy is OverflowPolicy::kill.
+   */
+  void readDataAsync(CompletionHandler completionHandler,
+      std::shared_ptr<ChildProcessHandle> const &child) {
+    // This method is only called after the child process has been created.
+    // This means that we can close the write FD. We use a flag in order to
+    // ensure that the calling code actually uses this method correctly (does
+    // not call it more than once).
     if (!valid) {
-      throw std::logic_error(
-          "Only one of readDataAsync and transferWriteFd must be called in each process and each method must only be called once.");
+      throw std::logic_error("readDataAsync must only be called once.");
     }
-    if (capacity == 0) {
-      // If the capacity is zero, we do not have a pipe and can always return an
-      // empty vector.
-      std::promise<std::vector<char>> promise;
-      promise.set_value(std::vector<char>());
-      return promise.get_future();
+    if (this->readFd == -1) {
+      // If the capacity is zero and there is no line stream, we do not have a
+      // pipe and can always provide an empty vector right away.
+      completionHandler(std::vector<char>(), 0,
+          std::chrono::steady_clock::time_point(), std::exception_ptr());
+      return;
     }
     valid = false;
     ::close(this->writeFd);
     this->writeFd = -1;
-    auto future = sharedThreadPoolExecutor().submit(readData, this->capacity,
-        this->readFd);
-    // The read FD is now owned (and will be closed) by the new thread, so we
-    // set it to -1.
-    this->readFd = -1;
-    return future;
-  }
-
-  int transferWriteFd() {
-    // This method is only called on the write side and only after forking. This
-    // means that we can close the read FD. We use some flags in order to
-    // ensure that the calling code actually uses this method correctly
-    // (does not call both readDataAsync and transferWriteFd or call either of
-    // them more than once).
-    if (!valid) {
-      throw std::logic_error(
-          "Only one of readDataAsync and transferWriteFd must be called in each process and each method must only be called once.");
+    auto state = std::make_shared<ReadState>();
+    if (this->bufferPool && this->capacity != 0) {
+      state->buffer = this->bufferPool->acquire();
     }
-    if (capacity == 0) {
-      throw std::logic_error(
-          "Cannot get the write FD because the capacity is zero.");
+    state->capacity = this->capacity;
+    state->child = child;
+    state->childKilled = false;
+    state->completionHandler = std::move(completionHandler);
+    state->fd = this->readFd;
+    if (this->lineStream) {
+      state->lineWriter.reset(new LineStream::Writer(this->lineStream));
     }
-    valid = false;
-    ::close(this->readFd);
+    state->overflowPolicy = this->overflowPolicy;
+    state->totalBytesRead = 0;
+    IoReactor::getInstance().addFd(state->fd, IoReactor::readable,
+        [state]() {readData(*state);});
+    // The read FD is now owned (and will be closed) by the handler, so we set
+    // it to -1.
     this->readFd = -1;
-    // After calling this method, the calling code is responsible for closing
-    // the file descriptor, so we set our internal reference to -1.
-    int returnValue = this->writeFd;
-    this->writeFd = -1;
-    return returnValue;
+  }
+
+  int getWriteFd() const {
+    // The write FD is passed to the child process. It is closed in this
+    // process when calling readDataAsync().
+    return this->writeFd;
   }
 
 private:
 
+  /**
+   * State that is shared with the handler registered with the I/O reactor.
+   */
+  struct ReadState {
+    std::vector<char> buffer;
+    std::size_t capacity;
+    std::shared_ptr<ChildProcessHandle> child;
+    bool childKilled;
+    CompletionHandler completionHandler;
+    int fd;
+    std::chrono::steady_clock::time_point firstDataTime;
+    std::unique_ptr<LineStream::Writer> lineWriter;
+    OverflowPolicy overflowPolicy;
+    // This includes the bytes that have been discarded.
+    std::size_t totalBytesRead;
+  };
+
+  BufferPool *bufferPool;
   std::size_t capacity;
+  std::shared_ptr<LineStream> lineStream;
+  OverflowPolicy overflowPolicy;
   int readFd;
   bool valid = false;
   int writeFd;
@@ -162,75 +257,196 @@ private:
   AccumulatingPipe &operator=(AccumulatingPipe const&) = delete;
   AccumulatingPipe &operator=(AccumulatingPipe &&) = delete;
 
-  static std::vector<char> readData(std::size_t capacity, int fd) {
-    std::vector<char> buffer(capacity, 0);
-    std::size_t totalBytesRead = 0;
-    ::ssize_t bytesRead;
-    while ((bytesRead = ::read(fd, buffer.data() + totalBytesRead,
-        buffer.size() - totalBytesRead)) > 0) {
-      totalBytesRead += bytesRead;
-      if (totalBytesRead == capacity) {
-        // Drain the remaining bytes.
-        char tempBuffer[1024];
-        do {
-        } while((bytesRead = read(fd, tempBuffer, sizeof(tempBuffer))) > 0);
-        break;
-      }
+  /**
+   * Scratch buffer used for reading data that is not read directly into the
+   * buffer (in keepTail mode when the capacity is small or when the data is
+   * only needed for the line stream). This buffer is only used from the I/O
+   * reactor's thread.
+   */
+  static char scratchBuffer[65536];
+
+  /**
+   * Copies data into the ring buffer, keeping only the last bytes if there
+   * are more bytes than the capacity. This does not update totalBytesRead.
+   */
+  static void copyToRingBuffer(ReadState &state, char const *data,
+      std::size_t size) {
+    std::size_t position = state.totalBytesRead + size;
+    if (size > state.capacity) {
+      data += size - state.capacity;
+      size = state.capacity;
     }
-    if (bytesRead == -1) {
-      // If there was an error, we throw an exception.
-      std::system_error e(std::error_code(errno, std::system_category()),
-          "read() failed");
-      ::close(fd);
-      throw e;
-    } else {
-      // Otherwise, we simply close the FD because we wrote all data.
-      ::close(fd);
-      buffer.resize(totalBytesRead);
-      return buffer;
+    position = (position - size) % state.capacity;
+    auto firstPart = std::min(size, state.capacity - position);
+    std::memcpy(state.buffer.data() + position, data, firstPart);
+    std::memcpy(state.buffer.data(), data + firstPart, size - firstPart);
+  }
+
+  static void readData(ReadState &state) {
+    for (int i = 0; i < maxIoCallsPerEvent; ++i) {
+      ::ssize_t bytesRead;
+      if (state.totalBytesRead < state.capacity) {
+        // If the buffer is full, we grow it, but never beyond the capacity.
+        // Growing the buffer exponentially ensures that the time spent on
+        // initializing the memory is proportional to the size of the data.
+        if (state.totalBytesRead == state.buffer.size()) {
+          try {
+            state.buffer.resize(std::min(state.capacity, std::max(
+                initialCaptureBufferSize, 2 * state.buffer.size())));
+          } catch (...) {
+            IoReactor::getInstance().removeFd(state.fd);
+            ::close(state.fd);
+            state.completionHandler(std::vector<char>(), 0,
+                state.firstDataTime, std::current_exception());
+            return;
+          }
+        }
+        bytesRead = ::read(state.fd,
+            state.buffer.data() + state.totalBytesRead,
+            state.buffer.size() - state.totalBytesRead);
+        if (bytesRead > 0 && state.lineWriter) {
+          state.lineWriter->write(state.buffer.data() + state.totalBytesRead,
+              bytesRead);
+        }
+      } else if (state.lineWriter
+          || (state.overflowPolicy == OverflowPolicy::keepTail
+              && state.capacity < sizeof(scratchBuffer))) {
+        // When the line stream needs the data or when the ring buffer is
+        // small (reading directly into it would limit each read() call to a
+        // few bytes), we read into a larger scratch buffer and only copy the
+        // bytes that are kept. This method is only called from the I/O
+        // reactor's thread, so using a single scratch buffer is safe.
+        bytesRead = ::read(state.fd, scratchBuffer, sizeof(scratchBuffer));
+        if (bytesRead > 0) {
+          if (state.lineWriter) {
+            state.lineWriter->write(scratchBuffer, bytesRead);
+          }
+          if (state.overflowPolicy == OverflowPolicy::keepTail
+              && state.capacity > 0) {
+            copyToRingBuffer(state, scratchBuffer, bytesRead);
+          }
+        }
+      } else if (state.overflowPolicy == OverflowPolicy::keepTail) {
+        // Once the buffer has reached its capacity, we use it as a ring
+        // buffer, overwriting the oldest data.
+        auto position = state.totalBytesRead % state.capacity;
+        bytesRead = ::read(state.fd, state.buffer.data() + position,
+            state.capacity - position);
+      } else {
+        // Once the buffer is full, we discard the remaining bytes.
+        bytesRead = discardData(state.fd);
+      }
+      // If the policy says so, we kill the child process as soon as we know
+      // that it actually wrote more data than fits into the buffer.
+      if (bytesRead > 0 && state.capacity > 0
+          && state.totalBytesRead >= state.capacity
+          && state.overflowPolicy == OverflowPolicy::kill
+          && !state.childKilled) {
+        state.child->kill();
+        state.childKilled = true;
+      }
+      if (bytesRead > 0) {
+        EPICS_EXEC_PROBE2(output_read, state.fd, bytesRead);
+        if (state.totalBytesRead == 0) {
+          state.firstDataTime = std::chrono::steady_clock::now();
+        }
+        state.totalBytesRead += bytesRead;
+        continue;
+      } else if (bytesRead == 0) {
+        // The writer closed the pipe, so we are done. The remaining lines are
+        // published before the run completes.
+        IoReactor::getInstance().removeFd(state.fd);
+        ::close(state.fd);
+        state.lineWriter.reset();
+        std::size_t discardedBytes = 0;
+        if (state.totalBytesRead > state.capacity) {
+          discardedBytes = state.totalBytesRead - state.capacity;
+          // If the ring buffer has wrapped around, the oldest byte is at the
+          // position where the next byte would have been written.
+          if (state.overflowPolicy == OverflowPolicy::keepTail
+              && state.capacity > 0) {
+            std::rotate(state.buffer.begin(),
+                state.buffer.begin() + state.totalBytesRead % state.capacity,
+                state.buffer.end());
+          }
+        } else {
+          state.buffer.resize(state.totalBytesRead);
+        }
+        state.completionHandler(std::move(state.buffer), discardedBytes,
+            state.firstDataTime, std::exception_ptr());
+        return;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // No more data is available right now. The handler is called again
+        // when more data is available.
+        return;
+      } else if (errno != EINTR) {
+        // If there was an error, we pass an exception to the handler.
+        std::system_error e(std::error_code(errno, std::system_category()),
+            "read() failed");
+        IoReactor::getInstance().removeFd(state.fd);
+        ::close(state.fd);
+        state.lineWriter.reset();
+        state.completionHandler(std::vector<char>(), 0,
+            state.firstDataTime, std::make_exception_ptr(e));
+        return;
+      }
     }
   }
 
 };
 
-/**
- * Stores error information from the child process (if any).
- */
-struct ChildProcessStatus {
-
-  int errorNumber = 0;
-  int execveStatus = 0;
-
-};
+char AccumulatingPipe::scratchBuffer[65536];
 
 /**
- * Provides a pipe together with a thread that read from a buffer and writes
- * into this pipe. Once all data has been written, the thread closes the pipe
- * and terminates.
+ * Provides the file descriptor for the standard input of a child process.
+ *
+ * If the buffer is backed by a sealed memory file, the memory file is opened
+ * and passed to the child process directly, so no data has to be copied.
+ * Otherwise, a pipe is created together with a handler that writes the
+ * contents of the buffer into this pipe in the I/O reactor's thread. Once all
+ * data has been written, the handler closes the pipe and calls the
+ * completion handler.
  */
-class PreFilledPipe {
+class PreFilledInput {
 
 public:
 
-  PreFilledPipe(std::vector<char> const &buffer) : buffer(buffer), readFd(-1),
-      valid(false), writeFd(-1) {
-    if (buffer.empty()) {
+  /**
+   * Handler that is called once all data has been written. If there was an
+   * error, error is set.
+   */
+  using CompletionHandler = std::function<void(std::exception_ptr error)>;
+
+  PreFilledInput(std::shared_ptr<SealedBuffer const> const &buffer) :
+      buffer(buffer), readFd(-1), valid(false), writeFd(-1) {
+    if (!buffer || buffer->getSize() == 0) {
       // If we are not supposed to write any data, we do not have to create
       // a pipe either.
       this->valid = true;
       return;
     }
-    int fileDescriptors[2];
-    if (::pipe(fileDescriptors)) {
-      throw std::system_error(std::error_code(errno, std::system_category()),
-          "mmap() failed");
+    // If the data is stored in a memory file, the child process can read it
+    // directly. Each child process gets its own file descriptor, so that the
+    // file offset is not shared.
+    this->readFd = buffer->openFd();
+    if (this->readFd != -1) {
+      this->valid = true;
+      return;
     }
+    // The pipe is created with the close-on-exec flag set, so that it does
+    // not leak into child processes created for other commands.
+    int fileDescriptors[2];
+    createPipe(fileDescriptors);
     this->readFd = fileDescriptors[0];
     this->writeFd = fileDescriptors[1];
+    // The write end is only used by the I/O reactor, so it must not block.
+    // The read end that is passed to the child process is not affected by
+    // this.
+    setNonBlocking(this->writeFd);
     this->valid = true;
   }
 
-  ~PreFilledPipe() {
+  ~PreFilledInput() {
     if (this->readFd != -1) {
       ::close(this->readFd);
       this->readFd = -1;
@@ -241,292 +457,169 @@ public:
     }
   }
 
-  int transferReadFd() {
-    // This method is only called on the read side and only after forking. This
-    // means that we can close the write FD. We use some flags in order to
-    // ensure that the calling code actually uses this method correctly
-    // (does not call both transferReadFd and writeDataAsync or call either of
-    // them more than once).
+  int getReadFd() const {
+    // The read FD is passed to the child process. It is closed in this process
+    // when calling writeDataAsync().
+    return this->readFd;
+  }
+
+  void writeDataAsync(CompletionHandler completionHandler) {
+    // This method is only called after the child process has been created.
+    // This means that we can close the read FD. We use a flag in order to
+    // ensure that the calling code actually uses this method correctly (does
+    // not call it more than once).
     if (!valid) {
-      throw std::logic_error(
-          "Only one of transferReadFd, writeDataAsync, and "
-          "writeDataAsyncAndWaitForPid must be called in each process and each "
-          "method must only be called once.");
-    }
-    if (buffer.empty()) {
-      throw std::logic_error(
-          "Cannot get the read FD because the buffer is empty.");
+      throw std::logic_error("writeDataAsync must only be called once.");
     }
     valid = false;
-    ::close(this->writeFd);
+    if (this->readFd != -1) {
+      ::close(this->readFd);
+      this->readFd = -1;
+    }
+    if (this->writeFd == -1) {
+      // If the buffer is empty or the child process reads from a memory file,
+      // we did not create a pipe, so we are done and can call the completion
+      // handler right away.
+      completionHandler(std::exception_ptr());
+      return;
+    }
+    auto state = std::make_shared<WriteState>();
+    state->buffer = std::move(this->buffer);
+    state->completionHandler = std::move(completionHandler);
+    state->fd = this->writeFd;
+    state->totalBytesWritten = 0;
+    IoReactor::getInstance().addFd(state->fd, IoReactor::writable,
+        [state]() {writeData(*state);});
+    // The write FD is now owned (and will be closed) by the handler, so we
+    // set it to -1.
     this->writeFd = -1;
-    // After calling this method, the calling code is responsible for closing
-    // the file descriptor, so we set our internal reference to -1.
-    int returnValue = this->readFd;
-    this->readFd = -1;
-    return returnValue;
-  }
-
-  std::future<void> writeDataAsync() {
-    return writeDataAsyncInternal(false, 0);
-  }
-
-  std::future<void> writeDataAsyncAndWaitForPid(pid_t pid) {
-    return writeDataAsyncInternal(true, pid);
   }
 
 private:
 
-  std::vector<char> buffer;
+  /**
+   * State that is shared with the handler registered with the I/O reactor.
+   */
+  struct WriteState {
+    std::shared_ptr<SealedBuffer const> buffer;
+    CompletionHandler completionHandler;
+    int fd;
+    std::size_t totalBytesWritten;
+  };
+
+  std::shared_ptr<SealedBuffer const> buffer;
   int readFd;
   bool valid = false;
   int writeFd;
 
   // We do not want to allow copy or move construction and assignment.
-  PreFilledPipe(PreFilledPipe const&) = delete;
-  PreFilledPipe(PreFilledPipe &&) = delete;
-  PreFilledPipe &operator=(PreFilledPipe const&) = delete;
-  PreFilledPipe &operator=(PreFilledPipe &&) = delete;
-
-  static void writeData(
-      std::vector<char> buffer, int fd, bool waitForPid, pid_t pid) {
-    std::size_t totalBytesWritten = 0;
-    ::ssize_t bytesWritten;
-    while ((bytesWritten = ::write(fd, buffer.data() + totalBytesWritten,
-        buffer.size() - totalBytesWritten)) > 0) {
-      totalBytesWritten += bytesWritten;
-      if (totalBytesWritten == buffer.size()) {
-        bytesWritten = 0;
-        break;
-      }
-    }
-    // If we are supposed to wait for a child process, we do this now.
-    if (waitForPid) {
-      ::waitpid(pid, nullptr, 0);
-    }
-    // If there was an error, we throw an exception.
-    if (bytesWritten == -1) {
-      // We construct the exception before calling close(), because close()
-      // might reset errno.
-      std::system_error e(std::error_code(errno, std::system_category()),
-          "write() failed");
-      ::close(fd);
-      throw e;
-    } else {
-      // Otherwise, we simply close the FD because we wrote all data.
-      ::close(fd);
-    }
-  }
-
-  std::future<void> writeDataAsyncInternal(bool waitForPid, pid_t pid) {
-    // This method is only called on the write side and only after forking. This
-    // means that we can close the read FD. We use some flags in order to
-    // ensure that the calling code actually uses this method correctly
-    // (does not call both transferReadFd and writeDataAsync or call either of
-    // them more than once).
-    if (!valid) {
-      throw std::logic_error(
-          "Only one of transferReadFd, writeDataAsync, and "
-          "writeDataAsyncAndWaitForPid must be called in each process and each "
-          "method must only be called once.");
-    }
-    valid = false;
-    if (buffer.empty() and !waitForPid) {
-      // If the buffer is empty, we did not create a pipe, so we do not have to
-      // close any file descriptors. However, we still have to wait for the
-      // child process, if requested.
-      if (waitForPid) {
-        return sharedThreadPoolExecutor().submit([pid]() {
-              ::waitpid(pid, nullptr, 0);
-        });
+  PreFilledInput(PreFilledInput const&) = delete;
+  PreFilledInput(PreFilledInput &&) = delete;
+  PreFilledInput &operator=(PreFilledInput const&) = delete;
+  PreFilledInput &operator=(PreFilledInput &&) = delete;
+
+  static void writeData(WriteState &state) {
+    for (int i = 0; i < maxIoCallsPerEvent; ++i) {
+      auto bytesWritten = ::write(state.fd,
+          state.buffer->getData() + state.totalBytesWritten,
+          state.buffer->getSize() - state.totalBytesWritten);
+      if (bytesWritten > 0) {
+        EPICS_EXEC_PROBE2(input_write, state.fd, bytesWritten);
+        state.totalBytesWritten += bytesWritten;
+        if (state.totalBytesWritten == state.buffer->getSize()) {
+          // We wrote all data, so we close the FD, which signals the end of
+          // the stream to the reader.
+          IoReactor::getInstance().removeFd(state.fd);
+          ::close(state.fd);
+          state.completionHandler(std::exception_ptr());
+          return;
+        }
+      } else if (bytesWritten == -1
+          && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        // The pipe is full. The handler is called again when the reader has
+        // consumed some data.
+        return;
+      } else if (bytesWritten == -1 && errno != EINTR) {
+        // If there was an error, we pass an exception to the handler. We
+        // construct the exception before calling close(), because close()
+        // might reset errno.
+        std::system_error e(std::error_code(errno, std::system_category()),
+            "write() failed");
+        IoReactor::getInstance().removeFd(state.fd);
+        ::close(state.fd);
+        state.completionHandler(std::make_exception_ptr(e));
+        return;
       }
-      // If we do not have to wait for a process, we are done and can simply
-      // return a future that has already completed.
-      std::promise<void> promise;
-      promise.set_value();
-      return promise.get_future();
     }
-    ::close(this->readFd);
-    this->readFd = -1;
-    auto future = sharedThreadPoolExecutor().submit(writeData,
-        std::move(this->buffer), this->writeFd, waitForPid, pid);
-    // The write FD is now owned (and will be closed) by the new thread, so we
-    // set it to -1.
-    this->writeFd = -1;
-    return future;
   }
 
 };
 
 /**
- * Ensures that the running flag (or any other boolean passed to the
- * constructor) is switched from false to true during construction and back from
- * true to false during destruction.
+ * Ensures that the running count is incremented during construction and
+ * decremented during destruction. If the running count has already reached
+ * the limit, the constructor throws.
  */
-struct RunningFlagGuard {
+struct RunningCountGuard {
 
   bool ignore;
-  bool &runningFlag;
+  int &runningCount;
   std::mutex &mutex;
 
-  RunningFlagGuard(bool &runningFlag, std::mutex &mutex, bool ignore) :
-      ignore(ignore), runningFlag(runningFlag), mutex(mutex) {
+  RunningCountGuard(int &runningCount, int const &maxRunningCount,
+      std::mutex &mutex, bool ignore) :
+      ignore(ignore), runningCount(runningCount), mutex(mutex) {
     if (!this->ignore) {
       std::lock_guard<std::mutex> lock(this->mutex);
-      if (this->runningFlag) {
-        throw std::invalid_argument(
-          "run() has been called before the previous call to run() finished.");
+      if (this->runningCount >= maxRunningCount) {
+        if (maxRunningCount == 1) {
+          throw std::invalid_argument(
+            "run() has been called before the previous call to run() finished.");
+        } else {
+          throw std::invalid_argument(
+            "run() has been called while the maximum number of concurrent runs are active.");
+        }
       }
-      this->runningFlag = true;
+      ++this->runningCount;
     }
   }
 
-  ~RunningFlagGuard() {
+  ~RunningCountGuard() {
     if (!ignore) {
       std::lock_guard<std::mutex> lock(mutex);
-      runningFlag = false;
+      --runningCount;
     }
   }
 
-};
-
-/**
- * Stores a data structure in a memory segment allocated with mmap. This can be
- * used to share a data structure between the parent and the child process. This
- * class does not implement any synchronization mechanism, so synchronization
- * has to be ensured by the user.
- */
-template<typename T>
-class SharedData {
-
-public:
-
-  SharedData() : data(nullptr) {
-    // We us an anonymous memory mapping in order to establish a communication
-    // channel between the parent and the child process. As we only write to the
-    // memory in the child process and only read from it in the parent process
-    // after the child process has terminated, we do not need any further
-    // synchronization mechanism.
-    void * mappedMemory =
-        ::mmap(nullptr, sizeof(T), PROT_READ | PROT_WRITE,
-            MAP_ANONYMOUS | MAP_SHARED, -1, 0);
-    if (mappedMemory == MAP_FAILED) {
-      std::system_error e(std::error_code(errno, std::system_category()),
-        "mmap() failed");
-    }
-    try {
-      this->data = new(mappedMemory) T();
-    } catch (...) {
-      ::munmap(this->data, sizeof(T));
-      this->data = nullptr;
-      throw;
-    }
-  }
-
-  ~SharedData() {
-    if (this->data) {
-      try {
-        this->data->~T();
-      } catch (...) {
-        ::munmap(this->data, sizeof(T));
-        this->data = nullptr;
-        throw;
-      }
-      ::munmap(this->data, sizeof(T));
-      this->data = nullptr;
-    }
-  }
-
-  T *operator->() {
-    return this->data;
-  }
-
-  T const *operator->() const {
-    return this->data;
-  }
-
-  T &operator*() {
-    return *this->data;
-  }
-
-  T const &operator*() const {
-    return *this->data;
+  /**
+   * Releases the guard, so that the count is not decremented on destruction.
+   * After calling this method, the calling code is responsible for
+   * decrementing the count.
+   */
+  void release() {
+    ignore = true;
   }
 
-private:
-
-  T *data;
-
-  // We cannot allow copy construction or assignment, so we delete the
-  // respective constructor and operator. We could allow move semantics, but we
-  // would have to implement them specifically and we do not need them, so we
-  // delete that constructor and operator, too.
-  SharedData(SharedData const&) = delete;
-  SharedData(SharedData &&) = delete;
-  SharedData &operator=(SharedData const&) = delete;
-  SharedData &operator=(SharedData &&) = delete;
-
 };
 
 /**
- * The argument values are stored in a map. This function creates a vector,
- * using empty strings for missing indices. The strings are copied, so that
- * changes in the map made after calling this function do not affect the
+ * Merges the base environment with the entries from the specified map. The
+ * strings are copied, so future changes to the map do not affect the returned
  * vector.
  */
-std::vector<std::string> prepareArguments(
-    std::map<int, std::string> const &arguments) {
-  // We now that arguments is never empty because there should at least be an
-  // argument with index 0.
-  assert(!arguments.empty());
-  // As arguments is not empty, arguments.rbegin() is never arguments.rend().
-  int maxIndex = arguments.rbegin()->first;
-  // We initialize the vector with empty strings. After that, we overwrite the
-  // entries for the indices which are also defined in the original vector.
-  std::vector<std::string> argumentsVector(maxIndex + 1, std::string());
-  for (auto argEntry = arguments.begin(); argEntry != arguments.end(); ++argEntry) {
-    argumentsVector[argEntry->first] = argEntry->second;
-  }
-  return argumentsVector;
-}
-
-/**
- * Merges this process's environment (represented by the envion variable) with
- * the entries from the specified map. The strings are copied, so future changes
- * to the environ variable or to the map do not affect the returned vector.
- */
 std::vector<std::string> prepareEnvironment(
+    BaseEnvironment::Snapshot const &baseEnvironment,
     std::map<std::string, std::string> const &envVars) {
-  // First, we count the entries in the environ array so that we can create a
-  // vector of sufficient size. This is probably more efficient than resizing
-  // the vector as we add elements.
-  char **nextEnvironEntry = environ;
-  int numberOfEnvironEntries = 0;
-  while (*nextEnvironEntry) {
-    ++numberOfEnvironEntries;
-    ++nextEnvironEntry;
-  }
   std::vector<std::string> newEnvironment;
-  newEnvironment.reserve(numberOfEnvironEntries + envVars.size());
-  // The environ variable is an array of pointers to null-terminated strings.
-  // The last entry in this array is the null pointer. Each string has the form
-  // NAME=VALUE.
-  nextEnvironEntry = environ;
-  while (*nextEnvironEntry) {
-    std::string envString(*nextEnvironEntry);
+  newEnvironment.reserve(baseEnvironment.entries.size() + envVars.size());
+  for (auto &envString : baseEnvironment.entries) {
+    // The snapshot only contains entries that have the form NAME=VALUE, so we
+    // can extract the name in order to see whether it collides with an entry
+    // in the envVars map. We only add the entry if there is no collision.
     auto eqIndex = envString.find_first_of('=');
-    // If the entry does not contain an equals sign, it is not a valid
-    // environment entry and we ignore it. Otherwise, we extract the name in
-    // order to see whether it collides with an entry in the envVars map.
-    if (eqIndex != std::string::npos) {
-      auto name = envString.substr(0, eqIndex);
-      // We only add the entry if the envVars map does not have an entry with
-      // the same name.
-      if (envVars.find(name) == envVars.end()) {
-        newEnvironment.emplace_back(envString);
-      }
+    if (envVars.find(envString.substr(0, eqIndex)) == envVars.end()) {
+      newEnvironment.emplace_back(envString);
     }
-    ++nextEnvironEntry;
   }
   // Now we add the entries from the envVars map.
   for (auto envEntry = envVars.begin(); envEntry != envVars.end(); ++envEntry) {
@@ -546,8 +639,8 @@ std::vector<std::string> prepareEnvironment(
  * Converts a vector of strings to a vector of C strings. The strings are not
  * copied, so the returned vector is only valid as long as the passed vector and
  * its strings are not modified. This function is intended for use on the return
- * values of prepareArguments and prepareEnvironment, resulting in vectors that
- * encapsulate arrays that can be passed to the execve system call.
+ * value of prepareEnvironment, resulting in a vector that encapsulates an array
+ * that can be passed to the execve system call.
  */
 std::vector<char const *> viewAsCStrings(
     std::vector<std::string> const &strings) {
@@ -569,14 +662,112 @@ std::vector<char const *> viewAsCStrings(
   return cStrings;
 }
 
+/**
+ * Creates a result with the specified exit code and without any output.
+ */
+Command::Result makeResult(int exitCode) {
+  // Value-initialization ensures that all other fields are zero.
+  auto result = Command::Result();
+  result.exitCode = exitCode;
+  return result;
+}
+
+/**
+ * Creates a memory file for capturing output if the capture mode is
+ * CaptureMode::file. Returns null if the output is captured through a pipe,
+ * including the case where memory files are not supported.
+ */
+std::shared_ptr<OutputFile> createOutputFile(CaptureMode captureMode,
+    std::size_t capacity) {
+  if (captureMode != CaptureMode::file || capacity == 0) {
+    return std::shared_ptr<OutputFile>();
+  }
+  try {
+    return std::make_shared<OutputFile>();
+  } catch (std::system_error const &) {
+    return std::shared_ptr<OutputFile>();
+  }
+}
+
+/**
+ * Spawn method used by all commands that do not have a spawn method set
+ * explicitly.
+ */
+std::atomic<SpawnMethod> defaultSpawnMethod(SpawnMethod::fork);
+
+/**
+ * Most recently created result pin of the current thread. The pins of a
+ * thread form a stack that is linked through their previous pointers.
+ */
+thread_local Command::ResultPin *currentResultPin = nullptr;
+
 } // anonymous namespace
 
-Command::Command(std::string const &commandPath, bool wait) :
-    commandPath(commandPath), exitCode(0), running(false), stderrCapacity(0),
-    stdoutCapacity(0), wait(wait) {
+Command::ResultPin::ResultPin(Command const &command,
+    std::shared_ptr<Result const> result)
+    : command(command), previous(currentResultPin),
+    result(std::move(result)) {
+  currentResultPin = this;
+}
+
+Command::ResultPin::~ResultPin() {
+  currentResultPin = this->previous;
+}
+
+/**
+ * State of a run of a command with the wait flag set. The run completes once
+ * the child process has terminated, all output has been read, and all input
+ * has been written. Each of these operations stores its result in a field of
+ * its own and then calls completeRunOperation(...), so no further
+ * synchronization is needed.
+ */
+struct Command::RunState {
+  CompletionHandler completionHandler;
+  std::atomic<int> pendingOperations;
+  // The ID of the run, which is used when recording events in the run trace.
+  std::uint64_t runId;
+  // The operations reading the output store their data directly in the
+  // result. The exit code is set when the run completes.
+  Result result;
+  std::uint64_t sequenceNumber;
+  // The time when the creation of the child process started. It is the
+  // reference for the durations recorded in the statistics.
+  std::chrono::steady_clock::time_point startTime;
+  std::size_t stderrCapacity;
+  std::exception_ptr stderrError;
+  std::shared_ptr<OutputFile> stderrFile;
+  std::chrono::steady_clock::time_point stderrFirstDataTime;
+  std::exception_ptr stdinError;
+  std::size_t stdoutCapacity;
+  std::exception_ptr stdoutError;
+  std::shared_ptr<OutputFile> stdoutFile;
+  std::chrono::steady_clock::time_point stdoutFirstDataTime;
+  std::exception_ptr waitError;
+  int waitStatus = 0;
+};
+
+Command::Command(std::string const &commandPath, bool wait,
+    std::string const &name) :
+    bufferPool(new BufferPool(maxPooledBuffers)),
+    commandPath(commandPath), executionMode(ExecutionMode::process),
+    envVarsGeneration(0),
+    executorQueue(sharedThreadPoolExecutor().createQueue(
+        name.empty() ? commandPath : name)),
+    maxConcurrentRuns(1),
+    nextPublishedRun(0), nextRunSequenceNumber(0), publishing(false),
+    resultOrder(ResultOrder::completion),
+    result(std::make_shared<Result>()), runningCount(0),
+    spawnMethod(SpawnMethod::fork), spawnMethodSet(false), stderrCapacity(0),
+    stderrCaptureMode(CaptureMode::pipe),
+    stderrOverflowPolicy(OverflowPolicy::keepHead), stdoutCapacity(0),
+    stdoutCaptureMode(CaptureMode::pipe),
+    stdoutOverflowPolicy(OverflowPolicy::keepHead),
+    traceSource(RunTrace::getInstance().registerSource(
+        name.empty() ? commandPath : name)),
+    wait(wait) {
       // The first argument when executing the program is the path to the
       // executable itself.
-      arguments[0] = commandPath;
+      arguments.push_back(commandPath);
 }
 
 void Command::ensureStdErrCapacity(std::size_t capacity) {
@@ -596,251 +787,527 @@ void Command::ensureStdOutCapacity(std::size_t capacity) {
   this->stdoutCapacity = std::max(this->stdoutCapacity, capacity);
 }
 
+CaptureMode Command::getStdErrCaptureMode() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return this->stderrCaptureMode;
+}
+
+CaptureMode Command::getStdOutCaptureMode() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return this->stdoutCaptureMode;
+}
+
+OverflowPolicy Command::getStdErrOverflowPolicy() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return this->stderrOverflowPolicy;
+}
+
+OverflowPolicy Command::getStdOutOverflowPolicy() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return this->stdoutOverflowPolicy;
+}
+
+std::shared_ptr<LineStream> Command::getStdOutLineStream() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!this->wait) {
+    throw std::invalid_argument(
+        "Streaming stdout is only supported if the wait flag is set.");
+  }
+  if (!this->stdoutLineStream) {
+    this->stdoutLineStream = std::make_shared<LineStream>();
+  }
+  return this->stdoutLineStream;
+}
+
+std::shared_ptr<Supervisor> Command::getSupervisor() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return this->supervisor;
+}
+
+RunStatistics &Command::getStatistics() {
+  return this->statistics;
+}
+
+std::uint32_t Command::getTraceSource() const {
+  return this->traceSource;
+}
+
+ThreadPoolExecutor::Queue &Command::getExecutorQueue() const {
+  return this->executorQueue;
+}
+
+ExecutionMode Command::getExecutionMode() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return this->executionMode;
+}
+
 int Command::getExitCode() const {
+  return getResult()->exitCode;
+}
+
+int Command::getMaxConcurrentRuns() const {
   std::lock_guard<std::mutex> lock(mutex);
-  return this->exitCode;
+  return this->maxConcurrentRuns;
 }
 
-std::vector<char> Command::getStdErrBuffer() const {
+ResultOrder Command::getResultOrder() const {
   std::lock_guard<std::mutex> lock(mutex);
-  return this->stderrBuffer;
+  return this->resultOrder;
+}
+
+std::vector<char> Command::getStdErrBuffer() const {
+  auto result = getResult();
+  return std::vector<char>(result->getStdErrData(),
+      result->getStdErrData() + result->getStdErrSize());
 }
 
 std::vector<char> Command::getStdOutBuffer() const {
+  auto result = getResult();
+  return std::vector<char>(result->getStdOutData(),
+      result->getStdOutData() + result->getStdOutSize());
+}
+
+BufferPool::Statistics Command::getBufferPoolStatistics() const {
+  return this->bufferPool->getStatistics();
+}
+
+std::shared_ptr<Command::Result const> Command::getResult() const {
+  // A result pinned by the calling thread takes precedence over the result
+  // of the last run. A pin without a result does not hide the result.
+  for (auto pin = currentResultPin; pin; pin = pin->previous) {
+    if (&pin->command == this && pin->result) {
+      return pin->result;
+    }
+  }
   std::lock_guard<std::mutex> lock(mutex);
-  return this->stdoutBuffer;
+  return this->result;
+}
+
+SpawnMethod Command::getSpawnMethod() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return this->spawnMethodSet ? this->spawnMethod
+      : defaultSpawnMethod.load(std::memory_order_relaxed);
 }
 
 bool Command::isWait() const {
     return this->wait;
 }
 
+void Command::publishResult(std::uint64_t sequenceNumber, Result result,
+    CompletionHandler completionHandler, std::exception_ptr error) {
+  // We assume that the calling code did not take the mutex. Obviously, this
+  // will cause problems if it already took the mutex, because the mutex is not
+  // recursive. However, we only use this method internally, so in general, this
+  // assumption should be safe.
+  // The output is moved into the result, which is not copied afterwards. We
+  // create the result before taking the mutex, so that the allocation does
+  // not happen while holding it. When the result is not referenced any
+  // longer, its buffers are returned to the pool, so that the next run can
+  // use them. The pool might have been destroyed at this point (if the
+  // result is still used after this command has been destroyed), so we use a
+  // weak pointer.
+  std::weak_ptr<BufferPool> weakBufferPool = this->bufferPool;
+  std::shared_ptr<Result> sharedResult(new Result(std::move(result)),
+      [weakBufferPool](Result *unusedResult) {
+    auto bufferPool = weakBufferPool.lock();
+    if (bufferPool) {
+      bufferPool->release(std::move(unusedResult->stderrData));
+      bufferPool->release(std::move(unusedResult->stdoutData));
+    }
+    delete unusedResult;
+  });
+  this->statistics.addRun(error || sharedResult->exitCode != 0,
+      sharedResult->getStdErrSize() + sharedResult->getStdOutSize());
+  PendingResult pendingResult;
+  pendingResult.completionHandler = std::move(completionHandler);
+  pendingResult.error = error;
+  pendingResult.result = std::move(sharedResult);
+  std::unique_lock<std::mutex> lock(mutex);
+  if (this->resultOrder == ResultOrder::completion) {
+    this->publishableResults.push_back(std::move(pendingResult));
+  } else {
+    this->pendingResults.insert(
+        std::make_pair(sequenceNumber, std::move(pendingResult)));
+    // We can publish all results that are not waiting for an earlier run
+    // anymore.
+    while (!this->pendingResults.empty()
+        && this->pendingResults.begin()->first == this->nextPublishedRun) {
+      this->publishableResults.push_back(
+          std::move(this->pendingResults.begin()->second));
+      this->pendingResults.erase(this->pendingResults.begin());
+      ++this->nextPublishedRun;
+    }
+  }
+  // Only one thread publishes results at a time. This way, the result of a
+  // run stays visible while its completion handler is running, unless the
+  // handler passes control to another thread. If another thread is
+  // publishing results right now, it also publishes the results that we
+  // just added.
+  if (this->publishing) {
+    return;
+  }
+  this->publishing = true;
+  while (!this->publishableResults.empty()) {
+    auto nextResult = std::move(this->publishableResults.front());
+    this->publishableResults.pop_front();
+    this->result = nextResult.result;
+    // If this is the last result, we have to finish publishing before
+    // calling the completion handler: the handler might cause this command to
+    // be destroyed (e.g. when it completes a call to run()), so we must not
+    // access this object after calling it.
+    bool lastResult = this->publishableResults.empty();
+    if (lastResult) {
+      this->publishing = false;
+    }
+    // We call the completion handler without holding the mutex, so that it
+    // can access the result. The result is also passed to the handler,
+    // because other runs might publish their results before the handler
+    // gets to use it.
+    lock.unlock();
+    if (nextResult.completionHandler) {
+      nextResult.completionHandler(nextResult.error,
+          std::move(nextResult.result));
+    }
+    if (lastResult) {
+      return;
+    }
+    lock.lock();
+  }
+  this->publishing = false;
+}
+
 void Command::run() {
-  RunningFlagGuard runningFlagGuard(running, mutex, !wait);
-  std::vector<std::string> cmdArgs;
-  std::vector<std::string> cmdEnv;
-  std::vector<char> stdinBuffer;
+  // The promise is referenced through a shared pointer, because the
+  // completion handler might still be running when get() returns.
+  auto promise = std::make_shared<std::promise<void>>();
+  auto future = promise->get_future();
+  runAsync([promise](std::exception_ptr error,
+      std::shared_ptr<Result const>) {
+    if (error) {
+      promise->set_exception(error);
+    } else {
+      promise->set_value();
+    }
+  });
+  future.get();
+}
+
+void Command::runAsync(CompletionHandler completionHandler,
+    std::uint64_t runId) {
+  RunningCountGuard runningCountGuard(runningCount, maxConcurrentRuns, mutex,
+      !wait);
+  bool useCoprocess;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    useCoprocess = this->executionMode == ExecutionMode::coprocess;
+  }
+  if (useCoprocess) {
+    runCoprocessAsync(std::move(completionHandler));
+    // The completion of the run is signaled asynchronously, so the running
+    // count is decremented when the run completes.
+    runningCountGuard.release();
+    return;
+  }
+  std::shared_ptr<PreparedArguments const> cmdArgs;
+  std::shared_ptr<PreparedEnvironment const> cmdEnv;
+  std::shared_ptr<SealedBuffer const> stdinBuffer;
   std::size_t stderrCapacity;
+  CaptureMode stderrCaptureMode;
+  OverflowPolicy stderrOverflowPolicy;
   std::size_t stdoutCapacity;
+  CaptureMode stdoutCaptureMode;
+  std::shared_ptr<LineStream> stdoutLineStream;
+  OverflowPolicy stdoutOverflowPolicy;
+  SpawnMethod spawnMethod;
   {
     std::lock_guard<std::mutex> lock(mutex);
-    cmdArgs = prepareArguments(this->arguments);
-    cmdEnv = prepareEnvironment(this->envVars);
+    cmdArgs = getPreparedArguments();
+    cmdEnv = getPreparedEnvironment();
     stdinBuffer = this->stdinBuffer;
     stderrCapacity = this->stderrCapacity;
+    stderrCaptureMode = this->stderrCaptureMode;
+    stderrOverflowPolicy = this->stderrOverflowPolicy;
     stdoutCapacity = this->stdoutCapacity;
+    stdoutCaptureMode = this->stdoutCaptureMode;
+    stdoutLineStream = this->stdoutLineStream;
+    stdoutOverflowPolicy = this->stdoutOverflowPolicy;
+    spawnMethod = this->spawnMethodSet ? this->spawnMethod
+        : defaultSpawnMethod.load(std::memory_order_relaxed);
   }
-  // The pointers stored in the following two vectors are only valid as long as
-  // the original vectors exist and have not been changed. This is okay, because
-  // we only need them inside this function.
-  auto cmdArgsNullTerminated = viewAsCStrings(cmdArgs);
-  auto cmdEnvNullTerminated = viewAsCStrings(cmdEnv);
-  // Prepare a shared memory region that we can use to get status information
-  // from the child. We use this to get information about a problem that happens
-  // after forking, but before the command is successfully executed.
-  SharedData<ChildProcessStatus> childProcessStatus;
-  // We need a pipe for the standard input. If the buffer providing the input is
-  // empty, the pipes are not actually created, so we can always create the
-  // object.
-  PreFilledPipe stdinPipe(stdinBuffer);
-  // We need two pipes for the standard output and error output. If the capacity
-  // is zero, the pipes are not actually created, so we can always create the
-  // objects.
-  AccumulatingPipe stderrPipe(stderrCapacity);
-  AccumulatingPipe stdoutPipe(stdoutCapacity);
+  // We need a memory file or a pipe for the standard input. If the buffer
+  // providing the input is empty, neither is actually created, so we can
+  // always create the object.
+  PreFilledInput stdinInput(stdinBuffer);
+  // When capturing the output in a file, the child process writes directly to
+  // a memory file, which is only read after the child process has terminated.
+  // The line stream needs the data while the child process is running, so
+  // in this case, the standard output is always read from a pipe.
+  auto stderrFile = createOutputFile(stderrCaptureMode, stderrCapacity);
+  auto stdoutFile = createOutputFile(
+      stdoutLineStream ? CaptureMode::pipe : stdoutCaptureMode,
+      stdoutCapacity);
+  // Otherwise, we need two pipes for the standard output and error output. If
+  // the capacity is zero (and there is no line stream), the pipes are not
+  // actually created, so we can always create the objects.
+  AccumulatingPipe stderrPipe(stderrFile ? 0 : stderrCapacity,
+      stderrOverflowPolicy, this->bufferPool.get(),
+      std::shared_ptr<LineStream>());
+  AccumulatingPipe stdoutPipe(stdoutFile ? 0 : stdoutCapacity,
+      stdoutOverflowPolicy, this->bufferPool.get(), stdoutLineStream);
   // The sysconf function is not guaranteed to be async-signal-safe since
   // POSIX.1-2008 (in previous versions this guarantee existed), so we call
-  // sysconf before calling fork.
+  // sysconf before creating the child process.
   int maxFd = ::sysconf(_SC_OPEN_MAX);
   if (maxFd == -1) {
     throw std::system_error(
         std::error_code(errno, std::system_category()),
         "sysconf(_SC_OPEN_MAX) failed");
   }
-  auto childPid = ::fork();
-  if (childPid == 0) {
-    // This code runs in the newly created child process.
-    // There is no platform-independent way for closing all open file
-    // descriptors, so we only close stdin, stdout, and stderr and assume that
-    // other file descriptors that are open have been opened with the O_CLOEXEC
-    // flag.
-    // We deliberately ignore the return value because it is not a problem if
-    // the specified file descriptor was not open.
-    ::close(STDIN_FILENO);
-    ::close(STDOUT_FILENO);
-    ::close(STDERR_FILENO);
-    // If we do not use a pipe for all of the three standard file descriptors,
-    // we want to bind them to /dev/null. This ensures that the respective file
-    // descriptor is not accidentally bound to some other file, which could
-    // have unintended effects when the executed program tries to use them (e.g.
-    // by calling printf).
-    // If there is a pipe for stdin, we have to change the file descriptor
-    // number so that it is actually used as stdin.
-    if (!stdinBuffer.empty()) {
-      int stdinFd = stdinPipe.transferReadFd();
-      if (stdinFd != STDIN_FILENO) {
-        ::dup2(stdinFd, STDIN_FILENO);
-        ::close(stdinFd);
-      }
-    } else {
-      int stdinFd = ::open("/dev/null", O_RDONLY);
-      if (stdinFd != -1 && stdinFd != STDIN_FILENO) {
-        ::dup2(stdinFd, STDIN_FILENO);
-        ::close(stdinFd);
-      }
+  SpawnParameters spawnParameters;
+  spawnParameters.path = commandPath.c_str();
+  // The prepared arguments and environment are never modified, and we keep
+  // them through cmdArgs and cmdEnv until this function returns, so the
+  // pointers stay valid while the child process is created.
+  spawnParameters.argv = cmdArgs->argv.data();
+  spawnParameters.envp = cmdEnv->envp.data();
+  // If we do not use a pipe for all of the three standard file descriptors,
+  // the respective file descriptor is -1, which means that it is bound to
+  // /dev/null. This ensures that the respective file descriptor is not
+  // accidentally bound to some other file, which could have unintended effects
+  // when the executed program tries to use them (e.g. by calling printf).
+  spawnParameters.stdinFd = stdinInput.getReadFd();
+  spawnParameters.stdoutFd = stdoutFile ? stdoutFile->getFd()
+      : stdoutPipe.getWriteFd();
+  spawnParameters.stderrFd = stderrFile ? stderrFile->getFd()
+      : stderrPipe.getWriteFd();
+  spawnParameters.maxFd = maxFd;
+  // If the wait flag is set, the run completes once all four operations
+  // (reaping the child process, reading stdout and stderr, and writing stdin)
+  // have completed. If it is not set, we still have to reap the child process
+  // and write stdin, but we are not interested in the result.
+  auto &trace = RunTrace::getInstance();
+  auto traceSource = this->traceSource;
+  if (!runId) {
+    runId = trace.createRunId();
+  }
+  std::shared_ptr<RunState> state;
+  std::shared_ptr<ChildProcessHandle> child;
+  ChildTerminationHandler terminationHandler;
+  if (wait) {
+    state = std::make_shared<RunState>();
+    state->completionHandler = std::move(completionHandler);
+    state->runId = runId;
+    state->result = makeResult(0);
+    state->result.stderrOverflowPolicy = stderrOverflowPolicy;
+    state->result.stdoutOverflowPolicy = stdoutOverflowPolicy;
+    state->stderrCapacity = stderrCapacity;
+    state->stderrFile = stderrFile;
+    state->stdoutCapacity = stdoutCapacity;
+    state->stdoutFile = stdoutFile;
+    // The sequence number defines the order in which results are published
+    // if they are published in submission order. From here on, we have to
+    // publish a result for this sequence number, even if the run fails.
+    // Otherwise, the results of all later runs would be held back forever.
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      state->sequenceNumber = this->nextRunSequenceNumber++;
     }
-    // If there are pipes for stdout and stderr, we have to change the file
-    // descriptor numbers so that they are actually used as stdout and stderr.
-    if (stdoutCapacity) {
-      int stdoutFd = stdoutPipe.transferWriteFd();
-      if (stdoutFd != STDOUT_FILENO) {
-        ::dup2(stdoutFd, STDOUT_FILENO);
-        ::close(stdoutFd);
-      }
-    } else {
-      int stdoutFd = ::open("/dev/null", O_WRONLY);
-      if (stdoutFd != -1 && stdoutFd != STDOUT_FILENO) {
-        ::dup2(stdoutFd, STDOUT_FILENO);
-        ::close(stdoutFd);
-      }
+    state->pendingOperations.store(4, std::memory_order_relaxed);
+    // The handlers reading the output might have to kill the child process.
+    // They must not do this once the child process has been reaped, so the
+    // termination handler marks it as reaped first.
+    child = std::make_shared<ChildProcessHandle>();
+    terminationHandler = [this, state, child](int waitStatus,
+        std::exception_ptr error) {
+      child->markReaped();
+      EPICS_EXEC_PROBE2(reap, state->runId, waitStatus);
+      RunTrace::getInstance().record(this->traceSource, state->runId,
+          RunTrace::Event::reap);
+      state->waitStatus = waitStatus;
+      state->waitError = error;
+      completeRunOperation(*state);
+    };
+  } else {
+    terminationHandler = [traceSource, runId](int waitStatus,
+        std::exception_ptr) {
+      EPICS_EXEC_PROBE2(reap, runId, waitStatus);
+      RunTrace::getInstance().record(traceSource, runId,
+          RunTrace::Event::reap);
+    };
+  }
+  ::pid_t childPid;
+  int execveErrorNumber;
+  // If the fork server is running, we use it for creating the child process.
+  // Otherwise (or if it cannot handle the request), we create the child
+  // process ourselves.
+  bool spawnedByForkServer;
+  auto startTime = std::chrono::steady_clock::now();
+  if (wait) {
+    state->startTime = startTime;
+  }
+  trace.record(traceSource, runId, RunTrace::Event::fork, startTime);
+  EPICS_EXEC_PROBE2(spawn_begin, runId, commandPath.c_str());
+  try {
+    spawnedByForkServer = ForkServer::getInstance().spawn(spawnParameters,
+        childPid, execveErrorNumber, terminationHandler);
+    if (!spawnedByForkServer) {
+      childPid = spawnProcess(spawnMethod, spawnParameters,
+          execveErrorNumber);
     }
-    if (stderrCapacity) {
-      int stderrFd = stderrPipe.transferWriteFd();
-      if (stderrFd != STDERR_FILENO) {
-        ::dup2(stderrFd, STDERR_FILENO);
-        ::close(stderrFd);
-      }
-    } else {
-      int stderrFd = ::open("/dev/null", O_WRONLY);
-      if (stderrFd != -1 && stderrFd != STDERR_FILENO) {
-        ::dup2(stderrFd, STDERR_FILENO);
-        ::close(stderrFd);
-      }
+    // Both methods only return once the program has been executed (or
+    // execve() has failed), so this is the time needed for spawning.
+    auto spawnedTime = std::chrono::steady_clock::now();
+    this->statistics.addDuration(RunStatistics::Phase::spawn,
+        spawnedTime - startTime);
+    if (!execveErrorNumber) {
+      trace.record(traceSource, runId, RunTrace::Event::exec, spawnedTime);
     }
-    // We close all unused file descriptors. We do not want the child process to
-    // have access to any file descriptors that do not have the close-on-exec
-    // flag set. First of all, this might give the child process access to
-    // things that it should not be able to access, but more importantly due to
-    // this process being multi-threaded, there is no reliable way of always
-    // setting the close-on-exec flag, and leaking pipes intended for other
-    // child processes into the wrong child process can cause the pipe not to be
-    // closed when the child process quits, causing a thread that is trying to
-    // read from that pipe to hang longer than necessary.
-    for (int fd = 0; fd <= maxFd; ++fd) {
-      if (fd == STDIN_FILENO || fd == STDOUT_FILENO || fd == STDERR_FILENO) {
-        continue;
-      }
-      ::close(fd);
-    }
-    // The EPICS IOC blocks a few signals. We do not want these signals to be
-    // blocked for the child process, so we unblock all signals. If sigfillset
-    // fails (which is extremely unlikely), we do not call sigprocmask. If
-    // sigprocmask fails, we ignore this and continue with the signal mask from
-    // EPICS.
-    ::sigset_t signalSet;
-    // We cannot use the qualified form for sigfillset, because it is a
-    // preprocessor macro on some platforms.
-    if (!sigfillset(&signalSet)) {
-      ::sigprocmask(SIG_UNBLOCK, &signalSet, nullptr);
-    }
-    // We also reset all signal handlers to SIG_DFL, because the process may
-    // have inherited signals where the handler has been set to SIG_IGN.
-    // Again, we ignore any errors.
-    struct sigaction signalAction;
-    ::memset(&signalAction, 0, sizeof(signalAction));
-    signalAction.sa_handler = SIG_DFL;
-    for (int signalNumber = 0; signalNumber < NSIG; ++signalNumber) {
-      ::sigaction(signalNumber, &signalAction, nullptr);
-    }
-    // Using a const cast here is not really clean, but it should be okay
-    // because usually execve does not return and if it returns, we are not
-    // going to use the data structures any longer.
-    int execveStatus = ::execve(commandPath.c_str(),
-        const_cast<char * const *>(cmdArgsNullTerminated.data()),
-        const_cast<char * const *>(cmdEnvNullTerminated.data()));
-    // On success, the call to execve does not return. If it returns, there
-    // must be a problem. We write the information about the error into the
-    // shared data structure. After the child process has terminated, the parent
-    // process can read it from there.
-    childProcessStatus->execveStatus = execveStatus;
-    childProcessStatus->errorNumber = errno;
-    // Now we kill the child process.
-    ::_exit(-1);
-  } else if (childPid == -1) {
-    // The call to fork failed and no child process was created.
-    // errno may be a preprocessor macro, so we cannot use the qualified form.
-    std::system_error e(std::error_code(errno, std::system_category()),
-        "fork() failed");
-    // If the wait flag is set, we update the exit code to reflect the problem.
-    // We do not do this if the wait flag is not set because we would not update
-    // it in the regular case either.
+    EPICS_EXEC_PROBE2(spawn_end, runId, childPid);
+  } catch (...) {
+    // No child process was created. If the wait flag is set, we update the
+    // exit code to reflect the problem. We do not do this if the wait flag is
+    // not set because we would not update it in the regular case either.
     if (wait) {
-      // updateResultState takes the mutex, so we must not take it here.
-      updateResultState(exitCodeSystemError);
+      // publishResult takes the mutex, so we must not take it here.
+      publishResult(state->sequenceNumber,
+          makeResult(exitCodeSystemError));
     }
-    throw e;
-  } else {
-    // The call to fork was successful and this code runs in the
-    // parent process.
+    throw;
+  }
+  if (execveErrorNumber) {
+    EPICS_EXEC_PROBE2(exec_failed, runId, execveErrorNumber);
+    // If execve() failed, the child process has already been reaped. We only
+    // report the error if the wait flag is set, because the calling code does
+    // not expect run() to report problems that occur after the child process
+    // has been created otherwise.
     if (wait) {
-      auto stderrFuture = stderrPipe.readDataAsync();
-      auto stdoutFuture = stdoutPipe.readDataAsync();
-      auto stdinFuture = stdinPipe.writeDataAsync();
-      int childStatus;
-      if (::waitpid(childPid, &childStatus, 0) == childPid) {
-        // If the execve call was successful, the corresponding status code in
-        // the shared data structure must be zero. Otherwise, the error number
-        // should also have been set and we throw an exception.
-        if (childProcessStatus->execveStatus) {
-          // updateResultState takes the mutex, so we must not take it here.
-          updateResultState(exitCodeSystemError);
-          throw std::system_error(
-              std::error_code(childProcessStatus->errorNumber,
-                  std::system_category()),
-              "execve() failed");
+      // publishResult takes the mutex, so we must not take it here.
+      publishResult(state->sequenceNumber,
+          makeResult(exitCodeSystemError));
+      throw std::system_error(
+          std::error_code(execveErrorNumber, std::system_category()),
+          "execve() failed");
+    }
+    completionHandler(std::exception_ptr(), std::shared_ptr<Result const>());
+    return;
+  }
+  // A pidfd is only needed if the child process might have to be killed
+  // because it writes too much output. Without a pidfd, a child process that
+  // has been created by the fork server is not killed, because it is reaped
+  // by the fork server, so its PID might already refer to another process.
+  if (wait) {
+    child->setPid(childPid,
+        (stderrPipe.getWriteFd() != -1
+            && stderrOverflowPolicy == OverflowPolicy::kill)
+        || (stdoutPipe.getWriteFd() != -1
+            && stdoutOverflowPolicy == OverflowPolicy::kill),
+        spawnedByForkServer);
+  }
+  // From here on, the completion of the run is signaled asynchronously, so
+  // the running count is decremented when the run completes.
+  runningCountGuard.release();
+  // The child process has been created successfully. Unless it has been
+  // created by the fork server (which reaps it and calls the termination
+  // handler), we have to reap it. Otherwise, the child process would stay as
+  // a zombie process until the whole IOC terminates.
+  if (!spawnedByForkServer) {
+    try {
+      ChildReaper::getInstance().watch(childPid, terminationHandler);
+    } catch (...) {
+      // If the child process cannot be watched (e.g. because this process
+      // has reached the limit for open file descriptors), we fall back to
+      // waiting for it in a thread.
+      sharedThreadPoolExecutor().submit(this->executorQueue,
+          [child, childPid, terminationHandler]() {
+        // We wait without reaping the child process first, so that its PID
+        // cannot be reused before the handlers reading the output know that
+        // they must not kill it any longer.
+        if (child) {
+          ::siginfo_t info;
+          while (::waitid(P_PID, childPid, &info, WEXITED | WNOWAIT) == -1
+              && errno == EINTR) {
+          }
+          child->markReaped();
         }
-        // WIFEXITED and WIFSIGNALED are preprocessor macros.
-        if (WIFEXITED(childStatus)) {
-          int exitCode = WEXITSTATUS(childStatus);
-          // updateResultState takes the mutex, so we must not take it here.
-          updateResultState(exitCode, stdoutFuture.get(), stderrFuture.get());
-        } else if (WIFSIGNALED(childStatus)) {
-          // updateResultState takes the mutex, so we must not take it here.
-          updateResultState(exitCodeKilledBySignal, stdoutFuture.get(),
-              stderrFuture.get());
+        int waitStatus;
+        if (::waitpid(childPid, &waitStatus, 0) == childPid) {
+          terminationHandler(waitStatus, std::exception_ptr());
         } else {
-          // updateResultState takes the mutex, so we must not take it here.
-          updateResultState(exitCodeSystemError, stdoutFuture.get(),
-              stderrFuture.get());
-          throw std::logic_error(
-            "waitpid() returned an unexpected child status.");
+          terminationHandler(0, std::make_exception_ptr(std::system_error(
+              std::error_code(errno, std::system_category()),
+              "waitpid() failed")));
         }
-        // We also check whether the write thread (supplying data to stdin of
-        // the command) was successful. Calling the future's get method is
-        // sufficient for throwing an exception that may have been thrown in
-        // that thread.
-        stdinFuture.get();
-      } else {
-        std::system_error e(std::error_code(errno, std::system_category()),
-            "waitpid() failed");
-        // updateResultState takes the mutex, so we must not take it here.
-        updateResultState(exitCodeSystemError);
-        throw e;
-      }
-    } else {
-      // If we do not wait for the command execution to complete, we simply call
-      // writeDataAsyncAndWaitForPid() without waiting for the returned future.
-      // The writeDataAsyncAndWaitForPid function spawns a background thread
-      // that owns the necessary data, so it is safe to destroy stdinPipe when
-      // leaving this block, even if the execution has not finished yet.
-      // Not that we use writeDataAsyncAndWaitForPid() instead of
-      // writeDataAsync() here. As we do not wait in this thread for the child
-      // process to terminate, we have to do this in the spawned thread.
-      // Otherwise, the child process would never be reaped after terminating
-      // and stay as a zombie process until the whole IOC terminates.
-      stdinPipe.writeDataAsyncAndWaitForPid(childPid);
+      });
     }
   }
+  if (wait) {
+    // The handlers are registered with the I/O reactor, which owns the
+    // necessary data, so it is safe to destroy the pipe objects when leaving
+    // this method, even if the execution has not finished yet. If a handler
+    // cannot be registered, we still have to count the operation as complete,
+    // so that the run completes once the child process has terminated. The
+    // end of the output is only recorded in the run trace for streams that
+    // are actually read through a pipe.
+    try {
+      bool stderrPiped = stderrPipe.getWriteFd() != -1;
+      stderrPipe.readDataAsync([this, state, stderrPiped](
+          std::vector<char> data, std::size_t discardedBytes,
+          std::chrono::steady_clock::time_point firstDataTime,
+          std::exception_ptr error) {
+        state->result.stderrData = std::move(data);
+        state->result.stderrDiscardedBytes = discardedBytes;
+        state->stderrFirstDataTime = firstDataTime;
+        state->stderrError = error;
+        if (stderrPiped) {
+          RunTrace::getInstance().record(this->traceSource, state->runId,
+              RunTrace::Event::eof);
+        }
+        completeRunOperation(*state);
+      }, child);
+    } catch (...) {
+      state->stderrError = std::current_exception();
+      completeRunOperation(*state);
+    }
+    try {
+      bool stdoutPiped = stdoutPipe.getWriteFd() != -1;
+      stdoutPipe.readDataAsync([this, state, stdoutPiped](
+          std::vector<char> data, std::size_t discardedBytes,
+          std::chrono::steady_clock::time_point firstDataTime,
+          std::exception_ptr error) {
+        state->result.stdoutData = std::move(data);
+        state->result.stdoutDiscardedBytes = discardedBytes;
+        state->stdoutFirstDataTime = firstDataTime;
+        state->stdoutError = error;
+        if (stdoutPiped) {
+          RunTrace::getInstance().record(this->traceSource, state->runId,
+              RunTrace::Event::eof);
+        }
+        completeRunOperation(*state);
+      }, child);
+    } catch (...) {
+      state->stdoutError = std::current_exception();
+      completeRunOperation(*state);
+    }
+    try {
+      stdinInput.writeDataAsync([this, state](std::exception_ptr error) {
+        state->stdinError = error;
+        completeRunOperation(*state);
+      });
+    } catch (...) {
+      state->stdinError = std::current_exception();
+      completeRunOperation(*state);
+    }
+  } else {
+    // If we do not wait for the command execution to complete, we still write
+    // the input, but we are not interested in the result. If the handler
+    // cannot be registered, the pipe is closed when leaving this method, so
+    // the child process sees the end of its input.
+    try {
+      stdinInput.writeDataAsync([](std::exception_ptr) {});
+    } catch (...) {
+    }
+    completionHandler(std::exception_ptr(), std::shared_ptr<Result const>());
+  }
 }
 
 void Command::setArgument(int index, std::string const &value) {
@@ -849,31 +1316,378 @@ void Command::setArgument(int index, std::string const &value) {
       "Command argument index must be greater than zero.");
   }
   std::lock_guard<std::mutex> lock(mutex);
+  // Arguments with a lower index that have not been set are empty strings.
+  // Growing the vector changes the number of arguments, so this always
+  // invalidates the prepared arguments.
+  if (static_cast<std::size_t>(index) >= this->arguments.size()) {
+    this->arguments.resize(index + 1);
+  } else if (this->arguments[index] == value) {
+    // Records usually write the same value again and again. If the value does
+    // not change, the prepared arguments can still be used.
+    return;
+  }
   this->arguments[index] = value;
+  this->preparedArguments.reset();
+}
+
+void Command::setExecutionMode(ExecutionMode mode) {
+  if (mode == ExecutionMode::coprocess && !this->wait) {
+    throw std::invalid_argument(
+        "The coprocess mode is only supported if the wait flag is set.");
+  }
+  // Destroying the coprocess closes its standard input, so the program
+  // terminates. We do this after releasing the mutex, so that we do not hold
+  // it while taking the coprocess's mutex.
+  std::unique_ptr<Coprocess> oldCoprocess;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (mode == ExecutionMode::coprocess && this->supervisor) {
+    throw std::invalid_argument(
+        "The coprocess mode is not supported for a supervised command.");
+  }
+  if (this->runningCount || !this->pendingResults.empty()
+      || this->publishing) {
+    throw std::invalid_argument(
+        "The execution mode cannot be changed while the command is running.");
+  }
+  this->executionMode = mode;
+  if (mode == ExecutionMode::coprocess) {
+    if (!this->coprocess) {
+      this->coprocess.reset(new Coprocess(this->commandPath));
+    }
+  } else {
+    oldCoprocess = std::move(this->coprocess);
+  }
+}
+
+void Command::setConcurrency(int maxConcurrentRuns,
+    ResultOrder resultOrder) {
+  if (maxConcurrentRuns < 1) {
+    throw std::invalid_argument(
+        "The maximum number of concurrent runs must be at least one.");
+  }
+  if (maxConcurrentRuns > 1 && !this->wait) {
+    throw std::invalid_argument(
+        "Limiting concurrent runs is only supported if the wait flag is set.");
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  // If we changed the result order while runs are active, the results of
+  // those runs might never be published, so we do not allow this.
+  if (this->runningCount || !this->pendingResults.empty()
+      || this->publishing) {
+    throw std::invalid_argument(
+        "The concurrency cannot be changed while the command is running.");
+  }
+  this->maxConcurrentRuns = maxConcurrentRuns;
+  this->resultOrder = resultOrder;
+  // All runs that were started before have been published, so the next run
+  // is the next one to be published.
+  this->nextPublishedRun = this->nextRunSequenceNumber;
+}
+
+void Command::setDefaultSpawnMethod(SpawnMethod method) {
+  defaultSpawnMethod.store(method, std::memory_order_relaxed);
 }
 
 void Command::setEnvVar(std::string const &name, std::string const &value) {
   std::lock_guard<std::mutex> lock(mutex);
+  // If the value does not change, we do not increment the generation, so
+  // that the prepared environment does not have to be rebuilt. This is
+  // important because records usually write the same value again and again.
+  auto envVar = this->envVars.find(name);
+  if (envVar != this->envVars.end() && envVar->second == value) {
+    return;
+  }
   this->envVars[name] = value;
+  ++this->envVarsGeneration;
 }
 
-void Command::setStdInBuffer(std::vector<char> const &buffer) {
+void Command::setSpawnMethod(SpawnMethod method) {
   std::lock_guard<std::mutex> lock(mutex);
-  this->stdinBuffer = buffer;
+  this->spawnMethod = method;
+  this->spawnMethodSet = true;
 }
 
-void Command::updateResultState(int exitCode, std::vector<char> stdoutBuffer,
-    std::vector<char> stderrBuffer) {
-  // We assume that the calling code did not take the mutex. Obviously, this
-  // will cause problems if it already took the mutex, because the mutex is not
-  // recursive. However, we only use this method internally, so in general, this
-  // assumption should be safe.
+void Command::setStdErrCaptureMode(CaptureMode captureMode) {
+  std::lock_guard<std::mutex> lock(mutex);
+  // In file mode, the output is only inspected after the program has
+  // terminated, so the program could not be killed and the memory file could
+  // grow without bounds, although the user asked for the output to be limited.
+  if (captureMode == CaptureMode::file
+      && this->stderrOverflowPolicy == OverflowPolicy::kill) {
+    throw std::invalid_argument(
+        "The file capture mode cannot be used with the kill overflow policy.");
+  }
+  this->stderrCaptureMode = captureMode;
+}
+
+void Command::setStdOutCaptureMode(CaptureMode captureMode) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (captureMode == CaptureMode::file
+      && this->stdoutOverflowPolicy == OverflowPolicy::kill) {
+    throw std::invalid_argument(
+        "The file capture mode cannot be used with the kill overflow policy.");
+  }
+  this->stdoutCaptureMode = captureMode;
+}
+
+void Command::setStdErrOverflowPolicy(OverflowPolicy policy) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (policy == OverflowPolicy::kill
+      && this->stderrCaptureMode == CaptureMode::file) {
+    throw std::invalid_argument(
+        "The kill overflow policy cannot be used with the file capture mode.");
+  }
+  this->stderrOverflowPolicy = policy;
+}
+
+void Command::setStdOutOverflowPolicy(OverflowPolicy policy) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (policy == OverflowPolicy::kill
+      && this->stdoutCaptureMode == CaptureMode::file) {
+    throw std::invalid_argument(
+        "The kill overflow policy cannot be used with the file capture mode.");
+  }
+  this->stdoutOverflowPolicy = policy;
+}
+
+void Command::setStdInBuffer(char const *data, std::size_t size) {
+  // We copy the data before taking the mutex, so that a large buffer does not
+  // block runs that are started concurrently.
+  std::shared_ptr<SealedBuffer const> buffer;
+  if (size != 0) {
+    buffer = std::make_shared<SealedBuffer>(data, size);
+  }
+  // The old buffer might still be used by a run, so we only release our
+  // reference. It is destroyed (outside the mutex) when the last run using it
+  // has completed.
+  std::lock_guard<std::mutex> lock(mutex);
+  this->stdinBuffer.swap(buffer);
+}
+
+void Command::setStdInBuffer(std::vector<char> const &buffer) {
+  setStdInBuffer(buffer.data(), buffer.size());
+}
+
+std::shared_ptr<Supervisor> Command::supervise() {
   std::lock_guard<std::mutex> lock(mutex);
-  this->exitCode = exitCode;
-  this->stderrBuffer = stderrBuffer;
-  this->stdoutBuffer = stdoutBuffer;
+  if (!this->wait) {
+    throw std::invalid_argument(
+        "Supervising a command is only supported if the wait flag is set.");
+  }
+  if (this->executionMode == ExecutionMode::coprocess) {
+    throw std::invalid_argument(
+        "Supervising a command is not supported in coprocess mode.");
+  }
+  if (!this->supervisor) {
+    this->supervisor = std::make_shared<Supervisor>(*this);
+  }
+  return this->supervisor;
 }
 
+void Command::runCoprocessAsync(CompletionHandler completionHandler) {
+  Coprocess::Request request;
+  SpawnMethod spawnMethod;
+  std::uint64_t sequenceNumber;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    // Argument zero is the path of the program, which is not part of the
+    // request.
+    request.arguments.assign(this->arguments.begin() + 1,
+        this->arguments.end());
+    request.envVars = this->envVars;
+    request.stderrCapacity = this->stderrCapacity;
+    request.stdinData = this->stdinBuffer;
+    request.stdoutCapacity = this->stdoutCapacity;
+    spawnMethod = this->spawnMethodSet ? this->spawnMethod
+        : defaultSpawnMethod.load(std::memory_order_relaxed);
+    // From here on, we have to publish a result for this sequence number,
+    // even if the run fails (see runAsync).
+    sequenceNumber = this->nextRunSequenceNumber++;
+  }
+  // The environment is only needed when the program has to be started. It is
+  // prepared while holding the mutex, so that it reflects the environment
+  // variables that are set at that point in time.
+  auto environmentProvider = [this]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return getPreparedEnvironment()->entries;
+  };
+  // The response handler is only called once, so it can use the completion
+  // handler through a shared pointer without copying it.
+  auto sharedCompletionHandler = std::make_shared<CompletionHandler>(
+      std::move(completionHandler));
+  try {
+    this->coprocess->sendRequest(std::move(request), spawnMethod,
+        environmentProvider, [this, sequenceNumber, sharedCompletionHandler](
+            Coprocess::Response response, std::exception_ptr error) {
+      // Like in completeRun, we decrement the running count before
+      // publishing the result.
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        --this->runningCount;
+      }
+      if (error) {
+        publishResult(sequenceNumber, makeResult(exitCodeSystemError),
+            std::move(*sharedCompletionHandler), error);
+        return;
+      }
+      // The coprocess always keeps the data that was sent first.
+      auto result = makeResult(response.status);
+      result.stderrData = std::move(response.stderrData);
+      result.stderrDiscardedBytes = response.stderrDiscardedBytes;
+      result.stdoutData = std::move(response.stdoutData);
+      result.stdoutDiscardedBytes = response.stdoutDiscardedBytes;
+      publishResult(sequenceNumber, std::move(result),
+          std::move(*sharedCompletionHandler));
+    });
+  } catch (...) {
+    // publishResult takes the mutex, so we must not take it here.
+    publishResult(sequenceNumber, makeResult(exitCodeSystemError));
+    throw;
+  }
+}
+
+void Command::completeRun(RunState &state) {
+  int exitCode;
+  std::exception_ptr error;
+  if (state.waitError) {
+    // If we could not get the status of the child process, we cannot know
+    // whether the output is complete.
+    exitCode = exitCodeSystemError;
+    error = state.waitError;
+  } else if (state.stdoutError || state.stderrError) {
+    exitCode = exitCodeSystemError;
+    error = state.stdoutError ? state.stdoutError : state.stderrError;
+  } else if (WIFEXITED(state.waitStatus)) {
+    // WIFEXITED and WIFSIGNALED are preprocessor macros.
+    exitCode = WEXITSTATUS(state.waitStatus);
+  } else if (WIFSIGNALED(state.waitStatus)) {
+    exitCode = exitCodeKilledBySignal;
+  } else {
+    exitCode = exitCodeSystemError;
+    error = std::make_exception_ptr(std::logic_error(
+        "waitpid() returned an unexpected child status."));
+  }
+  // If the output has been captured in memory files, we can map them now
+  // because the child process has terminated.
+  if (!state.waitError) {
+    try {
+      if (state.stderrFile) {
+        state.result.stderrDiscardedBytes = state.stderrFile->map(
+            state.stderrCapacity, state.result.stderrOverflowPolicy);
+        state.result.stderrFile = std::move(state.stderrFile);
+      }
+      if (state.stdoutFile) {
+        state.result.stdoutDiscardedBytes = state.stdoutFile->map(
+            state.stdoutCapacity, state.result.stdoutOverflowPolicy);
+        state.result.stdoutFile = std::move(state.stdoutFile);
+      }
+    } catch (...) {
+      exitCode = exitCodeSystemError;
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  // We also report a problem with writing the input data (supplying data to
+  // stdin of the command), but only after updating the result state.
+  if (!error) {
+    error = state.stdinError;
+  }
+  // We decrement the running count before publishing the result, because
+  // publishing the result might be delayed until other runs have completed,
+  // and there is no reason for not starting another run in the meantime.
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    --this->runningCount;
+  }
+  state.result.exitCode = exitCode;
+  EPICS_EXEC_PROBE2(exit_status, state.runId, exitCode);
+  // The run counters are updated when the result is published, but the
+  // durations are only known here.
+  auto now = std::chrono::steady_clock::now();
+  this->statistics.addDuration(RunStatistics::Phase::wall,
+      now - state.startTime);
+  auto firstDataTime = state.stdoutFirstDataTime;
+  if (firstDataTime == std::chrono::steady_clock::time_point()
+      || (state.stderrFirstDataTime != std::chrono::steady_clock::time_point()
+          && state.stderrFirstDataTime < firstDataTime)) {
+    firstDataTime = state.stderrFirstDataTime;
+  }
+  if (firstDataTime != std::chrono::steady_clock::time_point()) {
+    this->statistics.addDuration(RunStatistics::Phase::firstOutput,
+        firstDataTime - state.startTime);
+    RunTrace::getInstance().record(this->traceSource, state.runId,
+        RunTrace::Event::firstByte, firstDataTime);
+  }
+  publishResult(state.sequenceNumber, std::move(state.result),
+      std::move(state.completionHandler), error);
+}
+
+void Command::completeRunOperation(RunState &state) {
+  // The thread completing the last operation completes the run. The
+  // acquire-release semantics ensure that this thread sees the results
+  // stored by the other operations.
+  if (state.pendingOperations.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    completeRun(state);
+  }
+}
+
+std::shared_ptr<Command::PreparedArguments const>
+Command::getPreparedArguments() {
+  // This method is only called while holding the mutex. setArgument resets
+  // the prepared arguments when an argument changes, so we only have to
+  // rebuild them if they do not exist.
+  if (this->preparedArguments) {
+    return this->preparedArguments;
+  }
+  auto preparedArguments = std::make_shared<PreparedArguments>();
+  // All arguments are stored in a single block of memory, each one being
+  // terminated by a null byte. We only take the pointers after filling the
+  // block, because the block must not be resized afterwards.
+  std::size_t arenaSize = 0;
+  for (auto &argument : this->arguments) {
+    arenaSize += argument.size() + 1;
+  }
+  preparedArguments->arena.reserve(arenaSize);
+  for (auto &argument : this->arguments) {
+    preparedArguments->arena.insert(preparedArguments->arena.end(),
+        argument.begin(), argument.end());
+    preparedArguments->arena.push_back('\0');
+  }
+  preparedArguments->argv.reserve(this->arguments.size() + 1);
+  char const *nextArgument = preparedArguments->arena.data();
+  for (auto &argument : this->arguments) {
+    preparedArguments->argv.push_back(nextArgument);
+    nextArgument += argument.size() + 1;
+  }
+  // execve() expects the array to be terminated by a null pointer.
+  preparedArguments->argv.push_back(nullptr);
+  this->preparedArguments = preparedArguments;
+  return preparedArguments;
+}
+
+std::shared_ptr<Command::PreparedEnvironment const>
+Command::getPreparedEnvironment() {
+  // This method is only called while holding the mutex. The prepared
+  // environment is only rebuilt if the base environment or the environment
+  // variables of this command have changed since it was built.
+  auto baseEnvironment = BaseEnvironment::getInstance().getSnapshot();
+  if (this->preparedEnvironment
+      && this->preparedEnvironment->baseGeneration
+          == baseEnvironment->generation
+      && this->preparedEnvironment->envVarsGeneration
+          == this->envVarsGeneration) {
+    return this->preparedEnvironment;
+  }
+  auto preparedEnvironment = std::make_shared<PreparedEnvironment>();
+  preparedEnvironment->baseGeneration = baseEnvironment->generation;
+  preparedEnvironment->entries = prepareEnvironment(*baseEnvironment,
+      this->envVars);
+  preparedEnvironment->envp = viewAsCStrings(preparedEnvironment->entries);
+  preparedEnvironment->envVarsGeneration = this->envVarsGeneration;
+  this->preparedEnvironment = preparedEnvironment;
+  return preparedEnvironment;
+}
 
 } // namespace epics
 } // namespace execute
@@ -1,6 +1,6 @@
 /*
- * Copyright 2018-2023 aquenos GmbH.
- * Copyright 2018-2023 Karlsruhe Institute of Technology.
+ * Copyright 2018-2026 aquenos GmbH.
+ * Copyright 2018-2026 Karlsruhe Institute of Technology.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as
@@ -31,16 +31,36 @@
 #define EPICS_EXEC_COMMAND_H
 
 #include <cstdint>
+#include <deque>
+#include <exception>
 #include <forward_list>
+#include <functional>
 #include <future>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 
+#include "BufferPool.h"
+#include "CaptureMode.h"
+#include "Coprocess.h"
+#include "ExecutionMode.h"
+#include "LineStream.h"
+#include "OutputFile.h"
+#include "OverflowPolicy.h"
+#include "ResultOrder.h"
+#include "RunStatistics.h"
+#include "RunTrace.h"
+#include "SealedBuffer.h"
+#include "SpawnMethod.h"
+#include "ThreadPoolExecutor.h"
+
 namespace epics {
 namespace execute {
 
+class Supervisor;
+
 /**
  * Command that may be excuted. This object collects the arguments and
  * environment variables that shall be passed to the command. The actual
@@ -50,6 +70,147 @@ class Command {
 
 public:
 
+  /**
+   * Result of a run. A result is never modified after it has been published,
+   * so it can be used without holding a lock and the exit code and output
+   * always belong to the same run.
+   */
+  struct Result {
+
+    /**
+     * Exit code of the run (see getExitCode()).
+     */
+    int exitCode;
+
+    /**
+     * Data written to the standard error output (see getStdErrBuffer()) when
+     * using CaptureMode::pipe. Use getStdErrData() and getStdErrSize() in
+     * order to access the data regardless of the capture mode.
+     */
+    std::vector<char> stderrData;
+
+    /**
+     * Number of bytes written to the standard error output that have been
+     * discarded because they exceeded the capacity.
+     */
+    std::size_t stderrDiscardedBytes;
+
+    /**
+     * Memory file holding the data written to the standard error output when
+     * using CaptureMode::file. Null when using CaptureMode::pipe.
+     */
+    std::shared_ptr<OutputFile const> stderrFile;
+
+    /**
+     * Overflow policy that was used for the standard error output.
+     */
+    OverflowPolicy stderrOverflowPolicy;
+
+    /**
+     * Data written to the standard output (see getStdOutBuffer()) when using
+     * CaptureMode::pipe. Use getStdOutData() and getStdOutSize() in order to
+     * access the data regardless of the capture mode.
+     */
+    std::vector<char> stdoutData;
+
+    /**
+     * Number of bytes written to the standard output that have been discarded
+     * because they exceeded the capacity.
+     */
+    std::size_t stdoutDiscardedBytes;
+
+    /**
+     * Memory file holding the data written to the standard output when using
+     * CaptureMode::file. Null when using CaptureMode::pipe.
+     */
+    std::shared_ptr<OutputFile const> stdoutFile;
+
+    /**
+     * Overflow policy that was used for the standard output.
+     */
+    OverflowPolicy stdoutOverflowPolicy;
+
+    /**
+     * Returns a pointer to the data written to the standard error output.
+     */
+    char const *getStdErrData() const {
+      return stderrFile ? stderrFile->getData() : stderrData.data();
+    }
+
+    /**
+     * Returns the number of bytes available through getStdErrData().
+     */
+    std::size_t getStdErrSize() const {
+      return stderrFile ? stderrFile->getSize() : stderrData.size();
+    }
+
+    /**
+     * Returns a pointer to the data written to the standard output.
+     */
+    char const *getStdOutData() const {
+      return stdoutFile ? stdoutFile->getData() : stdoutData.data();
+    }
+
+    /**
+     * Returns the number of bytes available through getStdOutData().
+     */
+    std::size_t getStdOutSize() const {
+      return stdoutFile ? stdoutFile->getSize() : stdoutData.size();
+    }
+
+  };
+
+  /**
+   * Handler that is called when a run started through runAsync(...) has
+   * completed. If the run failed, error is set. The result is the result
+   * published for the run. It is null if the wait flag is not set.
+   */
+  using CompletionHandler = std::function<void(std::exception_ptr error,
+      std::shared_ptr<Result const> result)>;
+
+  /**
+   * Pins a result of a command for the calling thread. While the pin exists,
+   * getResult() (and thus getExitCode(), getStdErrBuffer(), and
+   * getStdOutBuffer()) returns the pinned result instead of the result of the
+   * last run when it is called by the thread that created the pin. Other
+   * threads are not affected.
+   *
+   * This makes it possible to process a chain of records for the result of a
+   * specific run, even if later runs complete while the chain is being
+   * processed. Pins can be nested and must be destroyed in the reverse order
+   * of their creation, so they should only be used as local variables.
+   */
+  class ResultPin {
+
+  public:
+
+    /**
+     * Creates a pin for the specified command and result. If the result is
+     * null, the pin has no effect.
+     */
+    ResultPin(Command const &command, std::shared_ptr<Result const> result);
+
+    /**
+     * Destroys the pin, so that the command's result is visible again.
+     */
+    ~ResultPin();
+
+  private:
+
+    friend class Command;
+
+    Command const &command;
+    ResultPin *previous;
+    std::shared_ptr<Result const> result;
+
+    // We do not want to allow copy or move construction and assignment.
+    ResultPin(ResultPin const&) = delete;
+    ResultPin(ResultPin &&) = delete;
+    ResultPin &operator=(ResultPin const&) = delete;
+    ResultPin &operator=(ResultPin &&) = delete;
+
+  };
+
   /**
    * Exit code used to indicate that the child process was killed by a signal.
    */
@@ -68,8 +229,13 @@ public:
    * the commands exit code will be made available through the getExitCode()
    * method. If wait is false, run() returns immediately (right after forking
    * the process) and getExitCode() always returns zero.
+   *
+   * The name (typically the command ID) is used for the queue that this
+   * command uses for tasks submitted to the shared thread pool. If it is
+   * empty, the command path is used instead.
    */
-  Command(std::string const &commandPath, bool wait);
+  Command(std::string const &commandPath, bool wait,
+      std::string const &name = std::string());
 
   /**
    * Increases the capacity of the buffer for the standard error output if the
@@ -91,6 +257,27 @@ public:
    */
   void ensureStdOutCapacity(std::size_t capacity);
 
+  /**
+   * Returns the memory usage of the pool of buffers used for capturing the
+   * standard output and standard error output. Buffers are returned to this
+   * pool once the result that uses them is not referenced any longer.
+   */
+  BufferPool::Statistics getBufferPoolStatistics() const;
+
+  /**
+   * Returns the queue that this command uses for tasks submitted to the
+   * shared thread pool (see sharedThreadPoolExecutor()). The priority and
+   * weight of this queue define how tasks of this command are scheduled
+   * relative to tasks of other commands.
+   */
+  ThreadPoolExecutor::Queue &getExecutorQueue() const;
+
+  /**
+   * Returns the mode in which this command is executed. The default is
+   * ExecutionMode::process.
+   */
+  ExecutionMode getExecutionMode() const;
+
   /**
    * Returns the exit code of the last command's last invocation. If the command
    * has not run yet or this command's wait flag is false, zero is returned.
@@ -99,10 +286,82 @@ public:
    * the exit code is set to exitCodeKilledBySignal. If a system call (e.g.
    * execve() or fork()) fails, the exit code is set to exitCodeSystemError.
    *
+   * The exit code is taken from the result returned by getResult(), so it
+   * respects a result pinned by the calling thread. Code that needs the exit
+   * code and the output should call getResult() once and read both from the
+   * returned result.
+   *
    * @return exit code of last run.
    */
   int getExitCode() const;
 
+  /**
+   * Returns the maximum number of runs of this command that may be active at
+   * the same time. The default is one. This limit only applies if the wait
+   * flag is set.
+   */
+  int getMaxConcurrentRuns() const;
+
+  /**
+   * Returns the order in which the results of concurrent runs are published.
+   * The default is ResultOrder::completion.
+   */
+  ResultOrder getResultOrder() const;
+
+  /**
+   * Returns the result of the last run. If the command has not run yet or this
+   * command's wait flag is false, the exit code is zero and the output is
+   * empty. If the calling thread has pinned a result of this command (see
+   * ResultPin), the pinned result is returned instead. The result is shared,
+   * so calling this method does not copy the output. Reading the output
+   * through this method is preferable to calling getStdErrBuffer() or
+   * getStdOutBuffer() if the output might be large.
+   */
+  std::shared_ptr<Result const> getResult() const;
+
+  /**
+   * Returns the method that is used for creating the child process. This is
+   * the method set through setSpawnMethod(SpawnMethod) or, if no method has
+   * been set explicitly, the default method.
+   */
+  SpawnMethod getSpawnMethod() const;
+
+  /**
+   * Returns the capture mode for the standard error output. The default is
+   * CaptureMode::pipe.
+   */
+  CaptureMode getStdErrCaptureMode() const;
+
+  /**
+   * Returns the capture mode for the standard output. The default is
+   * CaptureMode::pipe.
+   */
+  CaptureMode getStdOutCaptureMode() const;
+
+  /**
+   * Returns the overflow policy for the standard error output. The default is
+   * OverflowPolicy::keepHead.
+   */
+  OverflowPolicy getStdErrOverflowPolicy() const;
+
+  /**
+   * Returns the overflow policy for the standard output. The default is
+   * OverflowPolicy::keepHead.
+   */
+  OverflowPolicy getStdOutOverflowPolicy() const;
+
+  /**
+   * Returns the stream of lines written to the standard output. The stream is
+   * created when this method is called for the first time. From then on, the
+   * standard output of each run is read through a pipe (regardless of the
+   * capture mode) and split into lines while the program is running. When
+   * runs overlap (see setConcurrency(...)), their lines are interleaved in the
+   * stream. The coprocess mode does not use the stream.
+   *
+   * @throws std::invalid_argument if this command's wait flag is not set.
+   */
+  std::shared_ptr<LineStream> getStdOutLineStream();
+
   /**
    * Returns the buffer containing the output written to the standard error
    * output by the last invocation of the command. If the command has not run
@@ -131,6 +390,26 @@ public:
    */
   std::vector<char> getStdOutBuffer() const;
 
+  /**
+   * Returns the statistics about the runs of this command. Durations are
+   * recorded for each run in process mode, while the run counters are updated
+   * for each run whose result is published (so only if the wait flag is set).
+   * The statistics object is not reset and exists as long as this command.
+   */
+  RunStatistics &getStatistics();
+
+  /**
+   * Returns the supervisor that keeps this command's program running. If
+   * supervise() has not been called, a pointer to null is returned.
+   */
+  std::shared_ptr<Supervisor> getSupervisor() const;
+
+  /**
+   * Returns the ID that identifies this command as a source of events in the
+   * run trace.
+   */
+  std::uint32_t getTraceSource() const;
+
   /**
    * Returns the wait flag. If true, the run() method only returns after the
    * command has completed and the exit code is updated. If false, the run()
@@ -143,14 +422,45 @@ public:
   /**
    * Runs this command. This causes a child process to be forked that executes
    * the command. If the wait flag is set on this command, this method waits
-   * until the forked process terminates. Otherwise, this method returns
-   * immediately after forking.
+   * until the forked process terminates and its result has been published.
+   * Otherwise, this method returns immediately after forking.
    *
+   * Each run uses the arguments, environment variables, and input that are
+   * set when the run is started, so changing them while a run is active does
+   * not affect that run.
+   *
+   * @throw std::invalid_argument if the wait flag is set and the maximum
+   *     number of concurrent runs are already active.
    * @throw std::system_error if the process cannot be forked or execution of
    *     the command cannot be started (only if the wait flag is set).
    */
   void run();
 
+  /**
+   * Runs this command without blocking until the child process terminates.
+   * This method creates the child process and returns. If the wait flag is
+   * set on this command, the completion handler is called once the child
+   * process has terminated and the result state (exit code and output) has
+   * been updated. If the results are published in submission order, this
+   * might happen after other runs have completed. If the wait flag is not
+   * set, the completion handler is called right after creating the child
+   * process, before this method returns.
+   *
+   * The completion handler is called from an internal thread, so it must not
+   * block and must not throw. It is not called if this method throws.
+   *
+   * The run ID identifies the run in the run trace, so that code that
+   * schedules the run can record events for it, too. If it is zero, a new run
+   * ID is created.
+   *
+   * @throw std::invalid_argument if the wait flag is set and the maximum
+   *     number of concurrent runs are already active.
+   * @throw std::system_error if the process cannot be forked or execution of
+   *     the command cannot be started (only if the wait flag is set).
+   */
+  void runAsync(CompletionHandler completionHandler,
+      std::uint64_t runId = 0);
+
   /**
    * Sets the value of an argument passed to the executed command.
    *
@@ -161,36 +471,208 @@ public:
    */
   void setArgument(int index, std::string const &value);
 
+  /**
+   * Sets the mode in which this command is executed. In coprocess mode, the
+   * program is started when the command is run for the first time and keeps
+   * running, handling each run as a request (see Coprocess for details about
+   * the protocol).
+   *
+   * @throws std::invalid_argument if the mode is ExecutionMode::coprocess and
+   *     this command's wait flag is not set, or if the command is currently
+   *     running.
+   */
+  void setExecutionMode(ExecutionMode mode);
+
+  /**
+   * Sets the maximum number of runs of this command that may be active at the
+   * same time and the order in which their results are published.
+   *
+   * @throws std::invalid_argument if maxConcurrentRuns is less than one, if it
+   *     is greater than one and this command's wait flag is not set, or if
+   *     the command is currently running.
+   */
+  void setConcurrency(int maxConcurrentRuns, ResultOrder resultOrder);
+
+  /**
+   * Sets the method that is used for creating the child process by all
+   * commands that do not have a method set explicitly. The default is
+   * SpawnMethod::fork.
+   */
+  static void setDefaultSpawnMethod(SpawnMethod method);
+
   /**
    * Sets an environment variable passed to the executed command.
    *
-   * By default, the environment of the parent process is passed to the command.
-   * This method can be used to override the value of individual environment
-   * variables or to add additional variables.
+   * By default, the environment of the parent process is passed to the command
+   * (see BaseEnvironment). This method can be used to override the value of
+   * individual environment variables or to add additional variables.
    */
   void setEnvVar(std::string const &name, std::string const &value);
 
+  /**
+   * Sets the method that is used for creating the child process. This
+   * overrides the default method set through
+   * setDefaultSpawnMethod(SpawnMethod).
+   */
+  void setSpawnMethod(SpawnMethod method);
+
+  /**
+   * Sets the mode that defines how the standard error output is captured.
+   * When using CaptureMode::file and memory files are not supported by the
+   * platform, the output is captured through a pipe. This mode is not used in
+   * coprocess mode.
+   *
+   * @throws std::invalid_argument if the mode is CaptureMode::file and the
+   *     overflow policy for the standard error output is
+   *     OverflowPolicy::kill.
+   */
+  void setStdErrCaptureMode(CaptureMode captureMode);
+
+  /**
+   * Sets the mode that defines how the standard output is captured. When
+   * using CaptureMode::file and memory files are not supported by the
+   * platform, the output is captured through a pipe. This mode is not used in
+   * coprocess mode.
+   *
+   * @throws std::invalid_argument if the mode is CaptureMode::file and the
+   *     overflow policy for the standard output is OverflowPolicy::kill.
+   */
+  void setStdOutCaptureMode(CaptureMode captureMode);
+
+  /**
+   * Sets the policy that defines which data is kept when the command writes
+   * more data to the standard error output than the capacity. This policy is
+   * not used in coprocess mode, where the data that was sent first is always
+   * kept.
+   *
+   * @throws std::invalid_argument if the policy is OverflowPolicy::kill and
+   *     the standard error output is captured with CaptureMode::file.
+   */
+  void setStdErrOverflowPolicy(OverflowPolicy policy);
+
+  /**
+   * Sets the policy that defines which data is kept when the command writes
+   * more data to the standard output than the capacity. This policy is not
+   * used in coprocess mode, where the data that was sent first is always
+   * kept.
+   *
+   * @throws std::invalid_argument if the policy is OverflowPolicy::kill and
+   *     the standard output is captured with CaptureMode::file.
+   */
+  void setStdOutOverflowPolicy(OverflowPolicy policy);
+
   /**
    * Sets the buffer that is used as the source for the input provided to the
    * command. If the buffer is empty, the command will not receive any input and
    * its standard input file descriptor is going to be closed right from the
    * start.
+   *
+   * The data is copied once into a SealedBuffer. Where supported, this buffer
+   * is a sealed memory file that is passed to the program as its standard
+   * input, so the program can seek in its input or map it into memory.
+   * Otherwise, the data is written into a pipe. Programs should only rely on
+   * reading their input sequentially.
+   */
+  void setStdInBuffer(char const *data, std::size_t size);
+
+  /**
+   * Sets the buffer that is used as the source for the input provided to the
+   * command. This is equivalent to calling setStdInBuffer(buffer.data(),
+   * buffer.size()).
    */
   void setStdInBuffer(std::vector<char> const &buffer);
 
+  /**
+   * Marks this command as a daemon whose program is kept running by a
+   * supervisor and returns the supervisor. The supervisor is created when this
+   * method is called for the first time, but the program is only started when
+   * the supervisor's start() method is called.
+   *
+   * @throws std::invalid_argument if this command's wait flag is not set or
+   *     the command is in coprocess mode.
+   */
+  std::shared_ptr<Supervisor> supervise();
+
 private:
 
+  /**
+   * Result of a run that has completed, but has not been published yet. In
+   * submission order, a result is held back until all runs that were started
+   * earlier have completed.
+   */
+  struct PendingResult {
+    CompletionHandler completionHandler;
+    std::exception_ptr error;
+    std::shared_ptr<Result const> result;
+  };
+
+  /**
+   * Arguments in the form expected by execve(). The argument strings are
+   * stored in a single block of memory (the arena) and argv points into this
+   * block. Like the PreparedEnvironment, the object is replaced when an
+   * argument changes.
+   */
+  struct PreparedArguments {
+    std::vector<char> arena;
+    std::vector<char const *> argv;
+  };
+
+  /**
+   * Environment in the form expected by execve(). The entries are created by
+   * merging the base environment with the environment variables set for this
+   * command. The object is replaced (instead of being modified) when one of
+   * these changes, so a run can keep using it after releasing the mutex.
+   */
+  struct PreparedEnvironment {
+    std::uint64_t baseGeneration;
+    std::vector<std::string> entries;
+    std::vector<char const *> envp;
+    std::uint64_t envVarsGeneration;
+  };
+
+  struct RunState;
+
+  /**
+   * Maximum number of capture buffers that are kept in the pool. Each run
+   * uses up to two buffers, so this is sufficient for a run and the result of
+   * the previous run that might still be in use by a record.
+   */
+  static std::size_t const maxPooledBuffers = 4;
+
+  std::shared_ptr<BufferPool> bufferPool;
   std::string commandPath;
-  int exitCode;
-  std::map<int, std::string> arguments;
+  std::unique_ptr<Coprocess> coprocess;
+  ExecutionMode executionMode;
+  // Arguments are stored by index, so arguments[0] is the command path.
+  std::vector<std::string> arguments;
   std::map<std::string, std::string> envVars;
+  std::uint64_t envVarsGeneration;
+  ThreadPoolExecutor::Queue &executorQueue;
+  int maxConcurrentRuns;
   mutable std::mutex mutex;
-  bool running;
-  std::vector<char> stderrBuffer;
+  std::uint64_t nextPublishedRun;
+  std::uint64_t nextRunSequenceNumber;
+  std::map<std::uint64_t, PendingResult> pendingResults;
+  std::deque<PendingResult> publishableResults;
+  bool publishing;
+  std::shared_ptr<PreparedArguments const> preparedArguments;
+  std::shared_ptr<PreparedEnvironment const> preparedEnvironment;
+  ResultOrder resultOrder;
+  std::shared_ptr<Result const> result;
+  int runningCount;
+  SpawnMethod spawnMethod;
+  bool spawnMethodSet;
+  RunStatistics statistics;
+  std::shared_ptr<Supervisor> supervisor;
   std::size_t stderrCapacity;
-  std::vector<char> stdinBuffer;
-  std::vector<char> stdoutBuffer;
+  CaptureMode stderrCaptureMode;
+  OverflowPolicy stderrOverflowPolicy;
+  std::shared_ptr<SealedBuffer const> stdinBuffer;
   std::size_t stdoutCapacity;
+  CaptureMode stdoutCaptureMode;
+  std::shared_ptr<LineStream> stdoutLineStream;
+  OverflowPolicy stdoutOverflowPolicy;
+  std::uint32_t traceSource;
   bool wait;
 
   // We do not want to allow copy or move construction and assignment.
@@ -199,9 +681,19 @@ private:
   Command &operator=(Command const&) = delete;
   Command &operator=(Command &&) = delete;
 
-  void updateResultState(int exitCode,
-      std::vector<char> stdoutBuffer = std::vector<char>(),
-      std::vector<char> stderrBuffer = std::vector<char>());
+  void completeRun(RunState &state);
+
+  void completeRunOperation(RunState &state);
+
+  std::shared_ptr<PreparedArguments const> getPreparedArguments();
+
+  std::shared_ptr<PreparedEnvironment const> getPreparedEnvironment();
+
+  void runCoprocessAsync(CompletionHandler completionHandler);
+
+  void publishResult(std::uint64_t sequenceNumber, Result result,
+      CompletionHandler completionHandler = CompletionHandler(),
+      std::exception_ptr error = std::exception_ptr());
 
 };
 
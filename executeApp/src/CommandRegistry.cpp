@@ -1,6 +1,6 @@
 /*
- * Copyright 2018 aquenos GmbH.
- * Copyright 2018 Karlsruhe Institute of Technology.
+ * Copyright 2018-2026 aquenos GmbH.
+ * Copyright 2018-2026 Karlsruhe Institute of Technology.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as
@@ -45,6 +45,13 @@ std::shared_ptr<Command> CommandRegistry::getCommand(
   }
 }
 
+std::map<std::string, std::shared_ptr<Command>>
+CommandRegistry::getCommands() {
+  std::lock_guard<std::recursive_mutex> lock(mutex);
+  return std::map<std::string, std::shared_ptr<Command>>(commands.begin(),
+      commands.end());
+}
+
 void CommandRegistry::createCommand(const std::string &commandId,
       std::string const &commandPath, bool wait) {
   // We have to hold the mutex in order to protect the map from concurrent
@@ -54,7 +61,7 @@ void CommandRegistry::createCommand(const std::string &commandId,
     throw std::runtime_error("Command ID is already in use.");
   }
   std::shared_ptr<Command> command =
-      std::make_shared<Command>(commandPath, wait);
+      std::make_shared<Command>(commandPath, wait, commandId);
   commands.insert(std::make_pair(commandId, command));
 }
 
@@ -1,6 +1,6 @@
 /*
- * Copyright 2018 aquenos GmbH.
- * Copyright 2018 Karlsruhe Institute of Technology.
+ * Copyright 2018-2026 aquenos GmbH.
+ * Copyright 2018-2026 Karlsruhe Institute of Technology.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as
@@ -30,6 +30,7 @@
 #ifndef EPICS_EXEC_COMMAND_REGISTRY_H
 #define EPICS_EXEC_COMMAND_REGISTRY_H
 
+#include <map>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
@@ -64,6 +65,11 @@ public:
    */
   std::shared_ptr<Command> getCommand(std::string const &commandId);
 
+  /**
+   * Returns all commands that have been created, ordered by their ID.
+   */
+  std::map<std::string, std::shared_ptr<Command>> getCommands();
+
   /**
    * Creates a command using the specified ID and options.
    *
@@ -0,0 +1,542 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+extern "C" {
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+}
+
+#include "ChildReaper.h"
+#include "Coprocess.h"
+#include "ForkServer.h"
+#include "IoReactor.h"
+#include "ThreadPoolExecutor.h"
+#include "fileDescriptors.h"
+#include "spawnProcess.h"
+
+namespace epics {
+namespace execute {
+
+namespace {
+
+/**
+ * Maximum number of read() or write() calls that are made for a single pipe
+ * before returning control to the I/O reactor.
+ */
+int const maxIoCallsPerEvent = 16;
+
+void appendUint32(std::vector<char> &buffer, std::uint32_t value) {
+  buffer.push_back(static_cast<char>((value >> 24) & 0xff));
+  buffer.push_back(static_cast<char>((value >> 16) & 0xff));
+  buffer.push_back(static_cast<char>((value >> 8) & 0xff));
+  buffer.push_back(static_cast<char>(value & 0xff));
+}
+
+void appendField(std::vector<char> &buffer, char const *data,
+    std::size_t size) {
+  if (size > UINT32_MAX) {
+    throw std::invalid_argument(
+        "The request contains a field that is too large.");
+  }
+  appendUint32(buffer, static_cast<std::uint32_t>(size));
+  buffer.insert(buffer.end(), data, data + size);
+}
+
+void appendField(std::vector<char> &buffer, std::string const &data) {
+  appendField(buffer, data.data(), data.size());
+}
+
+std::uint32_t decodeUint32(std::vector<char> const &bytes) {
+  return (static_cast<std::uint32_t>(static_cast<unsigned char>(bytes[0]))
+      << 24)
+      | (static_cast<std::uint32_t>(static_cast<unsigned char>(bytes[1]))
+      << 16)
+      | (static_cast<std::uint32_t>(static_cast<unsigned char>(bytes[2]))
+      << 8)
+      | static_cast<std::uint32_t>(static_cast<unsigned char>(bytes[3]));
+}
+
+std::vector<char> encodeRequest(Coprocess::Request const &request) {
+  std::vector<char> buffer;
+  appendUint32(buffer, static_cast<std::uint32_t>(request.arguments.size()));
+  for (auto &argument : request.arguments) {
+    appendField(buffer, argument);
+  }
+  appendUint32(buffer, static_cast<std::uint32_t>(request.envVars.size()));
+  for (auto &envVar : request.envVars) {
+    appendField(buffer, envVar.first);
+    appendField(buffer, envVar.second);
+  }
+  if (request.stdinData) {
+    appendField(buffer, request.stdinData->getData(),
+        request.stdinData->getSize());
+  } else {
+    appendUint32(buffer, 0);
+  }
+  return buffer;
+}
+
+/**
+ * Copies up to size bytes into the field until it has four bytes. Returns the
+ * number of bytes that have been copied.
+ */
+std::size_t fillUint32Field(std::vector<char> &field, char const *data,
+    std::size_t size) {
+  std::size_t bytesUsed = 0;
+  while (field.size() < 4 && bytesUsed < size) {
+    field.push_back(data[bytesUsed]);
+    ++bytesUsed;
+  }
+  return bytesUsed;
+}
+
+} // anonymous namespace
+
+Coprocess::Coprocess(std::string const &commandPath)
+    : state(std::make_shared<State>()) {
+  this->state->commandPath = commandPath;
+  this->state->generation = 0;
+  this->state->parserBytesRemaining = 0;
+  this->state->parserState = ParserState::status;
+  this->state->response = Response();
+  this->state->stdinFd = -1;
+  this->state->stdoutFd = -1;
+  this->state->writeHandlerRegistered = false;
+  this->state->writeOffset = 0;
+}
+
+Coprocess::~Coprocess() {
+  std::vector<std::function<void()>> completions;
+  {
+    std::lock_guard<std::mutex> lock(this->state->mutex);
+    stop(*this->state, std::make_exception_ptr(std::runtime_error(
+        "The coprocess has been destroyed.")), completions);
+  }
+  for (auto &completion : completions) {
+    completion();
+  }
+}
+
+void Coprocess::sendRequest(Request request, SpawnMethod spawnMethod,
+    EnvironmentProvider const &environmentProvider,
+    ResponseHandler responseHandler) {
+  auto requestData = encodeRequest(request);
+  std::lock_guard<std::mutex> lock(this->state->mutex);
+  if (!this->state->child) {
+    start(this->state, spawnMethod, environmentProvider);
+  }
+  PendingRequest pendingRequest;
+  pendingRequest.responseHandler = std::move(responseHandler);
+  pendingRequest.stderrCapacity = request.stderrCapacity;
+  pendingRequest.stdoutCapacity = request.stdoutCapacity;
+  auto &writeBuffer = this->state->writeBuffer;
+  writeBuffer.insert(writeBuffer.end(), requestData.begin(),
+      requestData.end());
+  if (!this->state->writeHandlerRegistered) {
+    auto state = this->state;
+    auto generation = this->state->generation;
+    IoReactor::getInstance().addFd(this->state->stdinFd, IoReactor::writable,
+        [state, generation]() {handleWritable(state, generation);});
+    this->state->writeHandlerRegistered = true;
+  }
+  this->state->pendingRequests.push_back(std::move(pendingRequest));
+}
+
+void Coprocess::handleReadable(std::shared_ptr<State> const &state,
+    std::uint64_t generation) {
+  std::vector<std::function<void()>> completions;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->generation != generation) {
+      return;
+    }
+    char buffer[4096];
+    for (int i = 0; i < maxIoCallsPerEvent; ++i) {
+      auto bytesRead = ::read(state->stdoutFd, buffer, sizeof(buffer));
+      if (bytesRead > 0) {
+        if (!parseResponseData(*state, buffer, bytesRead, completions)) {
+          stop(*state, std::make_exception_ptr(std::runtime_error(
+              "The coprocess sent a response without a request.")),
+              completions);
+          break;
+        }
+      } else if (bytesRead == 0) {
+        stop(*state, std::make_exception_ptr(std::runtime_error(
+            "The coprocess closed its standard output unexpectedly.")),
+            completions);
+        break;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      } else if (errno != EINTR) {
+        std::system_error e(std::error_code(errno, std::system_category()),
+            "read() failed");
+        stop(*state, std::make_exception_ptr(e), completions);
+        break;
+      }
+    }
+  }
+  for (auto &completion : completions) {
+    completion();
+  }
+}
+
+void Coprocess::handleTermination(std::shared_ptr<State> const &state,
+    std::uint64_t generation) {
+  std::vector<std::function<void()>> completions;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->generation != generation) {
+      return;
+    }
+    // The program might have written a response right before terminating,
+    // and we might be notified about the termination before the I/O reactor
+    // has processed this response. For this reason, we read all remaining
+    // data before treating the pending requests as failed.
+    char buffer[4096];
+    while (true) {
+      auto bytesRead = ::read(state->stdoutFd, buffer, sizeof(buffer));
+      if (bytesRead > 0) {
+        if (!parseResponseData(*state, buffer, bytesRead, completions)) {
+          break;
+        }
+      } else if (bytesRead == -1 && errno == EINTR) {
+        continue;
+      } else {
+        break;
+      }
+    }
+    stop(*state, std::make_exception_ptr(std::runtime_error(
+        "The coprocess terminated unexpectedly.")), completions);
+  }
+  for (auto &completion : completions) {
+    completion();
+  }
+}
+
+void Coprocess::handleWritable(std::shared_ptr<State> const &state,
+    std::uint64_t generation) {
+  std::vector<std::function<void()>> completions;
+  {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->generation != generation) {
+      return;
+    }
+    for (int i = 0; i < maxIoCallsPerEvent; ++i) {
+      auto bytesWritten = ::write(state->stdinFd,
+          state->writeBuffer.data() + state->writeOffset,
+          state->writeBuffer.size() - state->writeOffset);
+      if (bytesWritten > 0) {
+        state->writeOffset += bytesWritten;
+        if (state->writeOffset == state->writeBuffer.size()) {
+          // All requests have been written, so we are not interested in the
+          // file descriptor becoming writable until the next request is
+          // sent.
+          IoReactor::getInstance().removeFd(state->stdinFd);
+          state->writeBuffer.clear();
+          state->writeHandlerRegistered = false;
+          state->writeOffset = 0;
+          break;
+        }
+      } else if (bytesWritten == -1
+          && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        break;
+      } else if (bytesWritten == -1 && errno != EINTR) {
+        std::system_error e(std::error_code(errno, std::system_category()),
+            "write() failed");
+        stop(*state, std::make_exception_ptr(e), completions);
+        break;
+      }
+    }
+  }
+  for (auto &completion : completions) {
+    completion();
+  }
+}
+
+bool Coprocess::parseResponseData(State &state, char const *data,
+    std::size_t size, std::vector<std::function<void()>> &completions) {
+  // This method must only be called while holding the mutex. It processes
+  // the data and adds a completion for each response that is complete. It
+  // returns false if the data violates the protocol.
+  while (size > 0) {
+    if (state.pendingRequests.empty()) {
+      return false;
+    }
+    auto &request = state.pendingRequests.front();
+    std::size_t bytesUsed = 0;
+    switch (state.parserState) {
+    case ParserState::status:
+      bytesUsed = fillUint32Field(state.parserField, data, size);
+      if (state.parserField.size() == 4) {
+        state.response.status = static_cast<std::int32_t>(
+            decodeUint32(state.parserField));
+        state.parserField.clear();
+        state.parserState = ParserState::stdoutLength;
+      }
+      break;
+    case ParserState::stdoutLength:
+    case ParserState::stderrLength:
+      bytesUsed = fillUint32Field(state.parserField, data, size);
+      if (state.parserField.size() == 4) {
+        state.parserBytesRemaining = decodeUint32(state.parserField);
+        state.parserField.clear();
+        state.parserState = state.parserState == ParserState::stdoutLength
+            ? ParserState::stdoutData : ParserState::stderrData;
+      }
+      break;
+    case ParserState::stdoutData:
+    case ParserState::stderrData:
+      {
+        bool isStdout = state.parserState == ParserState::stdoutData;
+        auto &output = isStdout ? state.response.stdoutData
+            : state.response.stderrData;
+        auto &discardedBytes = isStdout ? state.response.stdoutDiscardedBytes
+            : state.response.stderrDiscardedBytes;
+        auto capacity = isStdout ? request.stdoutCapacity
+            : request.stderrCapacity;
+        bytesUsed = std::min<std::size_t>(size, state.parserBytesRemaining);
+        // Data exceeding the capacity is discarded, like when running the
+        // command in a new process with the OverflowPolicy::keepHead.
+        auto bytesKept = std::min(bytesUsed,
+            capacity - std::min(capacity, output.size()));
+        output.insert(output.end(), data, data + bytesKept);
+        discardedBytes += bytesUsed - bytesKept;
+        state.parserBytesRemaining -= bytesUsed;
+      }
+      break;
+    }
+    data += bytesUsed;
+    size -= bytesUsed;
+    if (state.parserState == ParserState::stdoutData
+        && state.parserBytesRemaining == 0) {
+      state.parserState = ParserState::stderrLength;
+    }
+    if (state.parserState == ParserState::stderrData
+        && state.parserBytesRemaining == 0) {
+      // The response is complete.
+      // The response is passed through a shared pointer, so that the data is
+      // not copied when copying the completion.
+      auto responseHandler = std::move(request.responseHandler);
+      auto response = std::make_shared<Response>(std::move(state.response));
+      completions.push_back([responseHandler, response]() {
+        responseHandler(std::move(*response), std::exception_ptr());
+      });
+      state.pendingRequests.pop_front();
+      state.parserState = ParserState::status;
+      state.response = Response();
+    }
+  }
+  return true;
+}
+
+void Coprocess::start(std::shared_ptr<State> const &state,
+    SpawnMethod spawnMethod, EnvironmentProvider const &environmentProvider) {
+  // This method must only be called while holding the mutex.
+  auto environment = environmentProvider();
+  std::vector<char const *> envp;
+  for (auto &envVar : environment) {
+    envp.push_back(envVar.c_str());
+  }
+  envp.push_back(nullptr);
+  char const *argv[] = {state->commandPath.c_str(), nullptr};
+  int maxFd = ::sysconf(_SC_OPEN_MAX);
+  if (maxFd == -1) {
+    throw std::system_error(
+        std::error_code(errno, std::system_category()),
+        "sysconf(_SC_OPEN_MAX) failed");
+  }
+  // The pipes are created with the close-on-exec flag set, so that they do
+  // not leak into child processes created for other commands. The ends used
+  // by this process must not block, because they are used by the I/O
+  // reactor.
+  int stdinPipe[2];
+  int stdoutPipe[2];
+  createPipe(stdinPipe);
+  try {
+    createPipe(stdoutPipe);
+  } catch (...) {
+    ::close(stdinPipe[0]);
+    ::close(stdinPipe[1]);
+    throw;
+  }
+  auto closePipes = [&stdinPipe, &stdoutPipe]() {
+    for (int fd : {stdinPipe[0], stdinPipe[1], stdoutPipe[0], stdoutPipe[1]}) {
+      if (fd != -1) {
+        ::close(fd);
+      }
+    }
+  };
+  ++state->generation;
+  auto generation = state->generation;
+  std::weak_ptr<State> weakState = state;
+  // The child process is marked as reaped even if the program has already
+  // been stopped, so that stop() never signals a process that has been
+  // reaped.
+  auto child = std::make_shared<ChildProcessHandle>();
+  ChildTerminationHandler terminationHandler = [weakState, generation, child](
+      int, std::exception_ptr) {
+    child->markReaped();
+    auto state = weakState.lock();
+    if (state) {
+      handleTermination(state, generation);
+    }
+  };
+  ::pid_t pid;
+  try {
+    setNonBlocking(stdinPipe[1]);
+    setNonBlocking(stdoutPipe[0]);
+    SpawnParameters spawnParameters;
+    spawnParameters.path = state->commandPath.c_str();
+    spawnParameters.argv = argv;
+    spawnParameters.envp = envp.data();
+    spawnParameters.stdinFd = stdinPipe[0];
+    spawnParameters.stdoutFd = stdoutPipe[1];
+    // The standard error output of the program is not part of the protocol,
+    // so we pass it through. This way, error messages (e.g. a Python stack
+    // trace) appear on the console of the IOC.
+    spawnParameters.stderrFd = STDERR_FILENO;
+    spawnParameters.maxFd = maxFd;
+    int execveErrorNumber;
+    bool spawnedByForkServer = ForkServer::getInstance().spawn(
+        spawnParameters, pid, execveErrorNumber, terminationHandler);
+    if (!spawnedByForkServer) {
+      pid = spawnProcess(spawnMethod, spawnParameters, execveErrorNumber);
+    }
+    if (execveErrorNumber) {
+      throw std::system_error(
+          std::error_code(execveErrorNumber, std::system_category()),
+          "execve() failed");
+    }
+    // There is only a single process per coprocess, so we always open a
+    // pidfd for it.
+    child->setPid(pid, true, spawnedByForkServer);
+    if (!spawnedByForkServer) {
+      try {
+        ChildReaper::getInstance().watch(pid, terminationHandler);
+      } catch (...) {
+        // If the child process cannot be watched, we fall back to waiting
+        // for it in a thread, just like Command does. Like there, we wait
+        // for the child process without reaping it first, so that it can be
+        // marked as reaped before its PID can be reused.
+        sharedThreadPoolExecutor().submit([pid, terminationHandler, child]() {
+          ::siginfo_t info;
+          while (::waitid(P_PID, pid, &info, WEXITED | WNOWAIT) == -1
+              && errno == EINTR) {
+          }
+          child->markReaped();
+          int waitStatus;
+          if (::waitpid(pid, &waitStatus, 0) == pid) {
+            terminationHandler(waitStatus, std::exception_ptr());
+          } else {
+            terminationHandler(0, std::make_exception_ptr(std::system_error(
+                std::error_code(errno, std::system_category()),
+                "waitpid() failed")));
+          }
+        });
+      }
+    }
+  } catch (...) {
+    closePipes();
+    throw;
+  }
+  // The ends of the pipes that have been passed to the child process are not
+  // needed in this process any longer.
+  ::close(stdinPipe[0]);
+  ::close(stdoutPipe[1]);
+  state->child = child;
+  state->stdinFd = stdinPipe[1];
+  state->stdoutFd = stdoutPipe[0];
+  try {
+    IoReactor::getInstance().addFd(state->stdoutFd, IoReactor::readable,
+        [state, generation]() {handleReadable(state, generation);});
+  } catch (...) {
+    std::vector<std::function<void()>> completions;
+    stop(*state, std::exception_ptr(), completions);
+    throw;
+  }
+}
+
+void Coprocess::stop(State &state, std::exception_ptr error,
+    std::vector<std::function<void()>> &completions) noexcept {
+  // This method must only be called while holding the mutex. Incrementing the
+  // generation ensures that handlers that are still registered for the
+  // current instance of the program do not do anything.
+  ++state.generation;
+  if (state.stdinFd != -1) {
+    if (state.writeHandlerRegistered) {
+      IoReactor::getInstance().removeFd(state.stdinFd);
+    }
+    ::close(state.stdinFd);
+    state.stdinFd = -1;
+  }
+  if (state.stdoutFd != -1) {
+    IoReactor::getInstance().removeFd(state.stdoutFd);
+    ::close(state.stdoutFd);
+    state.stdoutFd = -1;
+  }
+  // If the program is still running, we kill it if it failed (the program
+  // might not react to its standard input being closed in this case). If
+  // there are no pending requests, closing the standard input is sufficient
+  // for telling the program to terminate. If the kernel does not support
+  // pidfds, the signal has to be sent to the PID, so we send it from the I/O
+  // reactor's thread, where the child reaper reaps the program and marks it
+  // as reaped without any other code running in between.
+  if (state.child && !state.pendingRequests.empty()) {
+    auto child = state.child;
+    try {
+      IoReactor::getInstance().post([child]() {child->kill();});
+    } catch (...) {
+      // If the task cannot be posted, we do not kill the program. It is
+      // still going to terminate when it reads from its standard input.
+    }
+  }
+  state.child.reset();
+  state.parserField.clear();
+  state.parserState = ParserState::status;
+  state.response = Response();
+  state.writeBuffer.clear();
+  state.writeHandlerRegistered = false;
+  state.writeOffset = 0;
+  for (auto &request : state.pendingRequests) {
+    auto responseHandler = std::move(request.responseHandler);
+    completions.push_back([responseHandler, error]() {
+      responseHandler(Response(), error);
+    });
+  }
+  state.pendingRequests.clear();
+}
+
+} // namespace execute
+} // namespace epics
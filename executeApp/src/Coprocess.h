@@ -0,0 +1,272 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_COPROCESS_H
+#define EPICS_EXEC_COPROCESS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ChildProcessHandle.h"
+#include "SealedBuffer.h"
+#include "SpawnMethod.h"
+
+namespace epics {
+namespace execute {
+
+/**
+ * Program that is started once and then handles a sequence of requests.
+ *
+ * Requests are written to the program's standard input and responses are
+ * read from its standard output. The program's standard error output is
+ * connected to the standard error output of the IOC. All integers are 32-bit
+ * integers in network byte order (big endian). A request consists of:
+ *
+ * - the number of arguments, followed by the length and the bytes of each
+ *   argument (not including the program path, which is argument zero),
+ * - the number of environment variables, followed by the length and bytes of
+ *   the name and the length and bytes of the value of each variable,
+ * - the length and the bytes of the data for the standard input.
+ *
+ * The environment variables are the ones that have been set for the command
+ * explicitly, so the program has to apply them on top of its own environment
+ * if it needs them. A response consists of:
+ *
+ * - the status code (a signed integer that is used as the exit code),
+ * - the length and the bytes of the data for the standard output,
+ * - the length and the bytes of the data for the standard error output.
+ *
+ * Requests may be sent before the response to the previous request has been
+ * received, so the program has to process them in order. If the program
+ * terminates or violates the protocol, all requests that have not been
+ * answered fail, and the program is started again for the next request. The
+ * program is expected to terminate when its standard input is closed.
+ *
+ * All I/O happens in the thread of the I/O reactor, so no thread is blocked
+ * while the program is processing a request.
+ */
+class Coprocess {
+
+public:
+
+  /**
+   * Provides the environment that is passed to the program when it is
+   * started. Each element has the form "name=value".
+   */
+  using EnvironmentProvider = std::function<std::vector<std::string>()>;
+
+  /**
+   * Response that has been received from the program.
+   */
+  struct Response {
+
+    /**
+     * Status code sent by the program.
+     */
+    int status;
+
+    /**
+     * Data for the standard error output, limited to the capacity specified
+     * in the request.
+     */
+    std::vector<char> stderrData;
+
+    /**
+     * Number of bytes for the standard error output that have been discarded
+     * because they exceeded the capacity.
+     */
+    std::size_t stderrDiscardedBytes;
+
+    /**
+     * Data for the standard output, limited to the capacity specified in the
+     * request.
+     */
+    std::vector<char> stdoutData;
+
+    /**
+     * Number of bytes for the standard output that have been discarded
+     * because they exceeded the capacity.
+     */
+    std::size_t stdoutDiscardedBytes;
+
+  };
+
+  /**
+   * Handler that is called when the response for a request has been
+   * received. If the request failed, error is set and the response is empty.
+   */
+  using ResponseHandler = std::function<void(Response response,
+      std::exception_ptr error)>;
+
+  /**
+   * Request that is sent to the program.
+   */
+  struct Request {
+
+    /**
+     * Arguments (starting with argument one).
+     */
+    std::vector<std::string> arguments;
+
+    /**
+     * Environment variables that have been set explicitly.
+     */
+    std::map<std::string, std::string> envVars;
+
+    /**
+     * Maximum number of bytes that are kept from the standard error output
+     * in the response. Additional bytes are discarded.
+     */
+    std::size_t stderrCapacity = 0;
+
+    /**
+     * Data for the standard input. If null, no data is sent.
+     */
+    std::shared_ptr<SealedBuffer const> stdinData;
+
+    /**
+     * Maximum number of bytes that are kept from the standard output in the
+     * response. Additional bytes are discarded.
+     */
+    std::size_t stdoutCapacity = 0;
+
+  };
+
+  /**
+   * Creates a coprocess for the program at the specified path. The program is
+   * not started until the first request is sent.
+   */
+  Coprocess(std::string const &commandPath);
+
+  /**
+   * Destructor. Closes the program's standard input and output, so that the
+   * program terminates. Pending requests fail.
+   */
+  ~Coprocess();
+
+  /**
+   * Sends a request to the program. If the program is not running, it is
+   * started first, using the specified spawn method and the environment
+   * returned by the environment provider. The response handler is called
+   * from an internal thread, so it must not block and must not throw. It is
+   * not called if this method throws.
+   *
+   * @throws std::system_error if the program needs to be started and cannot
+   *     be started.
+   */
+  void sendRequest(Request request, SpawnMethod spawnMethod,
+      EnvironmentProvider const &environmentProvider,
+      ResponseHandler responseHandler);
+
+private:
+
+  struct PendingRequest {
+    ResponseHandler responseHandler;
+    std::size_t stderrCapacity;
+    std::size_t stdoutCapacity;
+  };
+
+  /**
+   * Position in a response that is being parsed.
+   */
+  enum class ParserState {
+    status,
+    stdoutLength,
+    stdoutData,
+    stderrLength,
+    stderrData,
+  };
+
+  /**
+   * State that is shared with the handlers registered with the I/O reactor
+   * and the child reaper, which might run after this object is destroyed.
+   */
+  struct State {
+    // Handle for the running instance of the program. This is null while the
+    // program is not running.
+    std::shared_ptr<ChildProcessHandle> child;
+    std::string commandPath;
+    // The generation is incremented each time the program is started or
+    // stopped, so that handlers for a previous instance of the program can
+    // detect that they are outdated.
+    std::uint64_t generation;
+    std::mutex mutex;
+    std::uint32_t parserBytesRemaining;
+    std::vector<char> parserField;
+    ParserState parserState;
+    std::deque<PendingRequest> pendingRequests;
+    // Response that is currently being parsed.
+    Response response;
+    int stdinFd;
+    int stdoutFd;
+    std::vector<char> writeBuffer;
+    bool writeHandlerRegistered;
+    std::size_t writeOffset;
+  };
+
+  std::shared_ptr<State> state;
+
+  // We do not want to allow copy or move construction and assignment.
+  Coprocess(Coprocess const &) = delete;
+  Coprocess(Coprocess &&) = delete;
+  Coprocess &operator=(Coprocess const &) = delete;
+  Coprocess &operator=(Coprocess &&) = delete;
+
+  static void handleReadable(std::shared_ptr<State> const &state,
+      std::uint64_t generation);
+
+  static void handleTermination(std::shared_ptr<State> const &state,
+      std::uint64_t generation);
+
+  static void handleWritable(std::shared_ptr<State> const &state,
+      std::uint64_t generation);
+
+  static bool parseResponseData(State &state, char const *data,
+      std::size_t size, std::vector<std::function<void()>> &completions);
+
+  static void start(std::shared_ptr<State> const &state,
+      SpawnMethod spawnMethod, EnvironmentProvider const &environmentProvider);
+
+  static void stop(State &state, std::exception_ptr error,
+      std::vector<std::function<void()>> &completions) noexcept;
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_COPROCESS_H
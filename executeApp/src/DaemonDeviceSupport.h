@@ -0,0 +1,161 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_DAEMON_DEVICE_SUPPORT_H
+#define EPICS_EXEC_DAEMON_DEVICE_SUPPORT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+extern "C" {
+#include <dbScan.h>
+} // extern "C"
+
+#include "BaseDeviceSupport.h"
+#include "RecordValFieldName.h"
+#include "Supervisor.h"
+
+namespace epics {
+namespace execute {
+
+/**
+ * Device support for records reading the status of a supervised command.
+ *
+ * The input record's value is updated with the state, the restart count, or
+ * the last exit code of the command's program, depending on the value name in
+ * the record's address. Consequently, this device support code only handles
+ * record address of type daemon. Each time the status changes, the record is
+ * processed if its SCAN field is set to "I/O Intr".
+ */
+template <typename RecordType, RecordValFieldName ValFieldName>
+class DaemonDeviceSupport : public BaseDeviceSupport<RecordType> {
+
+public:
+
+  /**
+   * Constructor. The parameters are passed to the parent constructor.
+   *
+   * @throws std::invalid_argument if the command associated with the record is
+   *     not supervised or if the value name is not one of "state", "restarts",
+   *     or "exit_code".
+   */
+  DaemonDeviceSupport(RecordType *record, RecordAddress const &address)
+      : BaseDeviceSupport<RecordType>(record, address),
+        supervisor(this->getCommand()->getSupervisor()) {
+    if (!supervisor) {
+      throw std::invalid_argument(
+          "Cannot read the daemon status of a command that is not supervised.");
+    }
+    auto const &valueName = address.getValueName();
+    if (valueName == "state") {
+      value = Value::state;
+    } else if (valueName == "restarts") {
+      value = Value::restartCount;
+    } else if (valueName == "exit_code") {
+      value = Value::lastExitCode;
+    } else {
+      throw std::invalid_argument(
+          "The daemon value must be one of \"state\", \"restarts\", or \"exit_code\".");
+    }
+    ::scanIoInit(&ioScanPvt);
+    // The I/O scan list is never destroyed, so it is safe to capture it in the
+    // listener.
+    auto ioScanPvt = this->ioScanPvt;
+    supervisor->addListener([ioScanPvt]() {
+      ::scanIoRequest(ioScanPvt);
+    });
+  }
+
+  /**
+   * Returns the I/O scan list that is triggered when the status changes.
+   */
+  ::IOSCANPVT getIoScanPvt() const {
+    return ioScanPvt;
+  }
+
+  /**
+   * Updates the record's value with the current status of the supervised
+   * command.
+   */
+  void processRecord() {
+    auto status = supervisor->getStatus();
+    switch (value) {
+    case Value::lastExitCode:
+      getValueField(this->getRecord()) = status.lastExitCode;
+      break;
+    case Value::restartCount:
+      // The restart count is limited to the range of the record's field, so
+      // that it does not wrap around.
+      getValueField(this->getRecord()) = static_cast<ValueFieldType>(
+          std::min<std::uint64_t>(status.restartCount,
+              std::numeric_limits<ValueFieldType>::max()));
+      break;
+    case Value::state:
+      getValueField(this->getRecord()) = static_cast<int>(status.state);
+      break;
+    }
+  }
+
+private:
+
+  enum class Value {
+    lastExitCode,
+    restartCount,
+    state,
+  };
+
+  ::IOSCANPVT ioScanPvt;
+  std::shared_ptr<Supervisor> supervisor;
+  Value value;
+
+  template<RecordValFieldName V = ValFieldName>
+  inline static auto getValueField(typename std::enable_if<V == RecordValFieldName::val, RecordType>::type *record)
+      -> typename std::add_lvalue_reference<decltype(record->val)>::type {
+    return record->val;
+  }
+
+  template<RecordValFieldName V = ValFieldName>
+  inline static auto getValueField(typename std::enable_if<V == RecordValFieldName::rval, RecordType>::type *record)
+      -> typename std::add_lvalue_reference<decltype(record->rval)>::type {
+    return record->rval;
+  }
+
+  using ValueFieldType = typename std::remove_reference<
+      decltype(getValueField(static_cast<RecordType *>(nullptr)))>::type;
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_DAEMON_DEVICE_SUPPORT_H
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_EXECUTION_MODE_H
+#define EPICS_EXEC_EXECUTION_MODE_H
+
+namespace epics {
+namespace execute {
+
+/**
+ * Mode that defines how a command is executed when it is run.
+ */
+enum class ExecutionMode {
+
+  /**
+   * Start a new process for each run. The arguments, environment variables,
+   * and standard input are passed to the process in the usual way, and the
+   * run completes when the process terminates.
+   */
+  process,
+
+  /**
+   * Start the program once and keep it running. Each run sends a request
+   * with the arguments, environment variables, and standard input to the
+   * program and completes when the program has sent the response. The
+   * program is started again if it terminates.
+   */
+  coprocess,
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_EXECUTION_MODE_H
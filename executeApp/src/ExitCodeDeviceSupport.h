@@ -67,10 +67,14 @@ public:
 
   /**
    * Updates the record's value with the most recent exit code of the underlying
-   * command.
+   * command. When the record is processed through the forward link of a run
+   * record, this is the exit code of the run that the run record has been
+   * processed for (see Command::ResultPin), so it matches the output read by
+   * other records in the same chain.
    */
   void processRecord() {
-    getValueField(this->getRecord()) = this->getCommand()->getExitCode();
+    getValueField(this->getRecord()) =
+        this->getCommand()->getResult()->exitCode;
   }
 
 private:
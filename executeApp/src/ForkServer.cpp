@@ -0,0 +1,643 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+}
+
+#include "ForkServer.h"
+#include "fileDescriptors.h"
+
+namespace epics {
+namespace execute {
+
+namespace {
+
+/**
+ * Type of a message exchanged between the IOC and the fork server.
+ */
+enum class MessageType : std::uint32_t {
+
+  /**
+   * Request sent by the IOC, asking the fork server to create a child process.
+   */
+  spawn = 1,
+
+  /**
+   * Reply sent by the fork server after creating the child process.
+   */
+  spawned = 2,
+
+  /**
+   * Reply sent by the fork server after the child process has terminated.
+   */
+  exited = 3,
+
+};
+
+/**
+ * Header of a spawn request. The header is followed by the path of the
+ * executable, the arguments, and the environment entries, each one of them
+ * being a null-terminated string. The file descriptors for the standard input
+ * and output are passed as SCM_RIGHTS ancillary data, in the order stdin,
+ * stdout, and stderr. Only the file descriptors for which the respective bit
+ * in fdMask is set are passed.
+ */
+struct RequestHeader {
+  MessageType type;
+  std::uint32_t fdMask;
+  std::uint64_t requestId;
+  std::uint32_t argc;
+  std::uint32_t envc;
+};
+
+/**
+ * Reply sent by the fork server. For a spawned message, value is the process
+ * ID of the child process (or -1 if execve() failed) and errorNumber is the
+ * error number reported by execve() (if any). For an exited message, value is
+ * the status reported by waitpid().
+ */
+struct Reply {
+  MessageType type;
+  std::int32_t value;
+  std::int32_t errorNumber;
+  std::uint32_t reserved;
+  std::uint64_t requestId;
+};
+
+std::uint32_t const fdMaskStdIn = 1;
+std::uint32_t const fdMaskStdOut = 2;
+std::uint32_t const fdMaskStdErr = 4;
+
+#ifdef MSG_NOSIGNAL
+int const sendFlags = MSG_NOSIGNAL;
+#else
+int const sendFlags = 0;
+#endif // MSG_NOSIGNAL
+
+/**
+ * Max. size of a request. A sequenced-packet socket cannot transport messages
+ * that are larger than its send buffer, so there is no use in allowing
+ * requests that are larger than the default send buffer size. Requests that
+ * are too large are handled by creating the child process in the IOC.
+ */
+constexpr std::size_t maxRequestSize = 256 * 1024;
+
+/**
+ * Max. number of arguments plus environment entries in a request.
+ */
+constexpr std::size_t maxStrings = 16384;
+
+/**
+ * Max. number of child processes that the fork server tracks at the same
+ * time.
+ */
+constexpr std::size_t maxChildren = 16384;
+
+/**
+ * Size of the stack that is used by a child process of the fork server until
+ * it calls execve().
+ */
+constexpr std::size_t childStackSize = 64 * 1024;
+
+// The following code runs in the fork server process. As this process is
+// forked from the multi-threaded IOC process, it does not allocate any memory
+// on the heap (the heap might be in an inconsistent state) and only uses
+// statically allocated data structures instead. For the same reason, it does
+// not throw any exceptions (throwing an exception allocates memory) and only
+// uses functions that report errors through error numbers.
+namespace server {
+
+struct ChildEntry {
+  ::pid_t pid;
+  std::uint64_t requestId;
+};
+
+char childStack[childStackSize];
+char requestBuffer[maxRequestSize];
+char const *stringPointers[maxStrings + 2];
+ChildEntry children[maxChildren];
+std::size_t numberOfChildren = 0;
+int signalPipeWriteFd = -1;
+
+void handleSigchld(int) {
+  // We only use the pipe for waking up the main loop, so we can ignore
+  // errors. If the pipe is full, the main loop is going to wake up anyway.
+  int savedErrorNumber = errno;
+  char c = 0;
+  if (::write(signalPipeWriteFd, &c, 1)) {
+  }
+  errno = savedErrorNumber;
+}
+
+void sendReply(int socketFd, MessageType type, std::uint64_t requestId,
+    std::int32_t value, std::int32_t errorNumber) {
+  Reply reply;
+  std::memset(&reply, 0, sizeof(reply));
+  reply.type = type;
+  reply.value = value;
+  reply.errorNumber = errorNumber;
+  reply.requestId = requestId;
+  // If sending fails, the IOC has gone away. This is detected by the main
+  // loop, so we can ignore the error here.
+  while (::send(socketFd, &reply, sizeof(reply), sendFlags) == -1
+      && errno == EINTR) {
+  }
+}
+
+void reapChildren(int socketFd) {
+  int status;
+  ::pid_t pid;
+  while ((pid = ::waitpid(-1, &status, WNOHANG)) > 0) {
+    for (std::size_t i = 0; i < numberOfChildren; ++i) {
+      if (children[i].pid == pid) {
+        sendReply(socketFd, MessageType::exited, children[i].requestId, status,
+            0);
+        children[i] = children[numberOfChildren - 1];
+        --numberOfChildren;
+        break;
+      }
+    }
+  }
+}
+
+void handleRequest(int socketFd, std::size_t length, int const *fds,
+    std::size_t numberOfFds) {
+  if (length < sizeof(RequestHeader)) {
+    return;
+  }
+  RequestHeader header;
+  std::memcpy(&header, requestBuffer, sizeof(header));
+  if (header.type != MessageType::spawn) {
+    return;
+  }
+  // We collect the file descriptors in the order in which they were sent.
+  int stdFds[3] = {-1, -1, -1};
+  std::uint32_t const fdMasks[3] = {fdMaskStdIn, fdMaskStdOut, fdMaskStdErr};
+  std::size_t fdIndex = 0;
+  for (int i = 0; i < 3; ++i) {
+    if ((header.fdMask & fdMasks[i]) && fdIndex < numberOfFds) {
+      stdFds[i] = fds[fdIndex];
+      ++fdIndex;
+    }
+  }
+  int errorNumber = 0;
+  ::pid_t childPid = -1;
+  std::size_t numberOfStrings = 1 + header.argc + header.envc;
+  if (header.argc + header.envc > maxStrings || fdIndex != numberOfFds) {
+    errorNumber = EINVAL;
+  } else if (numberOfChildren == maxChildren) {
+    errorNumber = EAGAIN;
+  } else {
+    // We split the buffer into the individual strings. The path comes first,
+    // followed by the arguments and the environment. We reserve one extra
+    // pointer after the arguments and after the environment in order to
+    // terminate the arrays.
+    char *next = requestBuffer + sizeof(RequestHeader);
+    char *end = requestBuffer + length;
+    char const *path = nullptr;
+    std::size_t pointerIndex = 0;
+    if (header.argc == 0) {
+      stringPointers[pointerIndex] = nullptr;
+      ++pointerIndex;
+    }
+    for (std::size_t i = 0; i < numberOfStrings; ++i) {
+      auto terminator = static_cast<char *>(
+          std::memchr(next, 0, end - next));
+      if (!terminator) {
+        errorNumber = EINVAL;
+        break;
+      }
+      if (i == 0) {
+        path = next;
+      } else {
+        stringPointers[pointerIndex] = next;
+        ++pointerIndex;
+        if (i == header.argc) {
+          stringPointers[pointerIndex] = nullptr;
+          ++pointerIndex;
+        }
+      }
+      next = terminator + 1;
+    }
+    if (!errorNumber) {
+      stringPointers[pointerIndex] = nullptr;
+      SpawnParameters parameters;
+      parameters.path = path;
+      parameters.argv = stringPointers;
+      parameters.envp = stringPointers + header.argc + 1;
+      parameters.stdinFd = stdFds[0];
+      parameters.stdoutFd = stdFds[1];
+      parameters.stderrFd = stdFds[2];
+      // All file descriptors in this process have the close-on-exec flag set,
+      // so we do not have to close any file descriptors in the child process.
+      parameters.maxFd = 0;
+      // posix_spawn() allocates memory, so we cannot use spawnProcess().
+      int execveErrorNumber;
+      childPid = spawnProcessWithoutAllocation(parameters, childStack,
+          sizeof(childStack), errorNumber, execveErrorNumber);
+      if (execveErrorNumber) {
+        errorNumber = execveErrorNumber;
+      }
+    }
+  }
+  for (std::size_t i = 0; i < numberOfFds; ++i) {
+    ::close(fds[i]);
+  }
+  if (childPid != -1) {
+    children[numberOfChildren].pid = childPid;
+    children[numberOfChildren].requestId = header.requestId;
+    ++numberOfChildren;
+  }
+  sendReply(socketFd, MessageType::spawned, header.requestId, childPid,
+      errorNumber);
+}
+
+void setNonBlocking(int fd) {
+  ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+[[noreturn]] void serverMain(int socketFd, int maxFd) {
+  // We do not want to keep any file descriptors of the IOC open, except for
+  // the standard file descriptors (so that error messages of child processes
+  // that do not capture their output end up in the same place as for the
+  // IOC).
+  closeFileDescriptors(STDERR_FILENO + 1, socketFd, maxFd, false);
+  // The signal handlers inherited from the IOC do not make sense in this
+  // process, so we reset them. We ignore SIGPIPE, so that we do not get killed
+  // when the IOC closes the socket while we are sending a reply.
+  struct sigaction signalAction;
+  std::memset(&signalAction, 0, sizeof(signalAction));
+  signalAction.sa_handler = SIG_DFL;
+  for (int signalNumber = 1; signalNumber < NSIG; ++signalNumber) {
+    ::sigaction(signalNumber, &signalAction, nullptr);
+  }
+  signalAction.sa_handler = SIG_IGN;
+  ::sigaction(SIGPIPE, &signalAction, nullptr);
+  // createPipe() might throw, so we create the pipe ourselves. This process
+  // is single-threaded, so we can set the close-on-exec flag afterwards.
+  int signalPipeFds[2];
+  if (::pipe(signalPipeFds)) {
+    ::_exit(1);
+  }
+  ::fcntl(signalPipeFds[0], F_SETFD, FD_CLOEXEC);
+  ::fcntl(signalPipeFds[1], F_SETFD, FD_CLOEXEC);
+  setNonBlocking(signalPipeFds[0]);
+  setNonBlocking(signalPipeFds[1]);
+  signalPipeWriteFd = signalPipeFds[1];
+  signalAction.sa_handler = handleSigchld;
+  signalAction.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+  ::sigaction(SIGCHLD, &signalAction, nullptr);
+  ::sigset_t signalSet;
+  sigemptyset(&signalSet);
+  ::sigprocmask(SIG_SETMASK, &signalSet, nullptr);
+  while (true) {
+    ::pollfd pollFds[2];
+    pollFds[0].fd = socketFd;
+    pollFds[0].events = POLLIN;
+    pollFds[1].fd = signalPipeFds[0];
+    pollFds[1].events = POLLIN;
+    if (::poll(pollFds, 2, -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (pollFds[1].revents) {
+      char drainBuffer[64];
+      while (::read(signalPipeFds[0], drainBuffer, sizeof(drainBuffer)) > 0) {
+      }
+      reapChildren(socketFd);
+    }
+    if (pollFds[0].revents) {
+      union {
+        ::cmsghdr header;
+        char buffer[CMSG_SPACE(3 * sizeof(int))];
+      } control;
+      ::iovec iov;
+      iov.iov_base = requestBuffer;
+      iov.iov_len = sizeof(requestBuffer);
+      ::msghdr message;
+      std::memset(&message, 0, sizeof(message));
+      message.msg_iov = &iov;
+      message.msg_iovlen = 1;
+      message.msg_control = control.buffer;
+      message.msg_controllen = sizeof(control.buffer);
+      int receiveFlags = 0;
+#ifdef MSG_CMSG_CLOEXEC
+      receiveFlags |= MSG_CMSG_CLOEXEC;
+#endif // MSG_CMSG_CLOEXEC
+      auto length = ::recvmsg(socketFd, &message, receiveFlags);
+      if (length == -1 && errno == EINTR) {
+        continue;
+      }
+      if (length <= 0) {
+        // The IOC has closed the socket (most likely because it has
+        // terminated), so we quit. The child processes that are still
+        // running are inherited by the init process.
+        break;
+      }
+      int fds[3];
+      std::size_t numberOfFds = 0;
+      for (auto controlMessage = CMSG_FIRSTHDR(&message); controlMessage;
+          controlMessage = CMSG_NXTHDR(&message, controlMessage)) {
+        if (controlMessage->cmsg_level != SOL_SOCKET
+            || controlMessage->cmsg_type != SCM_RIGHTS) {
+          continue;
+        }
+        std::size_t count = (controlMessage->cmsg_len - CMSG_LEN(0))
+            / sizeof(int);
+        for (std::size_t i = 0; i < count; ++i) {
+          int fd;
+          std::memcpy(&fd, CMSG_DATA(controlMessage) + i * sizeof(int),
+              sizeof(int));
+          if (numberOfFds < 3) {
+            ::fcntl(fd, F_SETFD, ::fcntl(fd, F_GETFD) | FD_CLOEXEC);
+            fds[numberOfFds] = fd;
+            ++numberOfFds;
+          } else {
+            ::close(fd);
+          }
+        }
+      }
+      if (message.msg_flags & MSG_TRUNC) {
+        // The IOC never sends requests that are larger than our buffer, so
+        // this should not happen.
+        for (std::size_t i = 0; i < numberOfFds; ++i) {
+          ::close(fds[i]);
+        }
+        continue;
+      }
+      handleRequest(socketFd, length, fds, numberOfFds);
+    }
+  }
+  ::_exit(0);
+}
+
+} // namespace server
+
+void appendString(std::vector<char> &buffer, char const *str) {
+  buffer.insert(buffer.end(), str, str + std::strlen(str) + 1);
+}
+
+} // anonymous namespace
+
+ForkServer ForkServer::instance;
+
+ForkServer::ForkServer() : nextRequestId(1), running(false), serverPid(-1),
+    socketFd(-1), started(false) {
+}
+
+bool ForkServer::spawn(SpawnParameters const &parameters, ::pid_t &childPid,
+    int &execveErrorNumber, ChildTerminationHandler terminationHandler) {
+  if (!isRunning()) {
+    return false;
+  }
+  RequestHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.type = MessageType::spawn;
+  std::vector<char> request(sizeof(header));
+  appendString(request, parameters.path);
+  for (auto arg = parameters.argv; *arg; ++arg) {
+    appendString(request, *arg);
+    ++header.argc;
+  }
+  for (auto env = parameters.envp; *env; ++env) {
+    appendString(request, *env);
+    ++header.envc;
+  }
+  if (request.size() > maxRequestSize
+      || header.argc + header.envc > maxStrings) {
+    // The request is too large for the fork server, so the calling code has
+    // to create the process itself.
+    return false;
+  }
+  int fds[3];
+  std::size_t numberOfFds = 0;
+  if (parameters.stdinFd != -1) {
+    header.fdMask |= fdMaskStdIn;
+    fds[numberOfFds++] = parameters.stdinFd;
+  }
+  if (parameters.stdoutFd != -1) {
+    header.fdMask |= fdMaskStdOut;
+    fds[numberOfFds++] = parameters.stdoutFd;
+  }
+  if (parameters.stderrFd != -1) {
+    header.fdMask |= fdMaskStdErr;
+    fds[numberOfFds++] = parameters.stderrFd;
+  }
+  auto pendingRequest = std::make_shared<PendingRequest>();
+  pendingRequest->terminationHandler = std::move(terminationHandler);
+  auto spawnedFuture = pendingRequest->spawnedPromise.get_future();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    // We have to check the flag again while holding the mutex. Otherwise, the
+    // receiver thread might already have failed all pending requests, and our
+    // request would never complete.
+    if (!isRunning()) {
+      return false;
+    }
+    header.requestId = nextRequestId++;
+    pendingRequests[header.requestId] = pendingRequest;
+  }
+  std::memcpy(request.data(), &header, sizeof(header));
+  ::iovec iov;
+  iov.iov_base = request.data();
+  iov.iov_len = request.size();
+  ::msghdr message;
+  std::memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  union {
+    ::cmsghdr header;
+    char buffer[CMSG_SPACE(3 * sizeof(int))];
+  } control;
+  if (numberOfFds) {
+    std::memset(&control, 0, sizeof(control));
+    message.msg_control = control.buffer;
+    message.msg_controllen = CMSG_SPACE(numberOfFds * sizeof(int));
+    auto controlMessage = CMSG_FIRSTHDR(&message);
+    controlMessage->cmsg_level = SOL_SOCKET;
+    controlMessage->cmsg_type = SCM_RIGHTS;
+    controlMessage->cmsg_len = CMSG_LEN(numberOfFds * sizeof(int));
+    std::memcpy(CMSG_DATA(controlMessage), fds, numberOfFds * sizeof(int));
+  }
+  ::ssize_t bytesSent;
+  do {
+    bytesSent = ::sendmsg(socketFd, &message, sendFlags);
+  } while (bytesSent == -1 && errno == EINTR);
+  if (bytesSent == -1) {
+    // If the request could not be sent (e.g. because it is too large for the
+    // socket or because the fork server has terminated), the fork server does
+    // not know about it, so it is safe to fall back to creating the process in
+    // the IOC.
+    removePendingRequest(header.requestId);
+    return false;
+  }
+  // If the fork server terminates before creating the process, get() throws.
+  execveErrorNumber = spawnedFuture.get();
+  if (execveErrorNumber) {
+    childPid = -1;
+  } else {
+    childPid = pendingRequest->childPid;
+  }
+  return true;
+}
+
+void ForkServer::start() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (started) {
+    throw std::logic_error("The fork server has already been started.");
+  }
+  // The sysconf function is not async-signal-safe, so we have to call it
+  // before forking.
+  int maxFd = ::sysconf(_SC_OPEN_MAX);
+  if (maxFd == -1) {
+    throw std::system_error(std::error_code(errno, std::system_category()),
+        "sysconf(_SC_OPEN_MAX) failed");
+  }
+  // Neither end of the socket must be inherited by processes that are created
+  // by the IOC.
+  int socketType = SOCK_SEQPACKET;
+#ifdef SOCK_CLOEXEC
+  socketType |= SOCK_CLOEXEC;
+#endif // SOCK_CLOEXEC
+  int socketFds[2];
+  if (::socketpair(AF_UNIX, socketType, 0, socketFds)) {
+    throw std::system_error(std::error_code(errno, std::system_category()),
+        "socketpair() failed");
+  }
+#ifndef SOCK_CLOEXEC
+  ::fcntl(socketFds[0], F_SETFD, ::fcntl(socketFds[0], F_GETFD) | FD_CLOEXEC);
+  ::fcntl(socketFds[1], F_SETFD, ::fcntl(socketFds[1], F_GETFD) | FD_CLOEXEC);
+#endif // SOCK_CLOEXEC
+  auto pid = ::fork();
+  if (pid == 0) {
+    server::serverMain(socketFds[1], maxFd);
+  } else if (pid == -1) {
+    std::system_error e(std::error_code(errno, std::system_category()),
+        "fork() failed");
+    ::close(socketFds[0]);
+    ::close(socketFds[1]);
+    throw e;
+  }
+  ::close(socketFds[1]);
+  this->socketFd = socketFds[0];
+  this->serverPid = pid;
+  this->started = true;
+  this->running.store(true, std::memory_order_release);
+  // The receiver thread runs for the lifetime of the fork server, so we can
+  // detach it.
+  std::thread(&ForkServer::receiveReplies, this).detach();
+}
+
+void ForkServer::receiveReplies() {
+  while (true) {
+    Reply reply;
+    auto length = ::recv(socketFd, &reply, sizeof(reply), 0);
+    if (length == -1 && errno == EINTR) {
+      continue;
+    }
+    if (length != sizeof(reply)) {
+      // The fork server has terminated (or sent garbage, which should never
+      // happen).
+      break;
+    }
+    std::shared_ptr<PendingRequest> pendingRequest;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto entry = pendingRequests.find(reply.requestId);
+      if (entry == pendingRequests.end()) {
+        continue;
+      }
+      pendingRequest = entry->second;
+      // After the child process has terminated or if it could not be created,
+      // we will not receive any more replies for the request.
+      if (reply.type == MessageType::exited
+          || (reply.type == MessageType::spawned && reply.errorNumber)) {
+        pendingRequests.erase(entry);
+      }
+    }
+    switch (reply.type) {
+    case MessageType::spawned:
+      pendingRequest->childPid = reply.value;
+      pendingRequest->spawned = true;
+      pendingRequest->spawnedPromise.set_value(reply.errorNumber);
+      break;
+    case MessageType::exited:
+      pendingRequest->terminationHandler(reply.value, std::exception_ptr());
+      break;
+    default:
+      break;
+    }
+  }
+  std::unordered_map<std::uint64_t, std::shared_ptr<PendingRequest>>
+      failedRequests;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    running.store(false, std::memory_order_release);
+    failedRequests.swap(pendingRequests);
+  }
+  // We cannot know what happened to the processes created by the fork server,
+  // so all pending requests fail. Future requests are handled by the IOC.
+  auto exception = std::make_exception_ptr(std::system_error(
+      std::error_code(ECONNRESET, std::system_category()),
+      "The fork server terminated unexpectedly"));
+  for (auto &entry : failedRequests) {
+    if (entry.second->spawned) {
+      entry.second->terminationHandler(0, exception);
+    } else {
+      entry.second->spawnedPromise.set_exception(exception);
+    }
+  }
+  // We do not close the socket because other threads might still try to use
+  // it, and the file descriptor could be reused in the meantime. As the other
+  // end has been closed, sending on the socket simply fails.
+  ::waitpid(serverPid, nullptr, 0);
+}
+
+void ForkServer::removePendingRequest(std::uint64_t requestId) {
+  std::lock_guard<std::mutex> lock(mutex);
+  pendingRequests.erase(requestId);
+}
+
+} // namespace execute
+} // namespace epics
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_FORK_SERVER_H
+#define EPICS_EXEC_FORK_SERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+extern "C" {
+#include <sys/types.h>
+}
+
+#include "ChildReaper.h"
+#include "spawnProcess.h"
+
+namespace epics {
+namespace execute {
+
+/**
+ * Helper process that creates child processes on behalf of the IOC.
+ *
+ * Creating a child process from a large, multi-threaded process is expensive.
+ * The fork server is a small, single-threaded process that is forked from the
+ * IOC once (typically before iocInit). After that, the IOC sends requests for
+ * creating child processes to the fork server over a Unix domain socket,
+ * passing the file descriptors for the standard input and output along with
+ * the request. The fork server creates the child process and reports the exit
+ * status back to the IOC once the child process has terminated. This way, the
+ * cost of creating a child process does not depend on the size of the IOC.
+ *
+ * If the fork server terminates, the IOC falls back to creating child
+ * processes itself.
+ */
+class ForkServer {
+
+public:
+
+  /**
+   * Returns the only instance of this class.
+   */
+  inline static ForkServer &getInstance() {
+    return instance;
+  }
+
+  /**
+   * Tells whether the fork server has been started and is still running.
+   */
+  inline bool isRunning() const {
+    return running.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Creates a child process through the fork server. If the fork server is not
+   * running, this method returns false and the calling code has to create the
+   * child process itself.
+   *
+   * If the fork server is running, this method returns true once the child
+   * process has been created. If execve() fails in the child process, childPid
+   * is set to -1 and execveErrorNumber is set to the error number. Otherwise,
+   * childPid is set to the process ID of the child process (in the fork
+   * server's PID namespace, which is the same as the IOC's) and
+   * execveErrorNumber is set to zero. The child process is reaped by the fork
+   * server, so the calling code must not call waitpid(). Instead, the
+   * termination handler is called with the status (as reported by waitpid())
+   * of the child process once it has terminated. The handler is called from
+   * an internal thread, so it must not block and must not throw. It is only
+   * called if this method returns true and execveErrorNumber is zero. If the
+   * fork server terminates before the child process, the handler is called
+   * with an error.
+   *
+   * The maxFd field of the spawn parameters is ignored.
+   *
+   * @throws std::system_error if the fork server terminates after the request
+   *     has been sent, but before the child process has been created.
+   */
+  bool spawn(SpawnParameters const &parameters, ::pid_t &childPid,
+      int &execveErrorNumber, ChildTerminationHandler terminationHandler);
+
+  /**
+   * Starts the fork server. This should be done as early as possible, because
+   * the fork server is forked from the IOC process and thus starts with a
+   * copy of the IOC's address space.
+   *
+   * @throws std::logic_error if the fork server has already been started.
+   * @throws std::system_error if the fork server cannot be started.
+   */
+  void start();
+
+private:
+
+  /**
+   * State of a request that has been sent to the fork server, but for which
+   * the child process has not terminated yet.
+   */
+  struct PendingRequest {
+    std::promise<int> spawnedPromise;
+    ChildTerminationHandler terminationHandler;
+    ::pid_t childPid = -1;
+    bool spawned = false;
+  };
+
+  static ForkServer instance;
+
+  std::mutex mutex;
+  std::uint64_t nextRequestId;
+  std::unordered_map<std::uint64_t, std::shared_ptr<PendingRequest>>
+      pendingRequests;
+  std::atomic<bool> running;
+  ::pid_t serverPid;
+  int socketFd;
+  bool started;
+
+  // We do not want to allow copy or move construction or assignment.
+  ForkServer(ForkServer const &) = delete;
+  ForkServer(ForkServer &&) = delete;
+  ForkServer &operator=(ForkServer const &) = delete;
+  ForkServer &operator=(ForkServer &&) = delete;
+
+  ForkServer();
+
+  void receiveReplies();
+
+  void removePendingRequest(std::uint64_t requestId);
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_FORK_SERVER_H
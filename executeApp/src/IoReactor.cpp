@@ -0,0 +1,347 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+extern "C" {
+#include <errno.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif // __linux__
+}
+
+#include "IoReactor.h"
+#include "fileDescriptors.h"
+
+namespace epics {
+namespace execute {
+
+namespace {
+
+/**
+ * Registration ID used for the read end of the wake-up pipe. Regular
+ * registrations never use this ID.
+ */
+std::uint32_t const wakeUpRegistrationId = 0;
+
+#ifdef __linux__
+
+/**
+ * Packs a file descriptor and a registration ID into the user data that is
+ * stored with an epoll event.
+ */
+inline std::uint64_t packEventData(int fd, std::uint32_t registrationId) {
+  return (static_cast<std::uint64_t>(registrationId) << 32)
+      | static_cast<std::uint32_t>(fd);
+}
+
+#endif // __linux__
+
+} // anonymous namespace
+
+IoReactor IoReactor::instance;
+
+IoReactor::IoReactor() : epollFd(-1), nextRegistrationId(1), started(false),
+    wakeUpPending(false), wakeUpReadFd(-1), wakeUpWriteFd(-1) {
+}
+
+void IoReactor::addFd(int fd, std::uint32_t events, Handler handler) {
+  std::lock_guard<std::mutex> lock(mutex);
+  ensureStarted();
+  if (registrations.count(fd)) {
+    throw std::invalid_argument(
+        "The file descriptor has already been registered.");
+  }
+  auto registrationId = nextRegistrationId++;
+  if (nextRegistrationId == wakeUpRegistrationId) {
+    ++nextRegistrationId;
+  }
+#ifdef __linux__
+  ::epoll_event event;
+  event.events = ((events & readable) ? std::uint32_t(EPOLLIN) : 0)
+      | ((events & writable) ? std::uint32_t(EPOLLOUT) : 0);
+  event.data.u64 = packEventData(fd, registrationId);
+  if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event)) {
+    throw std::system_error(std::error_code(errno, std::system_category()),
+        "epoll_ctl() failed");
+  }
+#endif // __linux__
+  Registration registration;
+  registration.id = registrationId;
+  registration.events = events;
+  registration.handler = std::make_shared<Handler>(std::move(handler));
+  registrations.insert(std::make_pair(fd, std::move(registration)));
+#ifndef __linux__
+  // poll() only picks up the new file descriptor when the event loop builds
+  // the next set of file descriptors, so we have to wake it up.
+  wakeUp();
+#endif // __linux__
+}
+
+void IoReactor::post(Task task) {
+  std::lock_guard<std::mutex> lock(mutex);
+  ensureStarted();
+  pendingTasks.push_back(std::move(task));
+  wakeUp();
+}
+
+void IoReactor::postDelayed(std::chrono::steady_clock::duration delay,
+    Task task) {
+  std::lock_guard<std::mutex> lock(mutex);
+  ensureStarted();
+  delayedTasks.insert(std::make_pair(
+      std::chrono::steady_clock::now() + delay, std::move(task)));
+  // The event loop has to recalculate its timeout, so we wake it up.
+  wakeUp();
+}
+
+void IoReactor::removeFd(int fd) noexcept {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!registrations.erase(fd)) {
+    return;
+  }
+#ifdef __linux__
+  // The file descriptor is still open (the calling code closes it after
+  // removing it), so this call should not fail. Even if it did, an event for
+  // this file descriptor would not be dispatched, because the registration
+  // does not exist any longer.
+  ::epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+#endif // __linux__
+}
+
+void IoReactor::dispatch(int fd, std::uint32_t registrationId) {
+  std::shared_ptr<Handler> handler;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto registration = registrations.find(fd);
+    if (registration == registrations.end()
+        || registration->second.id != registrationId) {
+      // The file descriptor has been removed after the event was read.
+      return;
+    }
+    handler = registration->second.handler;
+  }
+  // We call the handler without holding the mutex, so that it can register
+  // or remove file descriptors. Handlers are not supposed to throw, but if
+  // one does anyway, we must not let the exception terminate the event loop.
+  try {
+    (*handler)();
+  } catch (...) {
+  }
+}
+
+void IoReactor::ensureStarted() {
+  // This method is only called while holding the mutex.
+  if (started) {
+    return;
+  }
+  int wakeUpPipe[2];
+  createPipe(wakeUpPipe);
+  try {
+    setNonBlocking(wakeUpPipe[0]);
+    setNonBlocking(wakeUpPipe[1]);
+#ifdef __linux__
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd == -1) {
+      throw std::system_error(std::error_code(errno, std::system_category()),
+          "epoll_create1() failed");
+    }
+    ::epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u64 = packEventData(wakeUpPipe[0], wakeUpRegistrationId);
+    if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeUpPipe[0], &event)) {
+      throw std::system_error(std::error_code(errno, std::system_category()),
+          "epoll_ctl() failed");
+    }
+#endif // __linux__
+    wakeUpReadFd = wakeUpPipe[0];
+    wakeUpWriteFd = wakeUpPipe[1];
+    // The reactor is never destroyed (except when the process exits), so we
+    // can simply detach the thread.
+    std::thread(&IoReactor::runEventLoop, this).detach();
+  } catch (...) {
+    if (epollFd != -1) {
+      ::close(epollFd);
+      epollFd = -1;
+    }
+    ::close(wakeUpPipe[0]);
+    ::close(wakeUpPipe[1]);
+    wakeUpReadFd = -1;
+    wakeUpWriteFd = -1;
+    throw;
+  }
+  started = true;
+}
+
+int IoReactor::getTimeoutMilliseconds() {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (delayedTasks.empty()) {
+    return -1;
+  }
+  auto delay = delayedTasks.begin()->first - std::chrono::steady_clock::now();
+  if (delay <= std::chrono::steady_clock::duration::zero()) {
+    return 0;
+  }
+  // We round up, so that we do not wake up before the task is due and then
+  // spin with a timeout of zero.
+  auto milliseconds =
+      std::chrono::duration_cast<std::chrono::milliseconds>(delay).count() + 1;
+  return milliseconds > 60000 ? 60000 : static_cast<int>(milliseconds);
+}
+
+void IoReactor::runDelayedTasks() {
+  std::vector<Task> tasks;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = std::chrono::steady_clock::now();
+    auto end = delayedTasks.upper_bound(now);
+    for (auto i = delayedTasks.begin(); i != end; ++i) {
+      tasks.push_back(std::move(i->second));
+    }
+    delayedTasks.erase(delayedTasks.begin(), end);
+  }
+  for (auto &task : tasks) {
+    try {
+      task();
+    } catch (...) {
+    }
+  }
+}
+
+void IoReactor::runEventLoop() {
+#ifdef __linux__
+  ::epoll_event events[64];
+  while (true) {
+    int numberOfEvents = ::epoll_wait(epollFd, events,
+        sizeof(events) / sizeof(events[0]), getTimeoutMilliseconds());
+    runDelayedTasks();
+    // epoll_wait can only fail with EINTR, unless there is a bug in this
+    // code.
+    if (numberOfEvents == -1) {
+      continue;
+    }
+    for (int i = 0; i < numberOfEvents; ++i) {
+      auto fd = static_cast<int>(events[i].data.u64 & 0xffffffffU);
+      auto registrationId =
+          static_cast<std::uint32_t>(events[i].data.u64 >> 32);
+      if (registrationId == wakeUpRegistrationId) {
+        runPendingTasks();
+      } else {
+        dispatch(fd, registrationId);
+      }
+    }
+  }
+#else
+  std::vector<::pollfd> pollFds;
+  std::vector<std::uint32_t> registrationIds;
+  while (true) {
+    // We rebuild the set of file descriptors in each iteration. This is less
+    // efficient than epoll, but poll() is only used on platforms where epoll
+    // is not available.
+    pollFds.clear();
+    registrationIds.clear();
+    ::pollfd pollFd;
+    pollFd.fd = wakeUpReadFd;
+    pollFd.events = POLLIN;
+    pollFd.revents = 0;
+    pollFds.push_back(pollFd);
+    registrationIds.push_back(wakeUpRegistrationId);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto &registration : registrations) {
+        pollFd.fd = registration.first;
+        pollFd.events = ((registration.second.events & readable) ? POLLIN : 0)
+            | ((registration.second.events & writable) ? POLLOUT : 0);
+        pollFds.push_back(pollFd);
+        registrationIds.push_back(registration.second.id);
+      }
+    }
+    int numberOfEvents = ::poll(pollFds.data(), pollFds.size(),
+        getTimeoutMilliseconds());
+    runDelayedTasks();
+    if (numberOfEvents == -1) {
+      continue;
+    }
+    for (std::size_t i = 0; i < pollFds.size(); ++i) {
+      if (!pollFds[i].revents) {
+        continue;
+      }
+      if (registrationIds[i] == wakeUpRegistrationId) {
+        runPendingTasks();
+      } else {
+        dispatch(pollFds[i].fd, registrationIds[i]);
+      }
+    }
+  }
+#endif // __linux__
+}
+
+void IoReactor::runPendingTasks() {
+  std::vector<Task> tasks;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    // We drain the wake-up pipe while holding the mutex, so that we do not
+    // miss a wake-up that happens after we have taken the tasks.
+    char buffer[64];
+    while (::read(wakeUpReadFd, buffer, sizeof(buffer)) > 0) {
+    }
+    wakeUpPending = false;
+    tasks.swap(pendingTasks);
+  }
+  for (auto &task : tasks) {
+    try {
+      task();
+    } catch (...) {
+    }
+  }
+}
+
+void IoReactor::wakeUp() {
+  // This method is only called while holding the mutex. We only write to the
+  // pipe if there is no wake-up pending already, so that the pipe never
+  // fills up.
+  if (wakeUpPending) {
+    return;
+  }
+  char c = 0;
+  // A write can only fail if the pipe is full, and in this case, the event
+  // loop is going to wake up anyway.
+  if (::write(wakeUpWriteFd, &c, 1) == 1) {
+    wakeUpPending = true;
+  }
+}
+
+} // namespace execute
+} // namespace epics
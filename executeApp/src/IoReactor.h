@@ -0,0 +1,192 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_IO_REACTOR_H
+#define EPICS_EXEC_IO_REACTOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace epics {
+namespace execute {
+
+/**
+ * Event loop that multiplexes non-blocking file descriptors in a single
+ * thread.
+ *
+ * Code that wants to be notified when a file descriptor is ready registers a
+ * handler through addFd(...). The handler is called in the reactor's thread
+ * whenever the file descriptor is ready for the requested type of I/O (or an
+ * error or hang-up has been detected on the file descriptor). The handler is
+ * expected to perform the I/O without blocking (the file descriptor should
+ * have the O_NONBLOCK flag set) and to remove the file descriptor through
+ * removeFd(int) before closing it. The reactor uses level-triggered
+ * notifications, so a handler does not have to process all available data in
+ * a single call.
+ *
+ * On Linux, the reactor uses epoll. On other platforms, it uses poll().
+ *
+ * The reactor's thread is started on first use, so using this class does not
+ * have any overhead for IOCs that never run a command.
+ */
+class IoReactor {
+
+public:
+
+  /**
+   * Handler that is called when a file descriptor is ready.
+   */
+  using Handler = std::function<void()>;
+
+  /**
+   * Task that is run in the reactor's thread.
+   */
+  using Task = std::function<void()>;
+
+  /**
+   * Event flag indicating interest in the file descriptor becoming readable.
+   */
+  static std::uint32_t const readable = 1;
+
+  /**
+   * Event flag indicating interest in the file descriptor becoming writable.
+   */
+  static std::uint32_t const writable = 2;
+
+  /**
+   * Returns the only instance of this class.
+   */
+  inline static IoReactor &getInstance() {
+    return instance;
+  }
+
+  /**
+   * Registers a file descriptor with the reactor. The handler is called in
+   * the reactor's thread when the file descriptor is ready for the type of
+   * I/O specified through events (a combination of readable and writable). A
+   * file descriptor can only be registered once. The handler must not throw.
+   *
+   * @throws std::invalid_argument if the file descriptor is already
+   *     registered.
+   * @throws std::system_error if the file descriptor cannot be registered or
+   *     the reactor's thread cannot be started.
+   */
+  void addFd(int fd, std::uint32_t events, Handler handler);
+
+  /**
+   * Schedules a task for execution in the reactor's thread. The task must not
+   * block and must not throw.
+   *
+   * @throws std::system_error if the reactor's thread cannot be started.
+   */
+  void post(Task task);
+
+  /**
+   * Schedules a task for execution in the reactor's thread once the specified
+   * delay has passed. The task might run slightly later than requested, but
+   * never earlier. Like for post(Task), the task must not block and must not
+   * throw. Delayed tasks cannot be cancelled, so a task that is not needed
+   * any longer has to detect this itself.
+   *
+   * @throws std::system_error if the reactor's thread cannot be started.
+   */
+  void postDelayed(std::chrono::steady_clock::duration delay, Task task);
+
+  /**
+   * Removes a file descriptor from the reactor. This must be called before
+   * the file descriptor is closed. Once this method returns, the handler
+   * registered for the file descriptor is not going to be called again,
+   * unless this method is called from a thread other than the reactor's
+   * thread while the handler is running. For this reason, this method should
+   * typically be called from within the handler. If the file descriptor is
+   * not registered, this method does nothing.
+   */
+  void removeFd(int fd) noexcept;
+
+private:
+
+  /**
+   * Information about a file descriptor that has been registered. The ID
+   * distinguishes registrations for file descriptors that have been closed
+   * and reused, so that an event that has been read for a previous
+   * registration is not dispatched to the handler of the new registration.
+   */
+  struct Registration {
+    std::uint32_t id;
+    std::uint32_t events;
+    std::shared_ptr<Handler> handler;
+  };
+
+  static IoReactor instance;
+
+  std::multimap<std::chrono::steady_clock::time_point, Task> delayedTasks;
+  int epollFd;
+  std::mutex mutex;
+  std::uint32_t nextRegistrationId;
+  std::vector<Task> pendingTasks;
+  std::unordered_map<int, Registration> registrations;
+  bool started;
+  bool wakeUpPending;
+  int wakeUpReadFd;
+  int wakeUpWriteFd;
+
+  // We do not want to allow copy or move construction or assignment.
+  IoReactor(IoReactor const &) = delete;
+  IoReactor(IoReactor &&) = delete;
+  IoReactor &operator=(IoReactor const &) = delete;
+  IoReactor &operator=(IoReactor &&) = delete;
+
+  IoReactor();
+
+  void dispatch(int fd, std::uint32_t registrationId);
+
+  void ensureStarted();
+
+  int getTimeoutMilliseconds();
+
+  void runDelayedTasks();
+
+  void runEventLoop();
+
+  void runPendingTasks();
+
+  void wakeUp();
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_IO_REACTOR_H
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "IoReactor.h"
+#include "LineStream.h"
+
+namespace epics {
+namespace execute {
+
+LineStream::Writer::Writer(std::shared_ptr<LineStream> const &stream) :
+    closed(false), stream(stream) {
+}
+
+LineStream::Writer::~Writer() {
+  // Destructors must not throw, and there is nothing we could do about an
+  // error anyway.
+  try {
+    close();
+  } catch (...) {
+  }
+}
+
+void LineStream::Writer::close() {
+  if (this->closed) {
+    return;
+  }
+  this->closed = true;
+  if (!this->partialLine.empty()) {
+    this->stream->addLine(std::move(this->partialLine));
+    this->partialLine.clear();
+  }
+  this->stream->publish();
+}
+
+void LineStream::Writer::write(char const *data, std::size_t size) {
+  while (size > 0) {
+    auto newline = static_cast<char const *>(std::memchr(data, '\n', size));
+    std::size_t segmentLength = newline ? newline - data : size;
+    // A line that is too long is split, so that a program that never writes
+    // a newline character cannot make us use an unbounded amount of memory.
+    while (this->partialLine.size() + segmentLength > maxLineLength) {
+      auto length = maxLineLength - this->partialLine.size();
+      this->partialLine.append(data, length);
+      data += length;
+      size -= length;
+      segmentLength -= length;
+      this->stream->addLine(std::move(this->partialLine));
+      this->partialLine.clear();
+    }
+    this->partialLine.append(data, segmentLength);
+    data += segmentLength;
+    size -= segmentLength;
+    if (newline) {
+      ++data;
+      --size;
+      if (!this->partialLine.empty() && this->partialLine.back() == '\r') {
+        this->partialLine.pop_back();
+      }
+      this->stream->addLine(std::move(this->partialLine));
+      this->partialLine.clear();
+    }
+  }
+}
+
+LineStream::LineStream() :
+    listeners(std::make_shared<std::vector<Listener>>()),
+    lastSequenceNumber(0), publishedSequenceNumber(0), timerGeneration(0),
+    timerPending(false) {
+  this->options.maxBufferedLines = 100;
+  this->options.maxUpdateDelay = std::chrono::milliseconds(0);
+  this->options.maxUpdateLines = 1;
+}
+
+void LineStream::addListener(Listener listener) {
+  std::lock_guard<std::mutex> lock(mutex);
+  // The list of listeners is copied when it is modified, so that
+  // notifyListeners() can call the listeners without holding the mutex.
+  auto newListeners = std::make_shared<std::vector<Listener>>(
+      *this->listeners);
+  newListeners->push_back(std::move(listener));
+  this->listeners = std::move(newListeners);
+}
+
+LineStream::Options LineStream::getOptions() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return this->options;
+}
+
+bool LineStream::read(std::uint64_t &sequenceNumber, std::size_t maxSize,
+    bool lastLineOnly, std::string &text) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (sequenceNumber >= this->publishedSequenceNumber) {
+    return false;
+  }
+  // The lines that are still buffered might include lines that have not been
+  // published yet, and the lines that have been published might not be
+  // buffered any longer.
+  auto firstBufferedSequenceNumber =
+      this->lastSequenceNumber - this->lines.size() + 1;
+  auto first = std::max(sequenceNumber + 1, firstBufferedSequenceNumber);
+  auto last = this->publishedSequenceNumber;
+  sequenceNumber = last;
+  if (first > last) {
+    return false;
+  }
+  auto begin = this->lines.begin() + (first - firstBufferedSequenceNumber);
+  auto end = this->lines.begin() + (last - firstBufferedSequenceNumber + 1);
+  auto &newestLine = *(end - 1);
+  if (lastLineOnly) {
+    text.assign(newestLine, 0, std::min(newestLine.size(), maxSize));
+    return true;
+  }
+  // We keep as many of the newest lines as fit into maxSize.
+  std::size_t size = 0;
+  auto keptBegin = end;
+  while (keptBegin != begin && size + (keptBegin - 1)->size() + 1 <= maxSize) {
+    --keptBegin;
+    size += keptBegin->size() + 1;
+  }
+  if (keptBegin == end) {
+    text.assign(newestLine, 0, std::min(newestLine.size(), maxSize));
+    return true;
+  }
+  text.clear();
+  text.reserve(size);
+  for (auto line = keptBegin; line != end; ++line) {
+    text.append(*line);
+    text.push_back('\n');
+  }
+  return true;
+}
+
+void LineStream::setOptions(Options const &options) {
+  if (options.maxBufferedLines == 0) {
+    throw std::invalid_argument(
+        "The max. number of buffered lines must be greater than zero.");
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  this->options = options;
+}
+
+void LineStream::addLine(std::string line) {
+  bool publishNow = false;
+  bool startTimer = false;
+  std::chrono::milliseconds delay;
+  std::uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->lines.push_back(std::move(line));
+    ++this->lastSequenceNumber;
+    while (this->lines.size() > this->options.maxBufferedLines) {
+      this->lines.pop_front();
+    }
+    delay = this->options.maxUpdateDelay;
+    auto maxUpdateLines = this->options.maxUpdateLines;
+    if (maxUpdateLines == 0 && delay.count() <= 0) {
+      maxUpdateLines = 1;
+    }
+    auto pendingLines = this->lastSequenceNumber
+        - this->publishedSequenceNumber;
+    if (maxUpdateLines != 0 && pendingLines >= maxUpdateLines) {
+      publishNow = true;
+      this->publishedSequenceNumber = this->lastSequenceNumber;
+      this->timerPending = false;
+      ++this->timerGeneration;
+    } else if (delay.count() > 0 && !this->timerPending) {
+      // The timer is started by the first line of an update. The generation
+      // allows the timer to detect that the update has been published
+      // already.
+      startTimer = true;
+      this->timerPending = true;
+      generation = this->timerGeneration;
+    }
+  }
+  if (startTimer) {
+    std::weak_ptr<LineStream> weakThis(shared_from_this());
+    try {
+      IoReactor::getInstance().postDelayed(delay, [weakThis, generation]() {
+        auto sharedThis = weakThis.lock();
+        if (sharedThis) {
+          sharedThis->publishFromTimer(generation);
+        }
+      });
+    } catch (...) {
+      // If we cannot start the timer, we publish the line right away, so that
+      // it is not delayed indefinitely.
+      publish();
+    }
+  }
+  if (publishNow) {
+    notifyListeners();
+  }
+}
+
+void LineStream::publish() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (this->publishedSequenceNumber == this->lastSequenceNumber) {
+      return;
+    }
+    this->publishedSequenceNumber = this->lastSequenceNumber;
+    this->timerPending = false;
+    ++this->timerGeneration;
+  }
+  notifyListeners();
+}
+
+void LineStream::publishFromTimer(std::uint64_t generation) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!this->timerPending || generation != this->timerGeneration) {
+      return;
+    }
+  }
+  publish();
+}
+
+void LineStream::notifyListeners() {
+  std::shared_ptr<std::vector<Listener> const> listeners;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    listeners = this->listeners;
+  }
+  for (auto &listener : *listeners) {
+    listener();
+  }
+}
+
+} // namespace execute
+} // namespace epics
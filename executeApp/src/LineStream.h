@@ -0,0 +1,225 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_LINE_STREAM_H
+#define EPICS_EXEC_LINE_STREAM_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace epics {
+namespace execute {
+
+/**
+ * Stream of lines written by a command to its standard output while it is
+ * running.
+ *
+ * The data read from the pipe is split into lines by a Writer. Lines are not
+ * made visible to readers one by one, but in updates. An update is published
+ * once a certain number of lines has been collected or once the first line
+ * of the update has been waiting for a certain amount of time (see Options).
+ * When an update is published, all listeners are notified.
+ *
+ * Each reader keeps its own position in the stream (a sequence number), so
+ * several readers can read the same lines. Only a limited number of lines is
+ * kept, so a reader that does not keep up misses the oldest lines.
+ *
+ * This class is thread-safe.
+ */
+class LineStream : public std::enable_shared_from_this<LineStream> {
+
+public:
+
+  /**
+   * Handler that is called when an update has been published. Listeners are
+   * called from the I/O reactor's thread, so they must not block.
+   */
+  using Listener = std::function<void()>;
+
+  /**
+   * Options controlling when lines are published.
+   */
+  struct Options {
+
+    /**
+     * Maximum number of lines that are kept for readers. When more lines are
+     * written before a reader reads them, the reader misses the oldest lines.
+     */
+    std::size_t maxBufferedLines;
+
+    /**
+     * Maximum time that a line waits for more lines before an update is
+     * published. If zero, an update is only published once maxUpdateLines
+     * have been collected or the program closes its standard output.
+     */
+    std::chrono::milliseconds maxUpdateDelay;
+
+    /**
+     * Number of lines after which an update is published. If zero, only
+     * maxUpdateDelay limits the size of an update. If both are zero, each
+     * line is published on its own.
+     */
+    std::size_t maxUpdateLines;
+
+  };
+
+  /**
+   * Splits the data written by a single run into lines. Each run uses its
+   * own writer, so that partial lines from concurrent runs are not mixed.
+   * This class is not thread-safe, but it is only used by the I/O reactor's
+   * thread.
+   */
+  class Writer {
+
+  public:
+
+    /**
+     * Creates a writer that adds lines to the specified stream.
+     */
+    Writer(std::shared_ptr<LineStream> const &stream);
+
+    /**
+     * Publishes a pending partial line and the current update (see close()).
+     */
+    ~Writer();
+
+    /**
+     * Marks the end of the data. A partial line that has not been terminated
+     * by a newline character is added as a line, and the lines that have
+     * not been published yet are published right away.
+     */
+    void close();
+
+    /**
+     * Adds data. Each newline character terminates a line. The newline
+     * character (and a carriage return preceding it) is not part of the
+     * line. Lines that are longer than maxLineLength are split.
+     */
+    void write(char const *data, std::size_t size);
+
+  private:
+
+    bool closed;
+    std::string partialLine;
+    std::shared_ptr<LineStream> stream;
+
+    // We do not want to allow copy or move construction and assignment.
+    Writer(Writer const &) = delete;
+    Writer(Writer &&) = delete;
+    Writer &operator=(Writer const &) = delete;
+    Writer &operator=(Writer &&) = delete;
+
+  };
+
+  /**
+   * Maximum length of a line in bytes. Longer lines are split.
+   */
+  static std::size_t const maxLineLength = 16384;
+
+  /**
+   * Creates a stream that publishes each line on its own and keeps up to 100
+   * lines.
+   */
+  LineStream();
+
+  /**
+   * Registers a listener that is called each time an update has been
+   * published.
+   */
+  void addListener(Listener listener);
+
+  /**
+   * Returns the options of this stream.
+   */
+  Options getOptions() const;
+
+  /**
+   * Reads the published lines that follow the specified sequence number. The
+   * sequence number is updated, so that the next call only returns newer
+   * lines. Readers should start with a sequence number of zero.
+   *
+   * If lastLineOnly is true, only the newest line is returned. Otherwise, the
+   * lines are returned with each line followed by a newline character. If
+   * the lines do not fit into maxSize bytes, the oldest lines are dropped (and
+   * if even the newest line does not fit, its beginning is returned).
+   *
+   * Returns false (and does not modify text) if no new lines have been
+   * published.
+   */
+  bool read(std::uint64_t &sequenceNumber, std::size_t maxSize,
+      bool lastLineOnly, std::string &text) const;
+
+  /**
+   * Changes the options of this stream. Changes take effect with the next
+   * line that is added.
+   *
+   * @throws std::invalid_argument if maxBufferedLines is zero.
+   */
+  void setOptions(Options const &options);
+
+private:
+
+  std::shared_ptr<std::vector<Listener> const> listeners;
+  std::deque<std::string> lines;
+  mutable std::mutex mutex;
+  // Sequence number of the last line (the first line has sequence number
+  // one).
+  std::uint64_t lastSequenceNumber;
+  Options options;
+  std::uint64_t publishedSequenceNumber;
+  std::uint64_t timerGeneration;
+  bool timerPending;
+
+  // We do not want to allow copy or move construction and assignment.
+  LineStream(LineStream const &) = delete;
+  LineStream(LineStream &&) = delete;
+  LineStream &operator=(LineStream const &) = delete;
+  LineStream &operator=(LineStream &&) = delete;
+
+  void addLine(std::string line);
+
+  void publish();
+
+  void publishFromTimer(std::uint64_t generation);
+
+  void notifyListeners();
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_LINE_STREAM_H
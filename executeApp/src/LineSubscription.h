@@ -0,0 +1,111 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_LINE_SUBSCRIPTION_H
+#define EPICS_EXEC_LINE_SUBSCRIPTION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+extern "C" {
+#include <dbScan.h>
+} // extern "C"
+
+#include "Command.h"
+#include "LineStream.h"
+
+namespace epics {
+namespace execute {
+
+/**
+ * Connects a record to the line stream of a command's standard output. The
+ * subscription requests that the record is processed (through I/O Intr
+ * scanning) each time an update is published and keeps track of the lines
+ * that the record has already seen.
+ *
+ * This class is used by the device supports for input records that use the
+ * "lines" option in their address. It is not thread-safe, but it is only used
+ * while the record is locked.
+ */
+class LineSubscription {
+
+public:
+
+  /**
+   * Creates a subscription to the standard output of the specified command.
+   *
+   * @throws std::invalid_argument if the command's wait flag is not set.
+   */
+  LineSubscription(std::shared_ptr<Command> const &command)
+      : sequenceNumber(0), stream(command->getStdOutLineStream()) {
+    ::scanIoInit(&ioScanPvt);
+    // The I/O scan list is never destroyed, so it is safe to capture it in
+    // the listener.
+    auto ioScanPvt = this->ioScanPvt;
+    stream->addListener([ioScanPvt]() {
+      ::scanIoRequest(ioScanPvt);
+    });
+  }
+
+  /**
+   * Returns the I/O scan list that is triggered when new lines are available.
+   */
+  inline ::IOSCANPVT getIoScanPvt() const {
+    return ioScanPvt;
+  }
+
+  /**
+   * Reads the lines that have been published since the last call. See
+   * LineStream::read for the meaning of the parameters. Returns false if no
+   * new lines are available.
+   */
+  inline bool read(std::size_t maxSize, bool lastLineOnly, std::string &text) {
+    return stream->read(sequenceNumber, maxSize, lastLineOnly, text);
+  }
+
+private:
+
+  ::IOSCANPVT ioScanPvt;
+  std::uint64_t sequenceNumber;
+  std::shared_ptr<LineStream> stream;
+
+  // We do not want to allow copy or move construction and assignment.
+  LineSubscription(LineSubscription const &) = delete;
+  LineSubscription(LineSubscription &&) = delete;
+  LineSubscription &operator=(LineSubscription const &) = delete;
+  LineSubscription &operator=(LineSubscription &&) = delete;
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_LINE_SUBSCRIPTION_H
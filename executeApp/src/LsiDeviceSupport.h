@@ -1,6 +1,6 @@
 /*
- * Copyright 2018-2021 aquenos GmbH.
- * Copyright 2018-2021 Karlsruhe Institute of Technology.
+ * Copyright 2018-2026 aquenos GmbH.
+ * Copyright 2018-2026 Karlsruhe Institute of Technology.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as
@@ -32,7 +32,9 @@
 
 #include <algorithm>
 #include <cstring>
+#include <memory>
 #include <stdexcept>
+#include <string>
 
 extern "C" {
 #include <lsiRecord.h>
@@ -40,6 +42,7 @@ extern "C" {
 } // extern "C"
 
 #include "BaseDeviceSupport.h"
+#include "LineSubscription.h"
 
 namespace epics {
 namespace execute {
@@ -48,7 +51,8 @@ namespace execute {
  * Device support class for the lsi record.
  *
  * This device support code only handles record address of type stderr or
- * stdout.
+ * stdout. When the "lines" option is used with the stdout type, the record
+ * is processed (through I/O Intr scanning) each time new lines are available.
  */
 class LsiDeviceSupport : public BaseDeviceSupport<::lsiRecord> {
 
@@ -66,6 +70,12 @@ public:
       throw std::invalid_argument(
           "Cannot read the command's output if its wait flag is not set.");
     }
+    // In line mode, the record does not read the captured output, so we do
+    // not need any capacity.
+    if (address.getOptions() & RecordAddressOption::lines) {
+      lineSubscription.reset(new LineSubscription(this->getCommand()));
+      return;
+    }
     // We must ensure that enough of the output is buffered.
     switch (this->getRecordAddress().getType()) {
     case RecordAddress::Type::standardError:
@@ -87,19 +97,41 @@ public:
   void processRecord() {
     char *recordBuffer = this->getRecord()->val;
     std::size_t recordBufferLength = this->getRecord()->sizv;
-    std::vector<char> data;
-    switch (this->getRecordAddress().getType()) {
-    case RecordAddress::Type::standardError:
-      data = this->getCommand()->getStdErrBuffer();
-      break;
-    case RecordAddress::Type::standardOutput:
-      data = this->getCommand()->getStdOutBuffer();
-      break;
-    default:
-      throw std::logic_error("Unexpected address type.");
+    // In line mode, we use the newest lines that fit into the record. If
+    // there are no new lines (e.g. because the record has been processed for a
+    // different reason), we leave the record unchanged.
+    std::string lines;
+    char const *data;
+    std::size_t dataSize;
+    if (lineSubscription) {
+      if (!lineSubscription->read(recordBufferLength - 1, false, lines)) {
+        return;
+      }
+      data = lines.data();
+      dataSize = lines.size();
+    } else {
+      // We copy the data straight from the result, which is shared with other
+      // records reading the output of the same run. If the output has been
+      // captured in a memory file, we copy directly from the mapped file.
+      // When the record is processed through the forward link of a run
+      // record, this is the result pinned for the completed run, so it
+      // matches the exit code read by other records in the same chain.
+      auto result = this->getCommand()->getResult();
+      switch (this->getRecordAddress().getType()) {
+      case RecordAddress::Type::standardError:
+        data = result->getStdErrData();
+        dataSize = result->getStdErrSize();
+        break;
+      case RecordAddress::Type::standardOutput:
+        data = result->getStdOutData();
+        dataSize = result->getStdOutSize();
+        break;
+      default:
+        throw std::logic_error("Unexpected address type.");
+      }
     }
-    auto dataLength = std::min(recordBufferLength, data.size());
-    std::memcpy(recordBuffer, data.data(), dataLength);
+    auto dataLength = std::min(recordBufferLength, dataSize);
+    std::memcpy(recordBuffer, data, dataLength);
     // If we have less data than the target buffer can take, we fill the rest of
     // the buffer with null bytes.
     // We also have to update the LEN field with the actual length of the string
@@ -116,6 +148,18 @@ public:
     }
   }
 
+  /**
+   * Returns the I/O scan list of the line subscription if the "lines" option
+   * is used and null otherwise.
+   */
+  ::IOSCANPVT getIoScanPvt() const {
+    return lineSubscription ? lineSubscription->getIoScanPvt() : nullptr;
+  }
+
+private:
+
+  std::unique_ptr<LineSubscription> lineSubscription;
+
 };
 
 } // namespace execute
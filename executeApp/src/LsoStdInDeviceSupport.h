@@ -1,6 +1,6 @@
 /*
- * Copyright 2018-2021 aquenos GmbH.
- * Copyright 2018-2021 Karlsruhe Institute of Technology.
+ * Copyright 2018-2026 aquenos GmbH.
+ * Copyright 2018-2026 Karlsruhe Institute of Technology.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as
@@ -75,8 +75,7 @@ public:
     // null-terminated, but we use std::find instead of std::strlen to be extra
     // safe.
     bufferLength = std::find(buffer, buffer + bufferLength, 0) - buffer;
-    getCommand()->setStdInBuffer(
-        std::vector<char>(buffer, buffer + bufferLength));
+    getCommand()->setStdInBuffer(buffer, bufferLength);
   }
 
 };
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+
+extern "C" {
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif // __linux__
+}
+
+#include "OutputFile.h"
+
+// Sealing memory files requires Linux 3.17 and the memfd_create() wrapper
+// requires glibc 2.27.
+#if defined(__linux__) && defined(MFD_ALLOW_SEALING) && defined(F_ADD_SEALS)
+#define EPICS_EXEC_USE_MEMFD 1
+#endif
+
+namespace epics {
+namespace execute {
+
+namespace {
+
+std::system_error makeSystemError(char const *message) {
+  return std::system_error(std::error_code(errno, std::system_category()),
+      message);
+}
+
+} // anonymous namespace
+
+OutputFile::OutputFile() : data(nullptr), fd(-1), mapping(nullptr),
+    mappingSize(0), size(0) {
+#ifdef EPICS_EXEC_USE_MEMFD
+  this->fd = ::memfd_create("execute-output", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (this->fd == -1) {
+    throw makeSystemError("memfd_create() failed");
+  }
+#else // EPICS_EXEC_USE_MEMFD
+  throw std::system_error(std::make_error_code(std::errc::not_supported),
+      "Memory files are not supported on this platform");
+#endif // EPICS_EXEC_USE_MEMFD
+}
+
+OutputFile::~OutputFile() {
+#ifdef EPICS_EXEC_USE_MEMFD
+  if (this->mapping) {
+    ::munmap(const_cast<char *>(this->mapping), this->mappingSize);
+  }
+#endif // EPICS_EXEC_USE_MEMFD
+  if (this->fd != -1) {
+    ::close(this->fd);
+  }
+}
+
+std::size_t OutputFile::map(std::size_t capacity,
+    OverflowPolicy overflowPolicy) {
+#ifdef EPICS_EXEC_USE_MEMFD
+  if (this->fd == -1) {
+    throw std::logic_error("map() must only be called once.");
+  }
+  // Other processes (e.g. background processes started by the program) might
+  // still write to the file, so we first make sure that it cannot grow any
+  // longer. This means that its size cannot change after calling fstat().
+  if (::fcntl(this->fd, F_ADD_SEALS, F_SEAL_GROW) == -1) {
+    throw makeSystemError("fcntl(F_ADD_SEALS) failed");
+  }
+  struct ::stat fileStatus;
+  if (::fstat(this->fd, &fileStatus) == -1) {
+    throw makeSystemError("fstat() failed");
+  }
+  std::size_t fileSize = fileStatus.st_size;
+  std::size_t size = std::min(fileSize, capacity);
+  std::size_t offset = 0;
+  if (overflowPolicy == OverflowPolicy::keepTail) {
+    offset = fileSize - size;
+  }
+  // The offset passed to mmap() must be a multiple of the page size.
+  std::size_t pageSize = ::sysconf(_SC_PAGESIZE);
+  std::size_t mappingOffset = offset - offset % pageSize;
+  // We release the memory used by the data that is discarded. For the head,
+  // we can simply truncate the file. For the tail, we punch a hole into the
+  // file. This is only an optimization, so we ignore errors.
+  if (offset + size < fileSize && ::ftruncate(this->fd, offset + size) == -1) {
+    // The data is still discarded, it simply continues to use memory.
+  }
+#ifdef FALLOC_FL_PUNCH_HOLE
+  if (mappingOffset > 0) {
+    ::fallocate(this->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, 0,
+        mappingOffset);
+  }
+#endif // FALLOC_FL_PUNCH_HOLE
+  // Now we seal the file completely, so that the data that we map cannot be
+  // modified any longer.
+  if (::fcntl(this->fd, F_ADD_SEALS,
+      F_SEAL_SHRINK | F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+    throw makeSystemError("fcntl(F_ADD_SEALS) failed");
+  }
+  // An empty range cannot be mapped, but we do not need a mapping in this
+  // case anyway.
+  if (size > 0) {
+    std::size_t mappingSize = size + (offset - mappingOffset);
+    void *address = ::mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED,
+        this->fd, mappingOffset);
+    if (address == MAP_FAILED) {
+      throw makeSystemError("mmap() failed");
+    }
+    this->mapping = static_cast<char const *>(address);
+    this->mappingSize = mappingSize;
+    this->data = this->mapping + (offset - mappingOffset);
+    this->size = size;
+  }
+  // The mapping keeps the file alive, so we do not need the file descriptor
+  // any longer.
+  ::close(this->fd);
+  this->fd = -1;
+  return fileSize - size;
+#else // EPICS_EXEC_USE_MEMFD
+  // The constructor throws on platforms without memory files, so this code
+  // is never reached.
+  (void) capacity;
+  (void) overflowPolicy;
+  throw std::logic_error("Memory files are not supported.");
+#endif // EPICS_EXEC_USE_MEMFD
+}
+
+} // namespace execute
+} // namespace epics
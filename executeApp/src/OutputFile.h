@@ -0,0 +1,133 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_OUTPUT_FILE_H
+#define EPICS_EXEC_OUTPUT_FILE_H
+
+#include <cstddef>
+
+#include "OverflowPolicy.h"
+
+namespace epics {
+namespace execute {
+
+/**
+ * Anonymous memory file that is used as the standard output or standard error
+ * output of a child process (see CaptureMode::file).
+ *
+ * The file descriptor returned by getFd() is passed to the child process.
+ * Once the child process has terminated, map() seals the file, so that it
+ * cannot be modified any longer, and maps the part of the data that is kept
+ * into memory. After that, the data can be accessed through getData() and
+ * getSize() without copying it.
+ *
+ * This class is only supported on Linux. On other platforms, the constructor
+ * throws.
+ *
+ * This class is not thread-safe, but once map() has been called, the object
+ * is not modified any longer, so it can safely be shared between threads
+ * (e.g. by storing it in a Command::Result).
+ */
+class OutputFile {
+
+public:
+
+  /**
+   * Creates an empty memory file.
+   *
+   * @throws std::system_error if the file cannot be created (e.g. because
+   *     memory files are not supported by the platform).
+   */
+  OutputFile();
+
+  /**
+   * Destroys this object, unmapping the data and closing the file.
+   */
+  ~OutputFile();
+
+  /**
+   * Returns the data that has been mapped into memory. Before map() has been
+   * called, this is a null pointer.
+   */
+  char const *getData() const {
+    return this->data;
+  }
+
+  /**
+   * Returns the file descriptor for the memory file. This file descriptor is
+   * passed to the child process. After map() has been called, it is -1.
+   */
+  int getFd() const {
+    return this->fd;
+  }
+
+  /**
+   * Returns the number of bytes that have been mapped into memory. Before
+   * map() has been called, this is zero.
+   */
+  std::size_t getSize() const {
+    return this->size;
+  }
+
+  /**
+   * Seals the file and maps up to capacity bytes into memory. The overflow
+   * policy decides whether the beginning or the end of the file is kept. The
+   * rest of the file is discarded, so it does not use memory any longer.
+   * OverflowPolicy::kill is treated like OverflowPolicy::keepHead because the
+   * output is not inspected while the child process is running (Command does
+   * not allow this combination, because the file is not bounded). The file
+   * descriptor is closed, so the file cannot be modified any longer, even if
+   * another process still has it open.
+   *
+   * Returns the number of bytes that have been discarded.
+   *
+   * @throws std::system_error if the file cannot be sealed or mapped.
+   */
+  std::size_t map(std::size_t capacity, OverflowPolicy overflowPolicy);
+
+private:
+
+  char const *data;
+  int fd;
+  char const *mapping;
+  std::size_t mappingSize;
+  std::size_t size;
+
+  // We do not want to allow copy or move construction and assignment.
+  OutputFile(OutputFile const &) = delete;
+  OutputFile(OutputFile &&) = delete;
+  OutputFile &operator=(OutputFile const &) = delete;
+  OutputFile &operator=(OutputFile &&) = delete;
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_OUTPUT_FILE_H
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_OVERFLOW_POLICY_H
+#define EPICS_EXEC_OVERFLOW_POLICY_H
+
+namespace epics {
+namespace execute {
+
+/**
+ * Policy that defines what happens when a program writes more data to its
+ * standard output or standard error output than can be kept.
+ */
+enum class OverflowPolicy {
+
+  /**
+   * Keep the data that was written first and discard the rest.
+   */
+  keepHead,
+
+  /**
+   * Keep the data that was written last. This is useful because programs
+   * often print error messages at the end of their output.
+   */
+  keepTail,
+
+  /**
+   * Keep the data that was written first and kill the program (with
+   * SIGKILL) as soon as it writes more data. A program that has been
+   * created by the fork server is only killed if it can be signaled through
+   * a pidfd, otherwise the data is discarded like with keepHead.
+   */
+  kill,
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_OVERFLOW_POLICY_H
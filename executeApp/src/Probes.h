@@ -0,0 +1,89 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_PROBES_H
+#define EPICS_EXEC_PROBES_H
+
+/*
+ * Static tracing probes (USDT) for tools like bpftrace, perf, or SystemTap.
+ *
+ * The probes are only compiled in if EPICS_EXEC_USE_SDT is defined, which the
+ * Makefile does when the sys/sdt.h header is available. Even then, a probe is
+ * a single nop instruction until a tracer attaches to it. Otherwise, the
+ * macros expand to statements that are removed by the compiler and their
+ * arguments are never evaluated, so the arguments must not have side
+ * effects.
+ *
+ * All probes belong to the provider "epics_execute", so they can be listed
+ * with "bpftrace -l 'usdt:<path to libexecute.so>:epics_execute:*'". The
+ * arguments of the probes are:
+ *
+ * spawn_begin(run ID, program path)
+ * spawn_end(run ID, PID)
+ * exec_failed(run ID, errno)
+ * reap(run ID, wait status)
+ * exit_status(run ID, exit code)
+ * output_read(FD, bytes)
+ * input_write(FD, bytes)
+ * task_submit(queue name, queued tasks)
+ * task_start(queue name, wait time in nanoseconds)
+ * task_finish()
+ * thread_create(threads)
+ * thread_exit(threads)
+ * record_process(record name, completion flag)
+ */
+
+#ifdef EPICS_EXEC_USE_SDT
+
+extern "C" {
+#include <sys/sdt.h>
+} // extern "C"
+
+#define EPICS_EXEC_PROBE(name) DTRACE_PROBE(epics_execute, name)
+#define EPICS_EXEC_PROBE1(name, arg1) \
+    DTRACE_PROBE1(epics_execute, name, arg1)
+#define EPICS_EXEC_PROBE2(name, arg1, arg2) \
+    DTRACE_PROBE2(epics_execute, name, arg1, arg2)
+
+#else // EPICS_EXEC_USE_SDT
+
+// The arguments are referenced in dead code, so that they are still checked
+// by the compiler and variables that are only used by probes do not cause
+// warnings.
+#define EPICS_EXEC_PROBE(name) do {} while (false)
+#define EPICS_EXEC_PROBE1(name, arg1) \
+    do { if (false) { static_cast<void>(arg1); } } while (false)
+#define EPICS_EXEC_PROBE2(name, arg1, arg2) \
+    do { \
+      if (false) { static_cast<void>(arg1); static_cast<void>(arg2); } \
+    } while (false)
+
+#endif // EPICS_EXEC_USE_SDT
+
+#endif // EPICS_EXEC_PROBES_H
@@ -1,6 +1,6 @@
 /*
- * Copyright 2018-2021 aquenos GmbH.
- * Copyright 2018-2021 Karlsruhe Institute of Technology.
+ * Copyright 2018-2026 aquenos GmbH.
+ * Copyright 2018-2026 Karlsruhe Institute of Technology.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as
@@ -53,11 +53,16 @@ public:
     int foundArgumentIndex = 0;
     std::string foundEnvVarName;
     BitMask<RecordAddress::Option> foundOptions;
+    std::string foundValueName;
     switch (foundType) {
     case RecordAddress::Type::argument:
       separator();
       foundArgumentIndex = argumentIndex();
       break;
+    case RecordAddress::Type::daemon:
+      separator();
+      foundValueName = valueName();
+      break;
     case RecordAddress::Type::envVar:
       separator();
       foundEnvVarName = envVarName();
@@ -83,6 +88,16 @@ public:
       }
       break;
     case RecordAddress::Type::standardOutput:
+      // The additional options are optional, but if they are present, they must
+      // be separated by a separator.
+      if (!isEndOfString()) {
+        separator();
+        foundOptions = options(foundType);
+      }
+      break;
+    case RecordAddress::Type::stats:
+      separator();
+      foundValueName = valueName();
       break;
     }
     if (!isEndOfString()) {
@@ -90,7 +105,7 @@ public:
           + excerpt() + "\".");
     }
     return RecordAddress(foundCommandId, foundType, foundArgumentIndex,
-        foundEnvVarName, foundOptions);
+        foundEnvVarName, foundOptions, foundValueName);
   }
 
 private:
@@ -100,6 +115,7 @@ private:
   static std::string const digits1To9Chars;
   static std::string const envVarNameChars;
   static std::string const separatorChars;
+  static std::string const valueNameChars;
 
   std::string addressString;
   BitMask<RecordAddress::Type> allowedTypes;
@@ -212,6 +228,11 @@ private:
         return RecordAddress::Option::nullTerminated;
       }
       break;
+    case RecordAddress::Type::standardOutput:
+      if (accept("lines")) {
+        return RecordAddress::Option::lines;
+      }
+      break;
     default:
       // The other types do not take any additional options.
       break;
@@ -248,6 +269,12 @@ private:
             "Type arg is not allowed for this record type.");
       }
       return RecordAddress::Type::argument;
+    } else if (accept("daemon")) {
+      if (!(allowedTypes & RecordAddress::Type::daemon)) {
+        throw std::invalid_argument(
+            "Type daemon is not allowed for this record type.");
+      }
+      return RecordAddress::Type::daemon;
     } else if (accept("env")) {
       if (!(allowedTypes & RecordAddress::Type::envVar)) {
         throw std::invalid_argument(
@@ -266,6 +293,12 @@ private:
             "Type run is not allowed for this record type.");
       }
       return RecordAddress::Type::run;
+    } else if (accept("stats")) {
+      if (!(allowedTypes & RecordAddress::Type::stats)) {
+        throw std::invalid_argument(
+            "Type stats is not allowed for this record type.");
+      }
+      return RecordAddress::Type::stats;
     } else if (accept("stderr")) {
       if (!(allowedTypes & RecordAddress::Type::standardError)) {
         throw std::invalid_argument(
@@ -294,6 +327,15 @@ private:
 
   }
 
+  std::string valueName() {
+    auto startPos = position;
+    expectAnyOf(valueNameChars);
+    do {
+    } while (acceptAnyOf(valueNameChars));
+    auto endPos = position;
+    return addressString.substr(startPos, endPos - startPos);
+  }
+
 };
 
 std::string const Parser::commandIdChars = std::string("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz_0123456789");
@@ -301,6 +343,7 @@ std::string const Parser::digits0To9Chars = std::string("0123456789");
 std::string const Parser::digits1To9Chars = std::string("123456789");
 std::string const Parser::envVarNameChars = std::string("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz_0123456789");
 std::string const Parser::separatorChars = std::string(" \t");
+std::string const Parser::valueNameChars = std::string("abcdefghijklmnopqrstuvwxyz_0123456789");
 
 } // anonymous namespace
 
@@ -60,9 +60,11 @@ public:
    * object from it.
    */
   inline RecordAddress(const std::string &commandId, Type type, int argumentIndex,
-      std::string const &envVarName, BitMask<Option> options)
+      std::string const &envVarName, BitMask<Option> options,
+      std::string const &valueName = std::string())
       : argumentIndex(argumentIndex), commandId(commandId),
-      envVarName(envVarName), options(options), type(type) {
+      envVarName(envVarName), options(options), type(type),
+      valueName(valueName) {
   }
 
   /**
@@ -119,6 +121,22 @@ public:
     return type;
   }
 
+  /**
+   * Returns the name of the value that is read by the record. The name is not
+   * validated by the parser, so the device support has to check that it
+   * refers to a known value.
+   *
+   * @throws std::invalid_argument if the type of this address is
+   *     neither Type::daemon nor Type::stats.
+   */
+  inline std::string const &getValueName() const {
+    if (type != Type::daemon && type != Type::stats) {
+      throw std::invalid_argument(
+        "The getValueName method must only be called if the type is daemon or stats.");
+    }
+    return valueName;
+  }
+
   /**
    * Parses the contents of a record's link field and returns the corresponding
    * address object.
@@ -136,6 +154,7 @@ private:
   std::string envVarName;
   BitMask<Option> options;
   Type type;
+  std::string valueName;
 
 };
 
@@ -1,6 +1,6 @@
 /*
- * Copyright 2018-2021 aquenos GmbH.
- * Copyright 2018-2021 Karlsruhe Institute of Technology.
+ * Copyright 2018-2026 aquenos GmbH.
+ * Copyright 2018-2026 Karlsruhe Institute of Technology.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as
@@ -61,6 +61,15 @@ enum class RecordAddressOption {
    */
   nullTerminated = 2,
 
+  /**
+   * Read the command's standard output line by line while the command is
+   * running instead of reading the complete output when it has terminated.
+   * This option may only be used in combination with the standard output
+   * type. Records using this option are processed through I/O Intr scanning
+   * each time new lines are available.
+   */
+  lines = 4,
+
 };
 
 /**
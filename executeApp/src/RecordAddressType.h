@@ -76,6 +76,17 @@ enum class RecordAddressType {
    */
   standardOutput = 64,
 
+  /**
+   * Record retrieves a value from the status of the supervisor that keeps the
+   * command's program running (see Supervisor).
+   */
+  daemon = 128,
+
+  /**
+   * Record retrieves a value from the statistics about the command's runs.
+   */
+  stats = 256,
+
 };
 
 /**
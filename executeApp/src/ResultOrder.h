@@ -0,0 +1,63 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_RESULT_ORDER_H
+#define EPICS_EXEC_RESULT_ORDER_H
+
+namespace epics {
+namespace execute {
+
+/**
+ * Order in which the results of concurrent runs of a command are published.
+ * This only makes a difference if a command is allowed to run more than once
+ * at the same time.
+ */
+enum class ResultOrder {
+
+  /**
+   * Publish the result of each run as soon as the run completes. The exit
+   * code and output seen by the records always belong to the run that
+   * completed last.
+   */
+  completion,
+
+  /**
+   * Publish the results in the order in which the runs were started. If a
+   * run completes before a run that was started earlier, its result is held
+   * back until the earlier run has completed. This ensures that the result
+   * of an older run never replaces the result of a newer run.
+   */
+  submission,
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_RESULT_ORDER_H
@@ -1,6 +1,6 @@
 /*
- * Copyright 2018-2023 aquenos GmbH.
- * Copyright 2018-2023 Karlsruhe Institute of Technology.
+ * Copyright 2018-2026 aquenos GmbH.
+ * Copyright 2018-2026 Karlsruhe Institute of Technology.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as
@@ -30,19 +30,27 @@
 #ifndef EPICS_EXEC_RUN_DEVICE_SUPPORT_H
 #define EPICS_EXEC_RUN_DEVICE_SUPPORT_H
 
-#include <atomic>
 #include <chrono>
-#include <future>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
-#include <thread>
 
 extern "C" {
 #include <alarm.h>
 #include <callback.h>
+#include <dbAccess.h>
+#include <dbCommon.h>
 #include <recGbl.h>
+#include <recSup.h>
 } // extern "C"
 
 #include "BaseDeviceSupport.h"
+#include "Probes.h"
+#include "RunStatistics.h"
+#include "RunTrace.h"
 #include "ThreadPoolExecutor.h"
 
 namespace epics {
@@ -59,6 +67,17 @@ namespace execute {
  *
  * If the command's wait flag is not set, the record is processed synchronously
  * and finishes after the process has been forked.
+ *
+ * If the command's wait flag is set, but the wait option is not set on the
+ * record, the record can trigger another run while previous runs are still
+ * active, as long as the command's limit for concurrent runs has not been
+ * reached. In this case, the record is processed again each time a run
+ * completes, and its value stays at 1 until all runs have completed.
+ *
+ * When the record is processed for a completed run, the result of that run is
+ * pinned on the command (see Command::ResultPin) until the processing has
+ * finished. This way, records that are processed through the forward link
+ * see the result of that run, even if other runs complete in the meantime.
  */
 template <typename RecordType>
 class RunDeviceSupport : public BaseDeviceSupport<RecordType> {
@@ -77,7 +96,7 @@ public:
    */
   RunDeviceSupport(RecordType *record, RecordAddress const &address)
       : BaseDeviceSupport<RecordType>(record, address),
-      runComplete(false),
+      processingCompletion(false), processedRun(nullptr), runsActive(0),
       suspendProcessingUntilCommandTerminated(address.getOptions()
           & RecordAddressOption::wait) {
     if (this->suspendProcessingUntilCommandTerminated
@@ -85,6 +104,9 @@ public:
       throw std::invalid_argument(
           "The wait option cannot be specified if the command's wait flag is not set.");
     }
+    callbackSetCallback(completionCallback, &this->completionProcessCallback);
+    callbackSetPriority(priorityMedium, &this->completionProcessCallback);
+    callbackSetUser(this, &this->completionProcessCallback);
     record->udf = 0;
     recGblResetAlarms(record);
   }
@@ -93,10 +115,10 @@ public:
    * Triggers a run of the command.
    *
    * This method always returns quickly (without blocking). If the command's
-   * wait flag is set, the record's PACT field is set to 1 and the record is
-   * scheduled to be processed again when the command's execution has finished.
-   * If the wait flag is not set, PACT is not set and record processing
-   * completes immediately.
+   * wait flag is set, the record is scheduled to be processed again when the
+   * command's execution has finished. If the record's wait option is set, the
+   * record's PACT field is set to 1 until then. If the command's wait flag is
+   * not set, PACT is not set and record processing completes immediately.
    *
    * If the wait flag is set, this method throws an exception if the process
    * cannot be forked or if the child process is killed by a signal. If the wait
@@ -105,83 +127,98 @@ public:
    */
   void processRecord() {
     RecordType *record = this->getRecord();
-    // If this method is called again because a command terminated, we simply
-    // want to complete the processing.
-    if (asyncExecutionFuture.valid()) {
-      // We check the run-complete flag instead of checking whether the result
-      // for the future is available. We have to do this because this method
-      // might be called from the callback that is scheduled by the code that
-      // provides the result of the future, and if this callback is executed
-      // more quickly than the scheduling thread can finish, it can happen that
-      // the future's result is not available yet when we arrive here. If we
-      // simply checked for the result being available, we would return, but
-      // this method would not be called again because the scheduled callback
-      // would already have been executed.
-      // We can use a relaxed memory order, because calling the future's get
-      // method will provide sufficient synchronization. Here, we are only
-      // interested in the state of the flag.
-      if (!runComplete.load(std::memory_order_relaxed)) {
-        // If the run is not complete yet, this means that the record has been
-        // processed again before the command finished. This can only happen if
-        // we did not set PACT to 1 (setting PACT ensures that record processing
-        // can only be triggered by us). We simple restore the value that
-        // indicates that the command is running and return.
-        record->val = 1;
-        record->rval = 1;
+    EPICS_EXEC_PROBE2(record_process, &record->name[0],
+        record->pact || processingCompletion);
+    // If this method is called again because a run completed, we simply want
+    // to complete the processing. If the wait option is set, PACT is set
+    // while a run is active, so the record can only be processed by the
+    // callback. Otherwise, the callback sets a flag, so that we can tell
+    // this processing apart from a regular one.
+    if (record->pact || processingCompletion) {
+      // The callback processes the record once for each completed run and
+      // passes that run to us. The run is null if the record is processed
+      // while the callback is processing it for a completed run (e.g.
+      // through a loop of links), in which case there is nothing to do.
+      if (!processedRun) {
         return;
       }
+      RunTrace::getInstance().record(this->getCommand()->getTraceSource(),
+          processedRun->runId, RunTrace::Event::callback);
+      --runsActive;
       record->pact = 0;
-      record->val = 0;
-      record->rval = 0;
-      // The get method throws an exception if the command's run method threw an
-      // exception.
-      try {
-        // Due to scheduling, the call to get() might block for a short moment
-        // if this method has been called from the callback. This can happen if
-        // the scheduling of the callback happens faster than the the thread
-        // that scheduled it can quit. This is okay, because nothing blocking
-        // happens in that thread after scheduling the callback, so we can
-        // simply wait for this short amount of time (this isn't worse than
-        // acquiring a rarely contested mutex).
-        asyncExecutionFuture.get();
-      } catch (...) {
+      record->val = runsActive ? 1 : 0;
+      record->rval = runsActive ? 1 : 0;
+      auto error = processedRun->error;
+      processedRun = nullptr;
+      if (error) {
         ::recGblSetSevr(record, WRITE_ALARM, MAJOR_ALARM);
-        throw;
+        std::rethrow_exception(error);
       }
       return;
     }
     auto command = this->getCommand();
     if (command->isWait()) {
-      // We have to clear the run-complete flag, so that it will only be set
-      // once the run has actually completed. The flag is only checked from
-      // within this method, and calls of this method are synchronized through
-      // other means, so we can use a relaxed memory order.
-      runComplete.store(false, std::memory_order_relaxed);
-      asyncExecutionFuture = sharedThreadPoolExecutor().submit([this]() {
-        try {
-          this->getCommand()->run();
-        } catch (...) {
-          // We have to schedule another processing of the record, even if the
-          // run method threw an exception. Before scheduling the callback, we
-          // set the run-complete flag. This ensures that we will wait for the
-          // result of the run operation to become available within the
-          // callback. We use exchange instead of store, so that the call to
-          // callbackRequestProcessCallback cannot be reordered before the
-          // action of setting the flag.
-        this->runComplete.exchange(true, std::memory_order_acq_rel);
-          ::callbackRequestProcessCallback(&this->processCallback,
-              priorityMedium, this->getRecord());
-          throw;
+      if (runsActive >= command->getMaxConcurrentRuns()) {
+        // If the record is processed again before enough runs have finished,
+        // we simply restore the value that indicates that the command is
+        // running and return.
+        record->val = 1;
+        record->rval = 1;
+        return;
+      }
+      ++runsActive;
+      // Creating the child process might take some time, so we do not do it
+      // in the thread processing the record. However, the thread from the
+      // pool is only used until the child process has been created. The
+      // completion of the run is signaled through the completion handler,
+      // so no thread is blocked while the command is running.
+      // The run ID is created here, so that the trace covers the time that
+      // the run spends in the queue and the time until the record has been
+      // processed for the completion of the run.
+      auto &trace = RunTrace::getInstance();
+      auto traceSource = command->getTraceSource();
+      auto runId = trace.createRunId();
+      auto completionHandler = [this, traceSource, runId](
+          std::exception_ptr error,
+          std::shared_ptr<Command::Result const> result) {
+        RunTrace::getInstance().record(traceSource, runId,
+            RunTrace::Event::complete);
+        {
+          std::lock_guard<std::mutex> lock(this->completedRunsMutex);
+          this->completedRuns.push_back(
+              CompletedRun{error, std::move(result), runId});
         }
-        // Before scheduling the callback, we set the run-complete flag. This
-        // ensures that we will wait for the result of the run operation to
-        // become available within the callback. We use exchange instead of
-        // store, so that the call to callbackRequestProcessCallback cannot be
-        // reordered before the action of setting the flag.
-        this->runComplete.exchange(true, std::memory_order_acq_rel);
-        ::callbackRequestProcessCallback(&this->processCallback, priorityMedium,
-            this->getRecord());
-      });
+        // We have to schedule another processing of the record, even if the
+        // run failed.
+        ::callbackRequest(&this->completionProcessCallback);
+      };
+      // The time that the task spends in the queue is recorded in the
+      // command's statistics.
+      auto submitTime = std::chrono::steady_clock::now();
+      trace.record(traceSource, runId, RunTrace::Event::submit, submitTime);
+      try {
+        sharedThreadPoolExecutor().submit(command->getExecutorQueue(),
+            [this, completionHandler, runId, submitTime, traceSource]() {
+          auto dequeueTime = std::chrono::steady_clock::now();
+          RunTrace::getInstance().record(traceSource, runId,
+              RunTrace::Event::dequeue, dequeueTime);
+          this->getCommand()->getStatistics().addDuration(
+              RunStatistics::Phase::queueWait, dequeueTime - submitTime);
+          try {
+            this->getCommand()->runAsync(completionHandler, runId);
+          } catch (...) {
+            // If runAsync throws, the completion handler is not called, so
+            // we have to call it ourselves.
+            completionHandler(std::current_exception(),
+                std::shared_ptr<Command::Result const>());
+          }
+        });
+      } catch (...) {
+        // The thread pool rejected the task, so the run is never started.
+        --runsActive;
+        ::recGblSetSevr(record, WRITE_ALARM, MAJOR_ALARM);
+        throw;
+      }
       if (suspendProcessingUntilCommandTerminated) {
         record->pact = 1;
       }
@@ -201,11 +238,72 @@ public:
 
 private:
 
-  std::future<void> asyncExecutionFuture;
-  ::CALLBACK processCallback;
-  std::atomic<bool> runComplete;
+  /**
+   * Result of a run that has completed, but has not been taken into account
+   * by processRecord() yet.
+   */
+  struct CompletedRun {
+    std::exception_ptr error;
+    std::shared_ptr<Command::Result const> result;
+    std::uint64_t runId;
+  };
+
+  std::deque<CompletedRun> completedRuns;
+  std::mutex completedRunsMutex;
+  ::CALLBACK completionProcessCallback;
+  bool processingCompletion;
+  CompletedRun *processedRun;
+  int runsActive;
   bool suspendProcessingUntilCommandTerminated;
 
+  /**
+   * Processes the record once for each run that has completed. The callback
+   * is requested once per run, but it processes all runs that have completed
+   * so far, so a request that finds no completed run does nothing.
+   *
+   * While the record is processed, the result of the run is pinned on the
+   * command, so that the records processed through the forward link see the
+   * result of this run and not the result of a run that completed later.
+   *
+   * We cannot use callbackRequestProcessCallback, because processRecord()
+   * could not tell this processing apart from a regular one if the wait
+   * option is not set, and because the result has to stay pinned until the
+   * forward link has been processed.
+   */
+  static void completionCallback(::CALLBACK *callback) {
+    auto deviceSupport =
+        static_cast<RunDeviceSupport *>(callback->user);
+    auto record = reinterpret_cast<::dbCommon *>(deviceSupport->getRecord());
+    auto command = deviceSupport->getCommand();
+    ::dbScanLock(record);
+    while (true) {
+      CompletedRun completedRun;
+      {
+        std::lock_guard<std::mutex> lock(deviceSupport->completedRunsMutex);
+        if (deviceSupport->completedRuns.empty()) {
+          break;
+        }
+        completedRun = std::move(deviceSupport->completedRuns.front());
+        deviceSupport->completedRuns.pop_front();
+      }
+      Command::ResultPin resultPin(*command, completedRun.result);
+      deviceSupport->processedRun = &completedRun;
+      deviceSupport->processingCompletion = true;
+      if (record->pact) {
+        // If the wait option is set, PACT is set while the run is active, so
+        // dbProcess would refuse to process the record. Like
+        // callbackRequestProcessCallback, we call the record support
+        // directly in this case.
+        (*record->rset->process)(record);
+      } else {
+        ::dbProcess(record);
+      }
+      deviceSupport->processingCompletion = false;
+      deviceSupport->processedRun = nullptr;
+    }
+    ::dbScanUnlock(record);
+  }
+
 };
 
 } // namespace execute
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "RunStatistics.h"
+
+namespace epics {
+namespace execute {
+
+constexpr std::size_t RunStatistics::windowSize;
+constexpr std::size_t RunStatistics::numberOfPhases;
+
+RunStatistics::RunStatistics() : bytesCaptured(0), failures(0), runs(0) {
+  for (auto &window : this->windows) {
+    window.count.store(0, std::memory_order_relaxed);
+    window.last.store(0, std::memory_order_relaxed);
+    for (auto &sample : window.samples) {
+      sample.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+void RunStatistics::addDuration(Phase phase,
+    std::chrono::nanoseconds duration) noexcept {
+  auto &window = this->windows[static_cast<std::size_t>(phase)];
+  auto value = duration.count();
+  // Claiming the slot and storing the sample are two separate steps, so a
+  // reader might briefly see the old value of the slot. This is the price
+  // for not needing a lock.
+  auto index = window.count.fetch_add(1, std::memory_order_relaxed);
+  window.samples[index % windowSize].store(value, std::memory_order_relaxed);
+  window.last.store(value, std::memory_order_relaxed);
+}
+
+void RunStatistics::addRun(bool failed, std::size_t bytesCaptured) noexcept {
+  this->runs.fetch_add(1, std::memory_order_relaxed);
+  if (failed) {
+    this->failures.fetch_add(1, std::memory_order_relaxed);
+  }
+  this->bytesCaptured.fetch_add(bytesCaptured, std::memory_order_relaxed);
+}
+
+std::vector<std::chrono::nanoseconds> RunStatistics::getDurations(
+    Phase phase) const {
+  auto &window = this->windows[static_cast<std::size_t>(phase)];
+  auto count = window.count.load(std::memory_order_relaxed);
+  auto size = static_cast<std::size_t>(
+      std::min<std::uint64_t>(count, windowSize));
+  std::vector<std::chrono::nanoseconds> durations;
+  durations.reserve(size);
+  // Once the window is full, the oldest sample is in the slot that is going
+  // to be overwritten next.
+  for (std::uint64_t i = count - size; i < count; ++i) {
+    durations.emplace_back(window.samples[i % windowSize].load(
+        std::memory_order_relaxed));
+  }
+  return durations;
+}
+
+RunStatistics::Summary RunStatistics::getSummary(Phase phase) const {
+  auto durations = getDurations(phase);
+  Summary summary;
+  summary.samples = durations.size();
+  if (durations.empty()) {
+    summary.last = summary.mean = summary.p99 = std::chrono::nanoseconds(0);
+    return summary;
+  }
+  summary.last = std::chrono::nanoseconds(
+      this->windows[static_cast<std::size_t>(phase)].last.load(
+          std::memory_order_relaxed));
+  std::int64_t total = 0;
+  for (auto const &duration : durations) {
+    total += duration.count();
+  }
+  summary.mean = std::chrono::nanoseconds(
+      total / static_cast<std::int64_t>(durations.size()));
+  // We use the nearest-rank method, so the percentile is always one of the
+  // recorded durations.
+  auto rank = static_cast<std::size_t>(
+      std::ceil(0.99 * durations.size())) - 1;
+  std::nth_element(durations.begin(), durations.begin() + rank,
+      durations.end());
+  summary.p99 = durations[rank];
+  return summary;
+}
+
+} // namespace execute
+} // namespace epics
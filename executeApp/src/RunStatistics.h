@@ -0,0 +1,204 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_RUN_STATISTICS_H
+#define EPICS_EXEC_RUN_STATISTICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace epics {
+namespace execute {
+
+/**
+ * Statistics about the runs of a command.
+ *
+ * The statistics are updated by the threads running the command, so all
+ * updates are lock-free: counters are atomic and the durations of the most
+ * recent runs are kept in fixed-size windows that are written through an
+ * atomic index. Reading the statistics never blocks an update. As a
+ * consequence, a reader that races with an update might see a window that
+ * does not include the newest sample yet, which is acceptable for statistics.
+ *
+ * This class is thread-safe.
+ */
+class RunStatistics {
+
+public:
+
+  /**
+   * Phase of a run for which the duration is recorded.
+   */
+  enum class Phase {
+
+    /**
+     * Time that the task starting the run spent in the thread pool's queue.
+     */
+    queueWait = 0,
+
+    /**
+     * Time needed for creating the child process until the program has been
+     * executed (or execution has failed).
+     */
+    spawn = 1,
+
+    /**
+     * Time from starting to create the child process until the first byte of
+     * output has been read. Only recorded for runs that write output which is
+     * read through a pipe.
+     */
+    firstOutput = 2,
+
+    /**
+     * Time from starting to create the child process until the run has
+     * completed.
+     */
+    wall = 3,
+
+  };
+
+  /**
+   * Summary of the durations that have been recorded for a phase.
+   */
+  struct Summary {
+
+    /**
+     * Most recent duration.
+     */
+    std::chrono::nanoseconds last;
+
+    /**
+     * Mean of the durations in the window.
+     */
+    std::chrono::nanoseconds mean;
+
+    /**
+     * 99th percentile of the durations in the window.
+     */
+    std::chrono::nanoseconds p99;
+
+    /**
+     * Number of durations in the window. If zero, the other fields are zero,
+     * too.
+     */
+    std::size_t samples;
+
+  };
+
+  /**
+   * Number of durations that are kept for each phase.
+   */
+  static constexpr std::size_t windowSize = 256;
+
+  /**
+   * Creates statistics without any runs.
+   */
+  RunStatistics();
+
+  /**
+   * Records the duration of a phase of a run.
+   */
+  void addDuration(Phase phase, std::chrono::nanoseconds duration) noexcept;
+
+  /**
+   * Records a run that has completed. A run is counted as a failure if it did
+   * not complete successfully or the program's exit code is not zero.
+   * bytesCaptured is the number of bytes that have been kept from the
+   * program's standard output and standard error output.
+   */
+  void addRun(bool failed, std::size_t bytesCaptured) noexcept;
+
+  /**
+   * Returns the total number of bytes captured from the program's output.
+   */
+  std::uint64_t getBytesCaptured() const noexcept {
+    return this->bytesCaptured.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns the durations in the window of a phase, starting with the oldest
+   * one.
+   */
+  std::vector<std::chrono::nanoseconds> getDurations(Phase phase) const;
+
+  /**
+   * Returns the number of runs that failed.
+   */
+  std::uint64_t getFailures() const noexcept {
+    return this->failures.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns the number of runs that have completed.
+   */
+  std::uint64_t getRuns() const noexcept {
+    return this->runs.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns the summary of the durations of a phase.
+   */
+  Summary getSummary(Phase phase) const;
+
+private:
+
+  /**
+   * Most recent durations of a phase. Slots are claimed by incrementing
+   * count, so concurrent writers never use the same slot (unless more than
+   * windowSize writers race, in which case one sample is lost).
+   */
+  struct Window {
+    std::atomic<std::uint64_t> count;
+    std::atomic<std::int64_t> last;
+    std::array<std::atomic<std::int64_t>, windowSize> samples;
+  };
+
+  static constexpr std::size_t numberOfPhases = 4;
+
+  std::atomic<std::uint64_t> bytesCaptured;
+  std::atomic<std::uint64_t> failures;
+  std::atomic<std::uint64_t> runs;
+  std::array<Window, numberOfPhases> windows;
+
+  // We do not want to allow copy or move construction and assignment.
+  RunStatistics(RunStatistics const &) = delete;
+  RunStatistics(RunStatistics &&) = delete;
+  RunStatistics &operator=(RunStatistics const &) = delete;
+  RunStatistics &operator=(RunStatistics &&) = delete;
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_RUN_STATISTICS_H
@@ -0,0 +1,294 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <system_error>
+#include <tuple>
+
+#include "RunTrace.h"
+
+namespace epics {
+namespace execute {
+
+namespace {
+
+/**
+ * Number of different events.
+ */
+constexpr std::size_t numberOfEvents = 9;
+
+/**
+ * Names of the events, indexed by their numeric value.
+ */
+char const *const eventNames[numberOfEvents] = {"submit", "dequeue", "fork",
+    "exec", "first_byte", "eof", "reap", "complete", "callback"};
+
+/**
+ * Event that has been copied from the ring.
+ */
+struct Sample {
+  std::uint32_t source;
+  std::uint64_t runId;
+  std::int64_t time;
+  std::uint32_t event;
+};
+
+/**
+ * Writes a string as a JSON string literal.
+ */
+void writeJsonString(std::FILE *file, std::string const &str) {
+  std::fputc('"', file);
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      std::fputc('\\', file);
+      std::fputc(c, file);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      std::fprintf(file, "\\u%04x", static_cast<unsigned>(c));
+    } else {
+      std::fputc(c, file);
+    }
+  }
+  std::fputc('"', file);
+}
+
+/**
+ * Writes a time (in nanoseconds) in microseconds, which is the unit used by
+ * the Chrome trace event format.
+ */
+void writeMicroseconds(std::FILE *file, std::int64_t nanoseconds) {
+  if (nanoseconds < 0) {
+    nanoseconds = 0;
+  }
+  std::fprintf(file, "%lld.%03lld",
+      static_cast<long long>(nanoseconds / 1000),
+      static_cast<long long>(nanoseconds % 1000));
+}
+
+/**
+ * Writes the events of a single run. The samples must be sorted by time.
+ */
+void writeRun(std::FILE *file, std::vector<Sample>::const_iterator begin,
+    std::vector<Sample>::const_iterator end, bool &first) {
+  auto source = begin->source;
+  auto runId = begin->runId;
+  // For each event, we use the time when it was recorded first, except for
+  // the end of the output, which is recorded once for each stream.
+  std::int64_t times[numberOfEvents];
+  std::fill(times, times + numberOfEvents, -1);
+  for (auto sample = begin; sample != end; ++sample) {
+    if (times[sample->event] == -1
+        || sample->event == static_cast<std::uint32_t>(RunTrace::Event::eof)) {
+      times[sample->event] = sample->time;
+    }
+  }
+  auto timeOf = [&times](RunTrace::Event event) {
+    return times[static_cast<std::size_t>(event)];
+  };
+  auto separator = [file, &first]() {
+    std::fputs(first ? "\n" : ",\n", file);
+    first = false;
+  };
+  separator();
+  std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lu,"
+      "\"tid\":%llu,\"args\":{\"name\":\"run %llu\"}}",
+      static_cast<unsigned long>(source),
+      static_cast<unsigned long long>(runId),
+      static_cast<unsigned long long>(runId));
+  // The phases of a run follow each other, so the spans do not overlap. If
+  // the output is still being read after the child process has terminated,
+  // this time is shown as a phase of its own.
+  auto drainEnd = std::max(timeOf(RunTrace::Event::reap),
+      timeOf(RunTrace::Event::eof));
+  struct Span {
+    char const *name;
+    std::int64_t start;
+    std::int64_t end;
+  };
+  Span spans[] = {
+    {"queue", timeOf(RunTrace::Event::submit),
+        timeOf(RunTrace::Event::dequeue)},
+    {"spawn", timeOf(RunTrace::Event::fork), timeOf(RunTrace::Event::exec)},
+    {"child", timeOf(RunTrace::Event::exec), timeOf(RunTrace::Event::reap)},
+    {"drain", timeOf(RunTrace::Event::reap), timeOf(RunTrace::Event::eof)},
+    {"completion", timeOf(RunTrace::Event::reap) == -1 ? -1 : drainEnd,
+        timeOf(RunTrace::Event::complete)},
+    {"callback", timeOf(RunTrace::Event::complete),
+        timeOf(RunTrace::Event::callback)},
+  };
+  for (auto &span : spans) {
+    if (span.start == -1 || span.end == -1 || span.end <= span.start) {
+      continue;
+    }
+    separator();
+    std::fprintf(file, "{\"name\":\"%s\",\"cat\":\"run\",\"ph\":\"X\","
+        "\"pid\":%lu,\"tid\":%llu,\"ts\":", span.name,
+        static_cast<unsigned long>(source),
+        static_cast<unsigned long long>(runId));
+    writeMicroseconds(file, span.start);
+    std::fputs(",\"dur\":", file);
+    writeMicroseconds(file, span.end - span.start);
+    std::fputc('}', file);
+  }
+  for (auto sample = begin; sample != end; ++sample) {
+    separator();
+    std::fprintf(file, "{\"name\":\"%s\",\"cat\":\"event\",\"ph\":\"i\","
+        "\"s\":\"t\",\"pid\":%lu,\"tid\":%llu,\"ts\":",
+        eventNames[sample->event], static_cast<unsigned long>(source),
+        static_cast<unsigned long long>(runId));
+    writeMicroseconds(file, sample->time);
+    std::fputc('}', file);
+  }
+}
+
+} // anonymous namespace
+
+constexpr std::size_t RunTrace::capacity;
+
+RunTrace RunTrace::instance;
+
+RunTrace::RunTrace() : epoch(std::chrono::steady_clock::now()), nextIndex(0),
+    nextRunId(1) {
+  for (auto &slot : this->slots) {
+    slot.sequence.store(0, std::memory_order_relaxed);
+    slot.runId.store(0, std::memory_order_relaxed);
+    slot.time.store(0, std::memory_order_relaxed);
+    slot.source.store(0, std::memory_order_relaxed);
+    slot.event.store(0, std::memory_order_relaxed);
+  }
+}
+
+void RunTrace::record(std::uint32_t source, std::uint64_t runId, Event event,
+    std::chrono::steady_clock::time_point time) noexcept {
+  auto index = this->nextIndex.fetch_add(1, std::memory_order_relaxed);
+  auto &slot = this->slots[index % capacity];
+  // The slot is marked as being written before changing the fields, and the
+  // release fence ensures that a reader that sees one of the new fields also
+  // sees this mark. If a writer is so slow that another writer wraps around
+  // and claims the same slot in the meantime, the event might be mixed up
+  // with the later one, but this would need capacity events to be recorded
+  // while writing a single one.
+  slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.runId.store(runId, std::memory_order_relaxed);
+  slot.time.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      time - this->epoch).count(), std::memory_order_relaxed);
+  slot.source.store(source, std::memory_order_relaxed);
+  slot.event.store(static_cast<std::uint32_t>(event),
+      std::memory_order_relaxed);
+  slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+std::uint32_t RunTrace::registerSource(std::string const &name) {
+  std::lock_guard<std::mutex> lock(this->sourcesMutex);
+  this->sourceNames.push_back(name);
+  return static_cast<std::uint32_t>(this->sourceNames.size() - 1);
+}
+
+void RunTrace::writeChromeTrace(std::string const &path) const {
+  // We copy the events before writing the file, so that we only read each
+  // slot once and can sort the events by run.
+  std::vector<Sample> samples;
+  samples.reserve(capacity);
+  for (auto &slot : this->slots) {
+    auto sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence == 0 || (sequence & 1)) {
+      continue;
+    }
+    Sample sample;
+    sample.runId = slot.runId.load(std::memory_order_relaxed);
+    sample.time = slot.time.load(std::memory_order_relaxed);
+    sample.source = slot.source.load(std::memory_order_relaxed);
+    sample.event = slot.event.load(std::memory_order_relaxed);
+    // If the sequence number changed while we were reading the fields, the
+    // slot has been overwritten, and the fields might belong to different
+    // events.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence
+        || sample.event >= numberOfEvents) {
+      continue;
+    }
+    samples.push_back(sample);
+  }
+  std::sort(samples.begin(), samples.end(),
+      [](Sample const &left, Sample const &right) {
+    return std::tie(left.source, left.runId, left.time, left.event)
+        < std::tie(right.source, right.runId, right.time, right.event);
+  });
+  std::vector<std::string> sourceNames;
+  {
+    std::lock_guard<std::mutex> lock(this->sourcesMutex);
+    sourceNames = this->sourceNames;
+  }
+  std::FILE *file = std::fopen(path.c_str(), "w");
+  if (!file) {
+    throw std::system_error(std::error_code(errno, std::system_category()),
+        "Could not open " + path);
+  }
+  bool first = true;
+  std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+  auto runBegin = samples.cbegin();
+  while (runBegin != samples.cend()) {
+    // The first run of a source is preceded by the name of the source.
+    if (runBegin == samples.cbegin()
+        || (runBegin - 1)->source != runBegin->source) {
+      std::fputs(first ? "\n" : ",\n", file);
+      first = false;
+      std::fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\","
+          "\"pid\":%lu,\"args\":{\"name\":",
+          static_cast<unsigned long>(runBegin->source));
+      writeJsonString(file, runBegin->source < sourceNames.size()
+          ? sourceNames[runBegin->source] : std::string());
+      std::fputs("}}", file);
+    }
+    auto runEnd = runBegin;
+    while (runEnd != samples.cend() && runEnd->source == runBegin->source
+        && runEnd->runId == runBegin->runId) {
+      ++runEnd;
+    }
+    writeRun(file, runBegin, runEnd, first);
+    runBegin = runEnd;
+  }
+  std::fputs("\n]}\n", file);
+  bool writeFailed = std::ferror(file);
+  int writeErrorNumber = errno;
+  if (std::fclose(file) != 0 && !writeFailed) {
+    writeFailed = true;
+    writeErrorNumber = errno;
+  }
+  if (writeFailed) {
+    throw std::system_error(
+        std::error_code(writeErrorNumber, std::system_category()),
+        "Could not write " + path);
+  }
+}
+
+} // namespace execute
+} // namespace epics
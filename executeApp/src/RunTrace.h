@@ -0,0 +1,206 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_RUN_TRACE_H
+#define EPICS_EXEC_RUN_TRACE_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace epics {
+namespace execute {
+
+/**
+ * Trace of the steps of recent runs.
+ *
+ * Each run is identified by a run ID, and each step of the run (e.g. being
+ * submitted to the thread pool, forking the child process, or reading the end
+ * of its output) is recorded as an event with a timestamp. The events are
+ * stored in a fixed-size ring, so only the most recent events are kept.
+ *
+ * Recording an event is lock-free: the writer claims a slot by incrementing
+ * an atomic index and marks the slot through a sequence number while writing
+ * it. A reader skips slots that are being written while it reads them, so
+ * the trace might miss a few events that are recorded during a dump, but it
+ * never contains torn events.
+ *
+ * The trace can be written to a file in the Chrome trace event format, so
+ * that it can be analyzed with tools like chrome://tracing or Perfetto.
+ *
+ * This class is thread-safe.
+ */
+class RunTrace {
+
+public:
+
+  /**
+   * Step of a run that is recorded in the trace.
+   */
+  enum class Event : std::uint32_t {
+
+    /**
+     * The task starting the run has been submitted to the thread pool.
+     */
+    submit = 0,
+
+    /**
+     * The task starting the run has been taken from the thread pool's queue.
+     */
+    dequeue = 1,
+
+    /**
+     * Creation of the child process is about to start.
+     */
+    fork = 2,
+
+    /**
+     * The child process has executed the program.
+     */
+    exec = 3,
+
+    /**
+     * The first byte of output has been read from the child process.
+     */
+    firstByte = 4,
+
+    /**
+     * The end of the standard output or standard error output has been read.
+     */
+    eof = 5,
+
+    /**
+     * The child process has been reaped.
+     */
+    reap = 6,
+
+    /**
+     * The run has completed and its completion handler has been called.
+     */
+    complete = 7,
+
+    /**
+     * The record that started the run has been processed for the completion
+     * of the run.
+     */
+    callback = 8,
+
+  };
+
+  /**
+   * Number of events that are kept in the ring.
+   */
+  static constexpr std::size_t capacity = 32768;
+
+  /**
+   * Returns the only instance of this class.
+   */
+  inline static RunTrace &getInstance() {
+    return instance;
+  }
+
+  /**
+   * Creates a new run ID. Run IDs are never zero, so zero can be used for
+   * indicating that no run ID has been assigned yet.
+   */
+  std::uint64_t createRunId() noexcept {
+    return this->nextRunId.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Records an event of a run. The source identifies the command and must
+   * have been returned by registerSource(...).
+   */
+  void record(std::uint32_t source, std::uint64_t runId, Event event,
+      std::chrono::steady_clock::time_point time
+        = std::chrono::steady_clock::now()) noexcept;
+
+  /**
+   * Registers a source of runs (typically a command) and returns the ID that
+   * has to be passed when recording events. The name is used for labeling the
+   * runs of this source in the trace. Sources are never unregistered, so this
+   * method should not be called on a hot path.
+   */
+  std::uint32_t registerSource(std::string const &name);
+
+  /**
+   * Writes the events in the ring to a file in the Chrome trace event format.
+   * Each source is represented as a process and each run as a thread of that
+   * process, with one span for each phase of the run whose start and end
+   * have been recorded and an instant event for each recorded event.
+   *
+   * @throw std::system_error if the file cannot be written.
+   */
+  void writeChromeTrace(std::string const &path) const;
+
+private:
+
+  /**
+   * Slot of the ring. The sequence number is zero if the slot has never been
+   * written, odd while it is being written, and even once it has been
+   * written. The fields are atomic so that reading a slot while it is being
+   * written is not a data race, but the sequence number is needed for
+   * detecting whether they belong to the same event.
+   */
+  struct Slot {
+    std::atomic<std::uint64_t> sequence;
+    std::atomic<std::uint64_t> runId;
+    std::atomic<std::int64_t> time;
+    std::atomic<std::uint32_t> source;
+    std::atomic<std::uint32_t> event;
+  };
+
+  static RunTrace instance;
+
+  std::chrono::steady_clock::time_point epoch;
+  std::atomic<std::uint64_t> nextIndex;
+  std::atomic<std::uint64_t> nextRunId;
+  std::array<Slot, capacity> slots;
+  mutable std::mutex sourcesMutex;
+  std::vector<std::string> sourceNames;
+
+  // We do not want to allow copy or move construction or assignment.
+  RunTrace(RunTrace const &) = delete;
+  RunTrace(RunTrace &&) = delete;
+  RunTrace &operator=(RunTrace const &) = delete;
+  RunTrace &operator=(RunTrace &&) = delete;
+
+  RunTrace();
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_RUN_TRACE_H
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#include <cstdio>
+
+extern "C" {
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif // __linux__
+}
+
+#include "SealedBuffer.h"
+
+// Sealing memory files requires Linux 3.17 and the memfd_create() wrapper
+// requires glibc 2.27.
+#if defined(__linux__) && defined(MFD_ALLOW_SEALING) && defined(F_ADD_SEALS)
+#define EPICS_EXEC_USE_MEMFD 1
+#endif
+
+namespace epics {
+namespace execute {
+
+namespace {
+
+#ifdef EPICS_EXEC_USE_MEMFD
+/**
+ * Creates a sealed memory file with the specified data and maps it into
+ * memory. Returns the file descriptor or -1 if the file cannot be created (and
+ * mapping is not changed in this case).
+ */
+int createMemoryFile(char const *data, std::size_t size,
+    char const *&mapping) {
+  int fd = ::memfd_create("execute-stdin", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd == -1) {
+    return -1;
+  }
+  // This is the only time that the data is copied.
+  std::size_t totalBytesWritten = 0;
+  while (totalBytesWritten < size) {
+    auto bytesWritten = ::write(fd, data + totalBytesWritten,
+        size - totalBytesWritten);
+    if (bytesWritten == -1 && errno != EINTR) {
+      ::close(fd);
+      return -1;
+    } else if (bytesWritten > 0) {
+      totalBytesWritten += bytesWritten;
+    }
+  }
+  // Once the file is sealed, it cannot be modified any longer, so it is safe
+  // to share it with child processes.
+  if (::fcntl(fd, F_ADD_SEALS,
+      F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+    ::close(fd);
+    return -1;
+  }
+  void *address = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (address == MAP_FAILED) {
+    ::close(fd);
+    return -1;
+  }
+  mapping = static_cast<char const *>(address);
+  return fd;
+}
+#endif // EPICS_EXEC_USE_MEMFD
+
+} // anonymous namespace
+
+SealedBuffer::SealedBuffer(char const *data, std::size_t size) :
+    data(nullptr), fd(-1), size(size) {
+#ifdef EPICS_EXEC_USE_MEMFD
+  // Small buffers are kept in a vector and written into a pipe. This avoids
+  // creating and mapping a memory file (and unmapping it again, which causes
+  // TLB shootdowns) each time a record sets a short input. This also covers
+  // empty buffers, which cannot be mapped into memory.
+  if (size >= memoryFileThreshold) {
+    this->fd = createMemoryFile(data, size, this->data);
+    if (this->fd != -1) {
+      return;
+    }
+  }
+#endif // EPICS_EXEC_USE_MEMFD
+  this->vector.assign(data, data + size);
+  this->data = this->vector.data();
+}
+
+SealedBuffer::~SealedBuffer() {
+#ifdef EPICS_EXEC_USE_MEMFD
+  if (this->fd != -1) {
+    ::munmap(const_cast<char *>(this->data), this->size);
+    ::close(this->fd);
+  }
+#endif // EPICS_EXEC_USE_MEMFD
+}
+
+int SealedBuffer::openFd() const {
+  if (this->fd == -1) {
+    return -1;
+  }
+  // Duplicating the file descriptor would share the file offset between all
+  // child processes, so we open the file again through /proc.
+  char path[32];
+  std::snprintf(path, sizeof(path), "/proc/self/fd/%d", this->fd);
+  return ::open(path, O_RDONLY | O_CLOEXEC);
+}
+
+} // namespace execute
+} // namespace epics
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_SEALED_BUFFER_H
+#define EPICS_EXEC_SEALED_BUFFER_H
+
+#include <cstddef>
+#include <vector>
+
+namespace epics {
+namespace execute {
+
+/**
+ * Immutable buffer holding the data for the standard input of a command.
+ *
+ * On Linux, the data is stored in a sealed memory file (created with
+ * memfd_create()). Such a file cannot be modified any longer, so it can be
+ * passed to child processes as their standard input directly, without
+ * copying the data into a pipe. A child process can seek in this file or map
+ * it into memory. The memory file is also mapped into the memory of this
+ * process, so the data can be accessed through getData() without keeping a
+ * second copy.
+ *
+ * If memory files are not supported, the data is kept in a vector instead.
+ * In this case, openFd() returns -1 and the data has to be written into a
+ * pipe. The same applies to buffers smaller than memoryFileThreshold: for
+ * them, creating, mapping, and unmapping the memory file costs more than
+ * writing the data into a pipe.
+ *
+ * This class is thread-safe because instances cannot be modified after
+ * construction.
+ */
+class SealedBuffer {
+
+public:
+
+  /**
+   * Minimum size (in bytes) of a buffer that is stored in a memory file.
+   * Smaller buffers fit into a pipe's default buffer, so they can usually be
+   * written with a single write() call.
+   */
+  static std::size_t const memoryFileThreshold = 65536;
+
+  /**
+   * Creates a buffer holding a copy of the specified data. If the size is
+   * less than memoryFileThreshold or the memory file cannot be created, the
+   * data is copied into a vector instead.
+   */
+  SealedBuffer(char const *data, std::size_t size);
+
+  /**
+   * Destroys this buffer. File descriptors returned by openFd() are not
+   * affected, so child processes can continue reading their input.
+   */
+  ~SealedBuffer();
+
+  /**
+   * Returns a pointer to the data. The pointer stays valid as long as this
+   * buffer exists.
+   */
+  char const *getData() const {
+    return this->data;
+  }
+
+  /**
+   * Returns the number of bytes in this buffer.
+   */
+  std::size_t getSize() const {
+    return this->size;
+  }
+
+  /**
+   * Opens the memory file for reading and returns the new file descriptor.
+   * Each file descriptor has its own file offset, so several child processes
+   * can read the same buffer at the same time. The file descriptor has the
+   * close-on-exec flag set, and the calling code is responsible for closing
+   * it.
+   *
+   * If this buffer is not backed by a memory file or if the file cannot be
+   * opened (e.g. because /proc is not mounted), -1 is returned.
+   */
+  int openFd() const;
+
+private:
+
+  char const *data;
+  int fd;
+  std::size_t size;
+  std::vector<char> vector;
+
+  // We do not want to allow copy or move construction and assignment.
+  SealedBuffer(SealedBuffer const &) = delete;
+  SealedBuffer(SealedBuffer &&) = delete;
+  SealedBuffer &operator=(SealedBuffer const &) = delete;
+  SealedBuffer &operator=(SealedBuffer &&) = delete;
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_SEALED_BUFFER_H
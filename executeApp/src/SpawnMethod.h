@@ -0,0 +1,69 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_SPAWN_METHOD_H
+#define EPICS_EXEC_SPAWN_METHOD_H
+
+namespace epics {
+namespace execute {
+
+/**
+ * Method used for creating the child process that executes a command.
+ */
+enum class SpawnMethod {
+
+  /**
+   * Create the child process with fork(). This is the most portable method,
+   * but the kernel has to duplicate the page tables of the IOC process, so the
+   * time needed for spawning a process grows with the memory used by the IOC.
+   */
+  fork,
+
+  /**
+   * Create the child process with clone(CLONE_VM | CLONE_VFORK). The child
+   * process shares the address space of the IOC process until it calls
+   * execve(), so the time needed for spawning a process does not depend on the
+   * memory used by the IOC. This method is only available on Linux. On other
+   * platforms, fork() is used instead.
+   */
+  vfork,
+
+  /**
+   * Create the child process with posix_spawn(). On recent versions of glibc,
+   * this uses clone(CLONE_VM | CLONE_VFORK) internally, so the performance is
+   * similar to the vfork method.
+   */
+  posixSpawn,
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_SPAWN_METHOD_H
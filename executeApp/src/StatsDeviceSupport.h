@@ -0,0 +1,235 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_STATS_DEVICE_SUPPORT_H
+#define EPICS_EXEC_STATS_DEVICE_SUPPORT_H
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "BaseDeviceSupport.h"
+#include "RunStatistics.h"
+
+namespace epics {
+namespace execute {
+
+/**
+ * Metric that is specified in a record address of type stats.
+ */
+struct StatsMetric {
+
+  /**
+   * Kind of value that is read.
+   */
+  enum class Kind {
+    bytesCaptured,
+    durations,
+    failures,
+    last,
+    mean,
+    p99,
+    runs,
+  };
+
+  /**
+   * Kind of value that is read.
+   */
+  Kind kind;
+
+  /**
+   * Phase of the run. Only used for the kinds referring to durations.
+   */
+  RunStatistics::Phase phase;
+
+  /**
+   * Returns true if the metric refers to a duration.
+   */
+  bool isDuration() const {
+    return kind == Kind::durations || kind == Kind::last
+        || kind == Kind::mean || kind == Kind::p99;
+  }
+
+  /**
+   * Parses the name of a metric. The name is either one of "runs",
+   * "failures", or "bytes_captured", the name of a phase ("queue_wait",
+   * "spawn_time", "first_output", or "wall_time"), or the name of a phase
+   * followed by "_last", "_mean", or "_p99".
+   *
+   * @throws std::invalid_argument if the name does not refer to a metric.
+   */
+  static StatsMetric parse(std::string const &name) {
+    StatsMetric metric;
+    metric.phase = RunStatistics::Phase::wall;
+    if (name == "runs") {
+      metric.kind = Kind::runs;
+      return metric;
+    } else if (name == "failures") {
+      metric.kind = Kind::failures;
+      return metric;
+    } else if (name == "bytes_captured") {
+      metric.kind = Kind::bytesCaptured;
+      return metric;
+    }
+    std::string phaseName;
+    if (removeSuffix(name, "_last", phaseName)) {
+      metric.kind = Kind::last;
+    } else if (removeSuffix(name, "_mean", phaseName)) {
+      metric.kind = Kind::mean;
+    } else if (removeSuffix(name, "_p99", phaseName)) {
+      metric.kind = Kind::p99;
+    } else {
+      phaseName = name;
+      metric.kind = Kind::durations;
+    }
+    if (phaseName == "queue_wait") {
+      metric.phase = RunStatistics::Phase::queueWait;
+    } else if (phaseName == "spawn_time") {
+      metric.phase = RunStatistics::Phase::spawn;
+    } else if (phaseName == "first_output") {
+      metric.phase = RunStatistics::Phase::firstOutput;
+    } else if (phaseName == "wall_time") {
+      metric.phase = RunStatistics::Phase::wall;
+    } else {
+      throw std::invalid_argument(
+          std::string("Unknown statistics metric \"") + name + "\".");
+    }
+    return metric;
+  }
+
+private:
+
+  static bool removeSuffix(std::string const &name, std::string const &suffix,
+      std::string &prefix) {
+    if (name.size() <= suffix.size()
+        || name.compare(name.size() - suffix.size(), suffix.size(), suffix)) {
+      return false;
+    }
+    prefix = name.substr(0, name.size() - suffix.size());
+    return true;
+  }
+
+};
+
+/**
+ * Device support for records reading a single value from the statistics of a
+ * command (see RunStatistics). This device support code only handles record
+ * address of type stats.
+ *
+ * For records with a floating-point value (ai), durations are provided in
+ * seconds. For records with an integer value (longin), they are provided in
+ * microseconds. Counters that do not fit into an integer value are clamped.
+ */
+template <typename RecordType>
+class StatsDeviceSupport : public BaseDeviceSupport<RecordType> {
+
+public:
+
+  /**
+   * Constructor. The parameters are passed to the parent constructor. The
+   * record's value is set directly, so conversion is skipped.
+   *
+   * @throws std::invalid_argument if the metric is unknown or refers to all
+   *     durations of a phase (which can only be read by an aai record).
+   */
+  StatsDeviceSupport(RecordType *record, RecordAddress const &address)
+      : BaseDeviceSupport<RecordType>(record, address, true),
+        metric(StatsMetric::parse(address.getValueName())) {
+    if (metric.kind == StatsMetric::Kind::durations) {
+      throw std::invalid_argument(
+          "All durations of a phase can only be read by an aai record. Use one of the suffixes \"_last\", \"_mean\", or \"_p99\".");
+    }
+  }
+
+  /**
+   * Updates the record's value with the current value of the metric.
+   */
+  void processRecord() {
+    auto &statistics = this->getCommand()->getStatistics();
+    switch (metric.kind) {
+    case StatsMetric::Kind::bytesCaptured:
+      setCount(statistics.getBytesCaptured());
+      break;
+    case StatsMetric::Kind::failures:
+      setCount(statistics.getFailures());
+      break;
+    case StatsMetric::Kind::runs:
+      setCount(statistics.getRuns());
+      break;
+    case StatsMetric::Kind::last:
+      setDuration(statistics.getSummary(metric.phase).last);
+      break;
+    case StatsMetric::Kind::mean:
+      setDuration(statistics.getSummary(metric.phase).mean);
+      break;
+    case StatsMetric::Kind::p99:
+      setDuration(statistics.getSummary(metric.phase).p99);
+      break;
+    default:
+      throw std::logic_error("Unexpected statistics metric.");
+    }
+    // Conversion is skipped for the ai record, so the record support does not
+    // reset the UDF field.
+    this->getRecord()->udf = 0;
+  }
+
+private:
+
+  using ValueType = typename std::remove_reference<
+      decltype(static_cast<RecordType *>(nullptr)->val)>::type;
+
+  StatsMetric metric;
+
+  void setCount(std::uint64_t count) {
+    if (std::is_floating_point<ValueType>::value) {
+      this->getRecord()->val = static_cast<ValueType>(count);
+    } else {
+      this->getRecord()->val = static_cast<ValueType>(std::min<std::uint64_t>(
+          count, std::numeric_limits<ValueType>::max()));
+    }
+  }
+
+  void setDuration(std::chrono::nanoseconds duration) {
+    if (std::is_floating_point<ValueType>::value) {
+      this->getRecord()->val = static_cast<ValueType>(duration.count() / 1e9);
+    } else {
+      setCount(std::chrono::duration_cast<std::chrono::microseconds>(
+          duration).count());
+    }
+  }
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_STATS_DEVICE_SUPPORT_H
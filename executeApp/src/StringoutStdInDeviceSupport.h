@@ -1,6 +1,6 @@
 /*
- * Copyright 2018 aquenos GmbH.
- * Copyright 2018 Karlsruhe Institute of Technology.
+ * Copyright 2018-2026 aquenos GmbH.
+ * Copyright 2018-2026 Karlsruhe Institute of Technology.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as
@@ -66,8 +66,7 @@ public:
    */
   void processRecord() {
     char *cStr = getRecord()->val;
-    std::vector<char> buffer(cStr, cStr + std::strlen(cStr));
-    getCommand()->setStdInBuffer(buffer);
+    getCommand()->setStdInBuffer(cStr, std::strlen(cStr));
   }
 
 };
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "Command.h"
+#include "IoReactor.h"
+#include "Supervisor.h"
+#include "ThreadPoolExecutor.h"
+
+namespace epics {
+namespace execute {
+
+Supervisor::Supervisor(Command &command) : command(command),
+    currentRestartDelay(std::chrono::seconds(1)),
+    listeners(std::make_shared<std::vector<Listener>>()) {
+  this->options.minRestartDelay = std::chrono::seconds(1);
+  this->options.maxRestartDelay = std::chrono::seconds(60);
+  this->status.lastExitCode = 0;
+  this->status.restartCount = 0;
+  this->status.state = State::stopped;
+}
+
+void Supervisor::addListener(Listener listener) {
+  std::lock_guard<std::mutex> lock(mutex);
+  // The list of listeners is copied when it is modified, so that
+  // notifyListeners() can call the listeners without holding the mutex.
+  auto newListeners = std::make_shared<std::vector<Listener>>(
+      *this->listeners);
+  newListeners->push_back(std::move(listener));
+  this->listeners = std::move(newListeners);
+}
+
+Supervisor::Options Supervisor::getOptions() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return this->options;
+}
+
+Supervisor::Status Supervisor::getStatus() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return this->status;
+}
+
+void Supervisor::setOptions(Options const &options) {
+  if (options.minRestartDelay.count() <= 0) {
+    throw std::invalid_argument(
+        "The minimum restart delay must be greater than zero.");
+  }
+  if (options.minRestartDelay > options.maxRestartDelay) {
+    throw std::invalid_argument(
+        "The minimum restart delay must not be greater than the maximum restart delay.");
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  this->options = options;
+  // Before the program has been started, the delay has not been increased
+  // yet, so it starts at the new minimum.
+  if (this->status.state == State::stopped) {
+    this->currentRestartDelay = options.minRestartDelay;
+  } else {
+    this->currentRestartDelay = std::max(options.minRestartDelay,
+        std::min(options.maxRestartDelay, this->currentRestartDelay));
+  }
+}
+
+void Supervisor::start() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (this->status.state != State::stopped) {
+      return;
+    }
+    this->status.state = State::running;
+  }
+  notifyListeners();
+  auto self = shared_from_this();
+  try {
+    sharedThreadPoolExecutor().submit(this->command.getExecutorQueue(),
+        [self]() {
+      self->startRun(false);
+    });
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->status.state = State::stopped;
+    throw;
+  }
+}
+
+void Supervisor::notifyListeners() {
+  std::shared_ptr<std::vector<Listener> const> listeners;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    listeners = this->listeners;
+  }
+  for (auto &listener : *listeners) {
+    listener();
+  }
+}
+
+void Supervisor::runCompleted(int exitCode) {
+  auto now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    // If the program has been running for a long time, it was not failing
+    // repeatedly, so we restart it quickly.
+    if (now - this->runStartTime >= this->options.maxRestartDelay) {
+      this->currentRestartDelay = this->options.minRestartDelay;
+    }
+    this->status.lastExitCode = exitCode;
+  }
+  scheduleRestart();
+}
+
+void Supervisor::scheduleRestart() {
+  std::chrono::milliseconds delay;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    delay = this->currentRestartDelay;
+    this->currentRestartDelay = std::min(this->options.maxRestartDelay,
+        this->currentRestartDelay * 2);
+    this->status.state = State::waiting;
+  }
+  notifyListeners();
+  // The restart is scheduled through the I/O reactor, so no thread is blocked
+  // while waiting. When the delay has passed, the program is started from a
+  // thread of the pool because creating the child process might take some
+  // time and we do not want to block the reactor's thread. If the task cannot
+  // be submitted (because the pool's queue is full), we simply try again
+  // after the next delay. In this case, the program has not been restarted,
+  // so neither the exit code nor the restart count are changed.
+  auto self = shared_from_this();
+  try {
+    IoReactor::getInstance().postDelayed(delay, [self]() {
+      try {
+        sharedThreadPoolExecutor().submit(self->command.getExecutorQueue(),
+            [self]() {
+          self->startRun(true);
+        });
+      } catch (...) {
+        self->scheduleRestart();
+      }
+    });
+  } catch (...) {
+    // If the reactor's thread cannot be started, there is no way to restart
+    // the program later, so we give up.
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      this->status.state = State::stopped;
+    }
+    notifyListeners();
+  }
+}
+
+void Supervisor::startRun(bool restart) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->runStartTime = std::chrono::steady_clock::now();
+    // For the first run, start() has already updated the state.
+    if (restart) {
+      ++this->status.restartCount;
+      this->status.state = State::running;
+    }
+  }
+  if (restart) {
+    notifyListeners();
+  }
+  // The exit code is taken from the result that is passed to the completion
+  // handler. The command might have been run again by the time the handler
+  // is called, so the last result of the command might belong to a different
+  // run.
+  auto self = shared_from_this();
+  try {
+    this->command.runAsync([self](std::exception_ptr error,
+        std::shared_ptr<Command::Result const> result) {
+      self->runCompleted((error || !result) ? Command::exitCodeSystemError
+          : result->exitCode);
+    });
+  } catch (...) {
+    // If runAsync throws, the completion handler is not called, so we have to
+    // schedule the restart ourselves.
+    runCompleted(Command::exitCodeSystemError);
+  }
+}
+
+} // namespace execute
+} // namespace epics
@@ -0,0 +1,208 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_SUPERVISOR_H
+#define EPICS_EXEC_SUPERVISOR_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace epics {
+namespace execute {
+
+class Command;
+
+/**
+ * Keeps a long-running program (a daemon) running by running its command
+ * again each time the program terminates.
+ *
+ * Runs are started through Command::runAsync(...), so no thread is blocked
+ * while the program is running. When the program terminates, the supervisor
+ * waits before starting it again. The delay starts at the minimum restart
+ * delay and doubles with each restart until it reaches the maximum restart
+ * delay. If the program has been running for at least the maximum restart
+ * delay, it is considered to have been running successfully and the delay
+ * starts at the minimum again.
+ *
+ * This class is thread-safe.
+ */
+class Supervisor : public std::enable_shared_from_this<Supervisor> {
+
+public:
+
+  /**
+   * Handler that is called when the status of the supervisor has changed.
+   * Listeners are called from the I/O reactor's thread or from a thread of
+   * the shared thread pool, so they must not block.
+   */
+  using Listener = std::function<void()>;
+
+  /**
+   * Options controlling the delay between restarts.
+   */
+  struct Options {
+
+    /**
+     * Delay before the first restart after a failure.
+     */
+    std::chrono::milliseconds minRestartDelay;
+
+    /**
+     * Upper limit for the delay between restarts.
+     */
+    std::chrono::milliseconds maxRestartDelay;
+
+  };
+
+  /**
+   * State of the supervised program.
+   */
+  enum class State {
+
+    /**
+     * The program has not been started yet.
+     */
+    stopped = 0,
+
+    /**
+     * The program is running (or is being started).
+     */
+    running = 1,
+
+    /**
+     * The program has terminated and is going to be restarted once the
+     * restart delay has passed.
+     */
+    waiting = 2,
+
+  };
+
+  /**
+   * Status of the supervised program.
+   */
+  struct Status {
+
+    /**
+     * Exit code of the last run of the program. Zero if the program has not
+     * terminated yet.
+     */
+    int lastExitCode;
+
+    /**
+     * Number of times that the program has been restarted.
+     */
+    std::uint64_t restartCount;
+
+    /**
+     * Current state of the program.
+     */
+    State state;
+
+  };
+
+  /**
+   * Creates a supervisor for the specified command. The supervisor keeps a
+   * reference to the command, so the command must not be destroyed before the
+   * supervisor. Usually, the supervisor is created through
+   * Command::supervise(), which takes care of this. The program is only
+   * started when start() is called.
+   *
+   * The supervisor restarts the program after one second at first and waits
+   * for up to one minute between restarts.
+   */
+  Supervisor(Command &command);
+
+  /**
+   * Registers a listener that is called each time the status changes.
+   */
+  void addListener(Listener listener);
+
+  /**
+   * Returns the options of this supervisor.
+   */
+  Options getOptions() const;
+
+  /**
+   * Returns the current status of the supervised program.
+   */
+  Status getStatus() const;
+
+  /**
+   * Changes the options of this supervisor. Changes take effect with the next
+   * restart.
+   *
+   * @throws std::invalid_argument if the minimum restart delay is zero or
+   *     greater than the maximum restart delay.
+   */
+  void setOptions(Options const &options);
+
+  /**
+   * Starts the program. Calling this method has no effect if the program has
+   * already been started. The program is started asynchronously, so this
+   * method does not block.
+   *
+   * @throws std::runtime_error if the task starting the program cannot be
+   *     submitted to the shared thread pool.
+   */
+  void start();
+
+private:
+
+  Command &command;
+  std::chrono::milliseconds currentRestartDelay;
+  std::shared_ptr<std::vector<Listener> const> listeners;
+  mutable std::mutex mutex;
+  Options options;
+  std::chrono::steady_clock::time_point runStartTime;
+  Status status;
+
+  // We do not want to allow copy or move construction and assignment.
+  Supervisor(Supervisor const &) = delete;
+  Supervisor(Supervisor &&) = delete;
+  Supervisor &operator=(Supervisor const &) = delete;
+  Supervisor &operator=(Supervisor &&) = delete;
+
+  void notifyListeners();
+
+  void runCompleted(int exitCode);
+
+  void scheduleRestart();
+
+  void startRun(bool restart);
+
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_SUPERVISOR_H
@@ -0,0 +1,239 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_TASK_H
+#define EPICS_EXEC_TASK_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace epics {
+namespace execute {
+
+/**
+ * Move-only wrapper for a function object that takes no arguments.
+ *
+ * Unlike std::function, this class does not require the function object to be
+ * copyable, and it stores function objects that are small enough (like
+ * lambda expressions capturing a few pointers or a std::function) inside the
+ * Task object itself, so creating a Task for such a function object does not
+ * allocate memory. Larger function objects are stored on the heap.
+ */
+class Task {
+
+public:
+
+  /**
+   * Creates an empty task. Calling an empty task results in undefined
+   * behavior.
+   */
+  Task() noexcept : operations(nullptr) {
+  }
+
+  /**
+   * Creates a task that calls the specified function object.
+   */
+  template<typename Function, typename = typename std::enable_if<
+    !std::is_same<typename std::decay<Function>::type, Task>::value
+  >::type>
+  Task(Function &&function) : operations(nullptr) {
+    using StoredFunction = typename std::decay<Function>::type;
+    using Ops = typename std::conditional<
+      storedInline<StoredFunction>(),
+      InlineOperations<StoredFunction>,
+      HeapOperations<StoredFunction>
+    >::type;
+    Ops::create(&this->storage, std::forward<Function>(function));
+    this->operations = &Ops::operations;
+  }
+
+  /**
+   * Move constructor. The other task is empty after the move.
+   */
+  Task(Task &&other) noexcept : operations(other.operations) {
+    if (this->operations) {
+      this->operations->moveAndDestroy(&other.storage, &this->storage);
+      other.operations = nullptr;
+    }
+  }
+
+  /**
+   * Destroys the function object stored in this task.
+   */
+  ~Task() {
+    reset();
+  }
+
+  /**
+   * Move assignment. The other task is empty after the move.
+   */
+  Task &operator=(Task &&other) noexcept {
+    if (this != &other) {
+      reset();
+      if (other.operations) {
+        other.operations->moveAndDestroy(&other.storage, &this->storage);
+        this->operations = other.operations;
+        other.operations = nullptr;
+      }
+    }
+    return *this;
+  }
+
+  /**
+   * Tells whether this task stores a function object.
+   */
+  explicit operator bool() const noexcept {
+    return this->operations != nullptr;
+  }
+
+  /**
+   * Calls the stored function object.
+   */
+  void operator()() {
+    this->operations->invoke(&this->storage);
+  }
+
+  /**
+   * Destroys the stored function object, so that this task is empty
+   * afterwards.
+   */
+  void reset() noexcept {
+    if (this->operations) {
+      this->operations->destroy(&this->storage);
+      this->operations = nullptr;
+    }
+  }
+
+private:
+
+  /**
+   * Size of the storage for function objects that are stored inline. This is
+   * sufficient for a std::function and a few more pointers.
+   */
+  static constexpr std::size_t inlineStorageSize = 48;
+
+  using Storage = typename std::aligned_storage<
+    inlineStorageSize, alignof(std::max_align_t)>::type;
+
+  struct Operations {
+    void (*destroy)(void *storage);
+    void (*invoke)(void *storage);
+    void (*moveAndDestroy)(void *from, void *to);
+  };
+
+  // Function objects are only stored inline if moving them cannot throw,
+  // because the move constructor and move assignment operator of Task must
+  // not throw either.
+  template<typename Function>
+  static constexpr bool storedInline() {
+    return sizeof(Function) <= inlineStorageSize
+        && alignof(Function) <= alignof(Storage)
+        && std::is_nothrow_move_constructible<Function>::value;
+  }
+
+  template<typename Function>
+  struct InlineOperations {
+
+    static Operations const operations;
+
+    template<typename F>
+    static void create(void *storage, F &&function) {
+      new (storage) Function(std::forward<F>(function));
+    }
+
+    static void destroy(void *storage) {
+      static_cast<Function *>(storage)->~Function();
+    }
+
+    static void invoke(void *storage) {
+      (*static_cast<Function *>(storage))();
+    }
+
+    static void moveAndDestroy(void *from, void *to) {
+      auto fromFunction = static_cast<Function *>(from);
+      new (to) Function(std::move(*fromFunction));
+      fromFunction->~Function();
+    }
+
+  };
+
+  template<typename Function>
+  struct HeapOperations {
+
+    static Operations const operations;
+
+    template<typename F>
+    static void create(void *storage, F &&function) {
+      *static_cast<Function **>(storage) =
+          new Function(std::forward<F>(function));
+    }
+
+    static void destroy(void *storage) {
+      delete *static_cast<Function **>(storage);
+    }
+
+    static void invoke(void *storage) {
+      (**static_cast<Function **>(storage))();
+    }
+
+    static void moveAndDestroy(void *from, void *to) {
+      *static_cast<Function **>(to) = *static_cast<Function **>(from);
+    }
+
+  };
+
+  Storage storage;
+  Operations const *operations;
+
+  // We do not want to allow copy construction and assignment.
+  Task(Task const &) = delete;
+  Task &operator=(Task const &) = delete;
+
+};
+
+template<typename Function>
+Task::Operations const Task::InlineOperations<Function>::operations = {
+  &Task::InlineOperations<Function>::destroy,
+  &Task::InlineOperations<Function>::invoke,
+  &Task::InlineOperations<Function>::moveAndDestroy,
+};
+
+template<typename Function>
+Task::Operations const Task::HeapOperations<Function>::operations = {
+  &Task::HeapOperations<Function>::destroy,
+  &Task::HeapOperations<Function>::invoke,
+  &Task::HeapOperations<Function>::moveAndDestroy,
+};
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_TASK_H
@@ -1,6 +1,6 @@
 /*
- * Copyright 2023 aquenos GmbH.
- * Copyright 2023 Karlsruhe Institute of Technology.
+ * Copyright 2023-2026 aquenos GmbH.
+ * Copyright 2023-2026 Karlsruhe Institute of Technology.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as
@@ -27,55 +27,475 @@
  * of the GNU LGPL version 3 or newer.
  */
 
+#include <algorithm>
+#include <string>
+#include <thread>
+
+#include "Probes.h"
 #include "ThreadPoolExecutor.h"
 
 namespace epics {
 namespace execute {
 
-ThreadPoolExecutor::ThreadPoolExecutor(
-  int maximumNumberOfIdleThreads
-) : sharedState(std::make_shared<SharedState>()) {
-  this->sharedState->idleThreads = 0;
-  this->sharedState->maxIdleThreads = maximumNumberOfIdleThreads;
-  this->sharedState->shutdown = false;
+ThreadPoolExecutor::Queue::Queue(std::string const &name, Priority priority,
+    int weight, std::size_t capacity)
+    : maxWaitTimeNanoseconds(0), name(name), priority(priority),
+      tasks(capacity), tasksTaken(0), totalWaitTimeNanoseconds(0),
+      weight(weight) {
+}
+
+ThreadPoolExecutor::QueueStatistics ThreadPoolExecutor::Queue::getStatistics()
+    const {
+  // The individual values are not read atomically, so they might not be
+  // perfectly consistent if a task is taken from the queue concurrently.
+  QueueStatistics statistics;
+  statistics.maxWaitTime = std::chrono::nanoseconds(
+      this->maxWaitTimeNanoseconds.load(std::memory_order_relaxed));
+  statistics.tasks = this->tasksTaken.load(std::memory_order_relaxed);
+  statistics.totalWaitTime = std::chrono::nanoseconds(
+      this->totalWaitTimeNanoseconds.load(std::memory_order_relaxed));
+  return statistics;
+}
+
+ThreadPoolExecutor::SharedState::SharedState()
+    : blockedSubmitters(0), defaultQueue(nullptr), idleTimeoutMilliseconds(0),
+      idleThreads(0), maxQueueSize(0), maxThreads(0), minThreads(0),
+      queuedTasks(0), rejectionPolicy(RejectionPolicy::block),
+      shutdown(false), sleepingThreads(0), threads(0) {
+  for (int i = 0; i < numberOfPriorities; ++i) {
+    this->wheelCursors[i].store(0);
+    this->wheels[i].store(nullptr);
+  }
+}
+
+ThreadPoolExecutor::ThreadPoolExecutor(Configuration const &configuration,
+    std::size_t queueCapacity) : sharedState(std::make_shared<SharedState>()) {
+  validateConfiguration(configuration);
+  // The queue has to be able to hold the tasks for all threads and one more
+  // task for a thread that is about to be created, in addition to the queued
+  // tasks.
+  auto requiredQueueCapacity = configuration.maxQueueSize
+      + static_cast<std::size_t>(configuration.maxThreads) + 1;
+  if (queueCapacity == 0) {
+    queueCapacity = requiredQueueCapacity;
+  }
+  this->sharedState->defaultQueue = &this->createQueue(
+      std::string(), Priority::normal, 1, queueCapacity);
+  this->configure(configuration);
 }
 
 ThreadPoolExecutor::~ThreadPoolExecutor() {
+  this->sharedState->shutdown.store(true);
   {
+    // Threads check the shutdown flag while holding the mutex before going to
+    // sleep, so we have to acquire the mutex in order to ensure that they
+    // either see the flag or receive the notification.
     std::lock_guard<std::mutex> lock(this->sharedState->mutex);
-    this->sharedState->shutdown = true;
   }
   this->sharedState->wakeUpCv.notify_all();
+  this->sharedState->spaceAvailableCv.notify_all();
+}
+
+void ThreadPoolExecutor::configure(Configuration const &configuration) {
+  validateConfiguration(configuration);
+  auto &state = *this->sharedState;
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (configuration.maxQueueSize
+        + static_cast<std::size_t>(configuration.maxThreads)
+        >= state.defaultQueue->tasks.getCapacity()) {
+      throw std::invalid_argument(
+          "The sum of the maximum queue size and the maximum number of threads must be less than "
+          + std::to_string(state.defaultQueue->tasks.getCapacity()) + ".");
+    }
+    state.idleTimeoutMilliseconds.store(configuration.idleTimeout.count());
+    state.maxQueueSize.store(configuration.maxQueueSize);
+    state.maxThreads.store(configuration.maxThreads);
+    state.minThreads.store(configuration.minThreads);
+    state.rejectionPolicy.store(configuration.rejectionPolicy);
+  }
+  // Idle threads have to check whether they should be retired, and blocked
+  // submitters have to check whether there is space in the queue now.
+  state.wakeUpCv.notify_all();
+  state.spaceAvailableCv.notify_all();
+}
+
+ThreadPoolExecutor::Queue &ThreadPoolExecutor::createQueue(
+    std::string const &name, Priority priority, int weight,
+    std::size_t capacity) {
+  validateWeight(weight);
+  auto &state = *this->sharedState;
+  std::unique_ptr<Queue> queue(new Queue(name, priority, weight, capacity));
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.queues.push_back(std::move(queue));
+  rebuildWheel(state, priority);
+  return *state.queues.back();
+}
+
+ThreadPoolExecutor::Configuration ThreadPoolExecutor::getConfiguration()
+    const {
+  auto &state = *this->sharedState;
+  std::lock_guard<std::mutex> lock(state.mutex);
+  Configuration configuration;
+  configuration.idleTimeout = std::chrono::milliseconds(
+      state.idleTimeoutMilliseconds.load());
+  configuration.maxQueueSize = state.maxQueueSize.load();
+  configuration.maxThreads = state.maxThreads.load();
+  configuration.minThreads = state.minThreads.load();
+  configuration.rejectionPolicy = state.rejectionPolicy.load();
+  return configuration;
+}
+
+ThreadPoolExecutor::Queue &ThreadPoolExecutor::getDefaultQueue() {
+  return *this->sharedState->defaultQueue;
+}
+
+int ThreadPoolExecutor::getIdleThreadCount() const {
+  return this->sharedState->idleThreads.load();
+}
+
+std::size_t ThreadPoolExecutor::getQueueSize() const {
+  return this->sharedState->queuedTasks.load();
+}
+
+std::vector<ThreadPoolExecutor::Queue *> ThreadPoolExecutor::getQueues()
+    const {
+  auto &state = *this->sharedState;
+  std::lock_guard<std::mutex> lock(state.mutex);
+  std::vector<Queue *> queues;
+  for (auto &queue : state.queues) {
+    queues.push_back(queue.get());
+  }
+  return queues;
+}
+
+int ThreadPoolExecutor::getThreadCount() const {
+  return this->sharedState->threads.load();
+}
+
+void ThreadPoolExecutor::setQueueScheduling(Queue &queue, Priority priority,
+    int weight) {
+  validateWeight(weight);
+  auto &state = *this->sharedState;
+  std::lock_guard<std::mutex> lock(state.mutex);
+  auto oldPriority = queue.priority.load();
+  queue.priority.store(priority);
+  queue.weight.store(weight);
+  // We add the queue to the new wheel before removing it from the old one,
+  // so that threads can always find the tasks in the queue.
+  rebuildWheel(state, priority);
+  if (oldPriority != priority) {
+    rebuildWheel(state, oldPriority);
+  }
+}
+
+bool ThreadPoolExecutor::enqueue(Queue &queue, Task &task) {
+  auto &state = *this->sharedState;
+  while (true) {
+    if (state.shutdown.load()) {
+      throw std::runtime_error(
+          "The task has been rejected because the executor is shutting down.");
+    }
+    // We reserve a place in the queue before actually pushing the task, so
+    // that concurrent submissions cannot exceed the maximum queue size. Tasks
+    // that are going to be picked up by idle threads or by a thread that we
+    // are going to create do not count towards the queue size. A thread only
+    // stops being idle when it takes a task from the queue, so we have to
+    // compare with the number of tasks that are already waiting.
+    auto queued = state.queuedTasks.load();
+    bool reserved = false;
+    while (true) {
+      auto idle = static_cast<std::size_t>(
+          std::max(state.idleThreads.load(), 0));
+      bool canCreateThread = state.threads.load() < state.maxThreads.load();
+      auto limit = idle + state.maxQueueSize.load() + (canCreateThread ? 1 : 0);
+      if (queued >= limit) {
+        break;
+      }
+      if (state.queuedTasks.compare_exchange_weak(queued, queued + 1)) {
+        reserved = true;
+        break;
+      }
+    }
+    if (reserved) {
+      // The capacity of the default queue is chosen so that pushing cannot
+      // fail when we have a reservation, unless the maximum number of threads
+      // was reduced and there are more idle threads than allowed. Other
+      // queues might be full, though. We treat this like a full queue.
+      Queue::QueuedTask queuedTask;
+      queuedTask.submitTime = std::chrono::steady_clock::now();
+      queuedTask.task = std::move(task);
+      if (queue.tasks.tryPush(std::move(queuedTask))) {
+        EPICS_EXEC_PROBE2(task_submit, queue.name.c_str(), queued + 1);
+        // Threads that are sleeping check queuedTasks after incrementing
+        // sleepingThreads, and we check sleepingThreads after incrementing
+        // queuedTasks, so either the thread sees the task or we see the
+        // sleeping thread.
+        if (state.sleepingThreads.load() > 0) {
+          std::lock_guard<std::mutex> lock(state.mutex);
+          state.wakeUpCv.notify_one();
+        }
+        startThreadIfNeeded(this->sharedState, queued + 1);
+        return true;
+      }
+      task = std::move(queuedTask.task);
+      queued = state.queuedTasks.fetch_sub(1) - 1;
+      wakeUpBlockedSubmitter(state);
+    }
+    switch (state.rejectionPolicy.load()) {
+    case RejectionPolicy::block:
+      {
+        std::unique_lock<std::mutex> lock(state.mutex);
+        state.blockedSubmitters.fetch_add(1);
+        // Threads that take a task from the queue notify us after
+        // decrementing queuedTasks if blockedSubmitters is non-zero, so we
+        // cannot miss the notification.
+        if (state.queuedTasks.load() >= queued && !state.shutdown.load()) {
+          state.spaceAvailableCv.wait(lock);
+        }
+        state.blockedSubmitters.fetch_sub(1);
+      }
+      break;
+    case RejectionPolicy::callerRuns:
+      return false;
+    case RejectionPolicy::abort:
+    default:
+      throw std::runtime_error(
+          "The task has been rejected because the queue is full.");
+    }
+  }
 }
 
 void ThreadPoolExecutor::processTasks(
   std::shared_ptr<ThreadPoolExecutor::SharedState> sharedState
 ) {
-  // This method is called in each one of the executor threads.
-  std::unique_lock<std::mutex> lock(sharedState->mutex);
+  // This method is called in each one of the executor threads. A new thread
+  // has already been counted as idle by the thread that created it.
+  auto &state = *sharedState;
+  EPICS_EXEC_PROBE1(thread_create, state.threads.load());
+  Task task;
   while (true) {
-    if (sharedState->pendingTasks.empty()) {
-      if (sharedState->shutdown) {
-        --sharedState->idleThreads;
-        break;
+    if (takeTask(state, task)) {
+      state.idleThreads.fetch_sub(1);
+      state.queuedTasks.fetch_sub(1);
+      wakeUpBlockedSubmitter(state);
+      try {
+        task();
+      } catch (...) {
+        // There is nobody who could handle the exception, so we ignore it.
       }
-      sharedState->wakeUpCv.wait(lock);
+      EPICS_EXEC_PROBE(task_finish);
+      // We destroy the task before becoming idle, so that resources held by
+      // the function object are released right away.
+      task.reset();
+      state.idleThreads.fetch_add(1);
       continue;
     }
-    auto task = std::move(sharedState->pendingTasks.front());
-    sharedState->pendingTasks.pop_front();
-    lock.unlock();
-    task();
-    lock.lock();
-    if (sharedState->idleThreads == sharedState->maxIdleThreads) {
+    if (state.shutdown.load()) {
       break;
     }
-    ++sharedState->idleThreads;
+    // If the maximum number of threads has been reduced, we retire threads
+    // exceeding the new limit.
+    if (retireThread(state, state.maxThreads.load())) {
+      EPICS_EXEC_PROBE1(thread_exit, state.threads.load());
+      return;
+    }
+    auto status = std::cv_status::no_timeout;
+    {
+      std::unique_lock<std::mutex> lock(state.mutex);
+      state.sleepingThreads.fetch_add(1);
+      if (state.queuedTasks.load() == 0 && !state.shutdown.load()) {
+        // A thread that would not be retired anyway waits without a timeout.
+        // Otherwise, a short (or zero) idle timeout would make the threads
+        // that are kept alive wake up over and over again. configure()
+        // wakes all threads, so they see a change of the limits.
+        if (state.threads.load() <= state.minThreads.load()) {
+          state.wakeUpCv.wait(lock);
+        } else {
+          status = state.wakeUpCv.wait_for(lock, std::chrono::milliseconds(
+              state.idleTimeoutMilliseconds.load()));
+        }
+      }
+      state.sleepingThreads.fetch_sub(1);
+    }
+    // Threads exceeding the minimum number of threads are retired when they
+    // have been idle for the configured time.
+    if (status == std::cv_status::timeout
+        && retireThread(state, state.minThreads.load())) {
+      EPICS_EXEC_PROBE1(thread_exit, state.threads.load());
+      return;
+    }
+  }
+  state.idleThreads.fetch_sub(1);
+  state.threads.fetch_sub(1);
+  EPICS_EXEC_PROBE1(thread_exit, state.threads.load());
+}
+
+void ThreadPoolExecutor::rebuildWheel(SharedState &state,
+    Priority priority) {
+  // This method must only be called while holding the mutex.
+  std::vector<Queue *> queues;
+  int totalWeight = 0;
+  for (auto &queue : state.queues) {
+    if (queue->priority.load() == priority) {
+      queues.push_back(queue.get());
+      totalWeight += queue->weight.load();
+    }
+  }
+  // We distribute the slots of each queue evenly across the wheel (using the
+  // smooth weighted round-robin algorithm), so that a queue with a high
+  // weight does not get many tasks run in a row.
+  std::unique_ptr<Wheel> wheel(new Wheel());
+  wheel->reserve(totalWeight);
+  std::vector<int> currentWeights(queues.size(), 0);
+  for (int slot = 0; slot < totalWeight; ++slot) {
+    std::size_t selected = 0;
+    for (std::size_t i = 0; i < queues.size(); ++i) {
+      currentWeights[i] += queues[i]->weight.load();
+      if (currentWeights[i] > currentWeights[selected]) {
+        selected = i;
+      }
+    }
+    currentWeights[selected] -= totalWeight;
+    wheel->push_back(queues[selected]);
+  }
+  auto index = static_cast<int>(priority);
+  state.wheels[index].store(wheel.get(), std::memory_order_release);
+  state.wheelStorage.push_back(std::move(wheel));
+}
+
+bool ThreadPoolExecutor::retireThread(SharedState &state, int threadLimit) {
+  auto threads = state.threads.load();
+  do {
+    if (threads <= threadLimit) {
+      return false;
+    }
+  } while (!state.threads.compare_exchange_weak(threads, threads - 1));
+  state.idleThreads.fetch_sub(1);
+  // A submitter might have queued a task, counting on this thread to run it.
+  // Submitters check the number of idle threads after incrementing
+  // queuedTasks, and we check queuedTasks after decrementing the number of
+  // idle threads, so either they start a new thread or we stay.
+  if (state.queuedTasks.load() != 0) {
+    state.threads.fetch_add(1);
+    state.idleThreads.fetch_add(1);
+    return false;
+  }
+  return true;
+}
+
+void ThreadPoolExecutor::startThreadIfNeeded(
+    std::shared_ptr<SharedState> const &sharedState, std::size_t queuedTasks) {
+  auto &state = *sharedState;
+  if (queuedTasks <= static_cast<std::size_t>(
+      std::max(state.idleThreads.load(), 0))) {
+    return;
+  }
+  auto threads = state.threads.load();
+  do {
+    if (threads >= state.maxThreads.load()) {
+      return;
+    }
+  } while (!state.threads.compare_exchange_weak(threads, threads + 1));
+  // The new thread counts as idle until it has taken a task.
+  state.idleThreads.fetch_add(1);
+  try {
+    // We create the thread and detach it right away. The thread does not
+    // reference the executor, only the shared state, and the latter is
+    // referenced through a shared_ptr, so it will stay alive as long as
+    // there is a thread.
+    std::thread(&ThreadPoolExecutor::processTasks, sharedState).detach();
+  } catch (...) {
+    // The task has already been queued, so we cannot report the failure to
+    // the submitter. The task is run by an existing thread or by a thread
+    // that is created for one of the next tasks.
+    state.idleThreads.fetch_sub(1);
+    state.threads.fetch_sub(1);
+  }
+}
+
+bool ThreadPoolExecutor::takeTask(SharedState &state, Task &task) {
+  // We look at the wheels in the order of their priority. On each wheel, we
+  // advance the cursor until we find a queue that has a task. The cursor is
+  // shared by all threads, so the queues are served in a round-robin fashion.
+  Queue::QueuedTask queuedTask;
+  for (int i = 0; i < numberOfPriorities; ++i) {
+    auto wheel = state.wheels[i].load(std::memory_order_acquire);
+    if (!wheel) {
+      continue;
+    }
+    auto size = wheel->size();
+    for (std::size_t j = 0; j < size; ++j) {
+      auto queue = (*wheel)[state.wheelCursors[i].fetch_add(
+          1, std::memory_order_relaxed) % size];
+      if (queue->tasks.tryPop(queuedTask)) {
+        auto waitTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - queuedTask.submitTime).count();
+        queue->tasksTaken.fetch_add(1, std::memory_order_relaxed);
+        queue->totalWaitTimeNanoseconds.fetch_add(
+            waitTime, std::memory_order_relaxed);
+        auto maxWaitTime = queue->maxWaitTimeNanoseconds.load(
+            std::memory_order_relaxed);
+        while (waitTime > maxWaitTime
+            && !queue->maxWaitTimeNanoseconds.compare_exchange_weak(
+                maxWaitTime, waitTime, std::memory_order_relaxed)) {
+        }
+        EPICS_EXEC_PROBE2(task_start, queue->name.c_str(), waitTime);
+        task = std::move(queuedTask.task);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void ThreadPoolExecutor::validateConfiguration(
+    Configuration const &configuration) {
+  if (configuration.maxThreads < 1) {
+    throw std::invalid_argument(
+        "The maximum number of threads must be at least one.");
+  }
+  if (configuration.minThreads < 0
+      || configuration.minThreads > configuration.maxThreads) {
+    throw std::invalid_argument(
+        "The minimum number of threads must not be negative or greater than the maximum number of threads.");
+  }
+  if (configuration.idleTimeout.count() < 0) {
+    throw std::invalid_argument("The idle timeout must not be negative.");
+  }
+}
+
+void ThreadPoolExecutor::validateWeight(int weight) {
+  if (weight < 1 || weight > maxWeight) {
+    throw std::invalid_argument("The weight must be between 1 and "
+        + std::to_string(maxWeight) + ".");
+  }
+}
+
+void ThreadPoolExecutor::wakeUpBlockedSubmitter(SharedState &state) {
+  if (state.blockedSubmitters.load() > 0) {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.spaceAvailableCv.notify_one();
   }
 }
 
 namespace {
-  ThreadPoolExecutor sharedExecutor(4);
+
+ThreadPoolExecutor::Configuration sharedExecutorConfiguration() {
+  ThreadPoolExecutor::Configuration configuration;
+  configuration.minThreads = 4;
+  configuration.maxThreads = 16;
+  configuration.maxQueueSize = 1024;
+  configuration.rejectionPolicy =
+      ThreadPoolExecutor::RejectionPolicy::callerRuns;
+  configuration.idleTimeout = std::chrono::seconds(10);
+  return configuration;
+}
+
+// The queue capacity limits the configuration that can be set through
+// executeConfigureThreadPool later.
+ThreadPoolExecutor sharedExecutor(sharedExecutorConfiguration(), 4096);
+
 } // anonymous namespace
 
 ThreadPoolExecutor &sharedThreadPoolExecutor() {
@@ -1,6 +1,6 @@
 /*
- * Copyright 2023 aquenos GmbH.
- * Copyright 2023 Karlsruhe Institute of Technology.
+ * Copyright 2023-2026 aquenos GmbH.
+ * Copyright 2023-2026 Karlsruhe Institute of Technology.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as
@@ -30,31 +30,242 @@
 #ifndef EPICS_EXEC_THREAD_POOL_EXECUTOR_H
 #define EPICS_EXEC_THREAD_POOL_EXECUTOR_H
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <functional>
-#include <future>
-#include <list>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <mutex>
-#include <thread>
-#include <type_traits>
+#include <stdexcept>
+#include <string>
 #include <utility>
+#include <vector>
+
+#include "BoundedMpmcQueue.h"
+#include "Task.h"
 
 namespace epics {
 namespace execute {
 
 /**
  * Executor that runs tasks in separate threads, using a thread pool.
+ *
+ * The number of threads is bounded. Threads are created on demand, and
+ * threads exceeding the minimum number of threads are retired after they have
+ * been idle for some time. If all threads are busy, tasks are queued. If the
+ * queue is full, the rejection policy decides what happens to a new task.
+ *
+ * Tasks are submitted to queues. Each queue has a priority and a weight.
+ * Tasks from queues with a higher priority are always run before tasks from
+ * queues with a lower priority. Queues with the same priority are served in a
+ * weighted round-robin fashion, so a queue with a weight of two gets twice as
+ * many tasks run as a queue with a weight of one, if both have tasks waiting.
+ * Typically, each client (e.g. each command) uses its own queue, so that a
+ * client submitting many tasks cannot delay the tasks of other clients
+ * indefinitely.
+ *
+ * Each queue is a lock-free ring buffer and tasks are stored in Task objects,
+ * so submitting a task (that is small enough to be stored inline) neither
+ * allocates memory nor takes a lock, unless a sleeping thread has to be woken
+ * up or a new thread has to be created. Threads pick the next queue by
+ * advancing a cursor on a wheel that contains each queue of a priority as
+ * many times as its weight. The wheel is only rebuilt when a queue is created
+ * or its priority or weight is changed.
  */
 class ThreadPoolExecutor {
 
 public:
 
   /**
-   * Creates a thread pool that keeps up to the specified number of idle
-   * threads. More threads might still be created on demand.
+   * Priority of a queue.
+   */
+  enum class Priority {
+
+    /**
+     * Tasks from queues with this priority are run before all other tasks.
+     */
+    high,
+
+    /**
+     * Default priority.
+     */
+    normal,
+
+    /**
+     * Tasks from queues with this priority are only run when there are no
+     * other tasks waiting.
+     */
+    low,
+
+  };
+
+  /**
+   * Statistics about the tasks that have been taken from a queue.
+   */
+  struct QueueStatistics {
+
+    /**
+     * Longest time that a task spent in the queue.
+     */
+    std::chrono::nanoseconds maxWaitTime;
+
+    /**
+     * Number of tasks that have been taken from the queue.
+     */
+    std::uint64_t tasks;
+
+    /**
+     * Sum of the times that tasks spent in the queue.
+     */
+    std::chrono::nanoseconds totalWaitTime;
+
+  };
+
+  /**
+   * Queue of tasks that have been submitted, but not started yet. Queues are
+   * created through createQueue(...) and exist as long as the executor that
+   * created them.
+   */
+  class Queue {
+
+  public:
+
+    /**
+     * Returns the name of this queue. The name is only used for reporting
+     * statistics.
+     */
+    std::string const &getName() const {
+      return this->name;
+    }
+
+    /**
+     * Returns the priority of this queue.
+     */
+    Priority getPriority() const {
+      return this->priority.load();
+    }
+
+    /**
+     * Returns statistics about the tasks that have been taken from this
+     * queue.
+     */
+    QueueStatistics getStatistics() const;
+
+    /**
+     * Returns the weight of this queue.
+     */
+    int getWeight() const {
+      return this->weight.load();
+    }
+
+  private:
+
+    friend class ThreadPoolExecutor;
+
+    struct QueuedTask {
+      std::chrono::steady_clock::time_point submitTime;
+      Task task;
+    };
+
+    std::atomic<std::int64_t> maxWaitTimeNanoseconds;
+    std::string name;
+    std::atomic<Priority> priority;
+    BoundedMpmcQueue<QueuedTask> tasks;
+    std::atomic<std::uint64_t> tasksTaken;
+    std::atomic<std::int64_t> totalWaitTimeNanoseconds;
+    std::atomic<int> weight;
+
+    Queue(std::string const &name, Priority priority, int weight,
+        std::size_t capacity);
+
+    // We do not want to allow copy or move construction and assignment.
+    Queue(Queue const &) = delete;
+    Queue(Queue &&) = delete;
+    Queue &operator=(Queue const &) = delete;
+    Queue &operator=(Queue &&) = delete;
+
+  };
+
+  /**
+   * Maximum weight of a queue.
+   */
+  static constexpr int maxWeight = 100;
+
+  /**
+   * Policy that defines what happens when a task is submitted while all
+   * threads are busy and the queue is full.
+   */
+  enum class RejectionPolicy {
+
+    /**
+     * Block the submitting thread until there is space in the queue.
+     */
+    block,
+
+    /**
+     * Run the task in the submitting thread.
+     */
+    callerRuns,
+
+    /**
+     * Throw an exception from submit(...).
+     */
+    abort,
+
+  };
+
+  /**
+   * Configuration of a thread pool.
+   */
+  struct Configuration {
+
+    /**
+     * Number of threads that are kept, even if they are idle. These threads
+     * are created on demand, so a pool that is never used does not have any
+     * threads.
+     */
+    int minThreads = 0;
+
+    /**
+     * Maximum number of threads. Must be at least one.
+     */
+    int maxThreads = 1;
+
+    /**
+     * Maximum number of tasks that wait for a thread. Tasks that are about to
+     * be picked up by an idle thread do not count.
+     */
+    std::size_t maxQueueSize = 0;
+
+    /**
+     * Policy that is applied when all threads are busy and the queue is full.
+     */
+    RejectionPolicy rejectionPolicy = RejectionPolicy::block;
+
+    /**
+     * Time after which an idle thread is retired if there are more than
+     * minThreads threads. If it is zero, such threads are retired as soon as
+     * they become idle. The remaining threads wait without a timeout.
+     */
+    std::chrono::milliseconds idleTimeout = std::chrono::milliseconds(0);
+
+  };
+
+  /**
+   * Creates a thread pool that uses the specified configuration.
+   *
+   * The queue capacity is the capacity of the default queue (see
+   * getDefaultQueue()). It limits the sum of the maximum queue size and the
+   * maximum number of threads that may be set through configure(...) later.
+   * The memory for the queue is allocated when the thread pool is created. If
+   * the queue capacity is zero, the capacity is chosen so that it fits the
+   * initial configuration.
+   *
+   * @throws std::invalid_argument if the configuration is invalid.
    */
-  ThreadPoolExecutor(int maximumNumberOfIdleThreads);
+  ThreadPoolExecutor(Configuration const &configuration,
+      std::size_t queueCapacity = 0);
 
   /**
    * Destructor. When the destructor is called, no new submissions are allowed.
@@ -65,78 +276,182 @@ public:
   ~ThreadPoolExecutor();
 
   /**
-   * Submits a task for execution. The submitted task is executed in a thread
-   * of its own. If possible, an existing thread is reused. Otherwise, a new
-   * thread is created.
+   * Changes the configuration of this thread pool. Threads exceeding the new
+   * maximum number of threads are retired once they have finished their
+   * current task. Tasks that have already been queued stay in the queue, even
+   * if the new queue size is smaller.
+   *
+   * @throws std::invalid_argument if the configuration is invalid or if the
+   *     sum of the maximum queue size and the maximum number of threads
+   *     exceeds the queue capacity.
+   */
+  void configure(Configuration const &configuration);
+
+  /**
+   * Creates a queue with the specified name, priority, and weight. The
+   * capacity limits the number of tasks that may be waiting in the queue
+   * (independently of the maximum queue size that applies to all queues).
+   * When the queue is full, the rejection policy is applied.
+   *
+   * The returned queue exists as long as this executor exists. Queues cannot
+   * be removed, so this method should only be used for long-lived clients.
+   *
+   * @throws std::invalid_argument if the weight is less than one or greater
+   *     than maxWeight.
+   */
+  Queue &createQueue(std::string const &name,
+      Priority priority = Priority::normal, int weight = 1,
+      std::size_t capacity = 64);
+
+  /**
+   * Returns the current configuration of this thread pool.
+   */
+  Configuration getConfiguration() const;
+
+  /**
+   * Returns the queue that is used by submit(Function &&). This queue has
+   * normal priority and a weight of one.
+   */
+  Queue &getDefaultQueue();
+
+  /**
+   * Returns the number of threads that are currently idle.
+   */
+  int getIdleThreadCount() const;
+
+  /**
+   * Returns the number of tasks that have been submitted, but have not been
+   * picked up by a thread yet.
+   */
+  std::size_t getQueueSize() const;
+
+  /**
+   * Returns all queues of this executor, starting with the default queue.
    */
-  template<class Function, class... Args>
-  std::future<
-    typename std::result_of<
-      typename std::decay<Function>::type(typename std::decay<Args>::type...)
-    >::type
-  > submit(Function &&f, Args &&... args);
+  std::vector<Queue *> getQueues() const;
+
+  /**
+   * Returns the number of threads that currently exist in this thread pool.
+   */
+  int getThreadCount() const;
+
+  /**
+   * Changes the priority and weight of a queue that has been created by this
+   * executor.
+   *
+   * @throws std::invalid_argument if the weight is less than one or greater
+   *     than maxWeight.
+   */
+  void setQueueScheduling(Queue &queue, Priority priority, int weight);
+
+  /**
+   * Submits a task for execution, using the default queue. This is
+   * equivalent to calling submit(getDefaultQueue(), function).
+   */
+  template<typename Function>
+  void submit(Function &&function) {
+    submit(getDefaultQueue(), std::forward<Function>(function));
+  }
+
+  /**
+   * Submits a task for execution, using the specified queue. The submitted
+   * task is executed in a thread of the pool. If possible, an existing thread
+   * is reused. Otherwise, a new thread is created, unless the maximum number
+   * of threads has been reached. In this case, the task is queued. If the
+   * queue is full, the rejection policy is applied.
+   *
+   * The task is not expected to throw. If it throws anyway, the exception is
+   * ignored (or passed on to the caller of this method if the task is run in
+   * the calling thread due to RejectionPolicy::callerRuns).
+   *
+   * @throws std::runtime_error if the task is rejected because the queue is
+   *     full and the rejection policy is RejectionPolicy::abort or if the
+   *     executor is being destroyed.
+   */
+  template<typename Function>
+  void submit(Queue &queue, Function &&function);
 
 private:
 
+  static constexpr int numberOfPriorities = 3;
+
+  // A wheel contains each queue of a priority as many times as its weight.
+  using Wheel = std::vector<Queue *>;
+
   struct SharedState {
-    int idleThreads;
-    int maxIdleThreads;
-    std::mutex mutex;
-    std::list<std::function<void()>> pendingTasks;
-    bool shutdown;
+    std::atomic<int> blockedSubmitters;
+    Queue *defaultQueue;
+    std::atomic<std::int64_t> idleTimeoutMilliseconds;
+    std::atomic<int> idleThreads;
+    std::atomic<std::size_t> maxQueueSize;
+    std::atomic<int> maxThreads;
+    std::atomic<int> minThreads;
+    // The mutex is only used for sleeping and waking up threads and for
+    // serializing calls to configure(...) and to methods changing the queues.
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<std::size_t> queuedTasks;
+    std::atomic<RejectionPolicy> rejectionPolicy;
+    std::atomic<bool> shutdown;
+    std::atomic<int> sleepingThreads;
+    std::condition_variable spaceAvailableCv;
+    std::atomic<int> threads;
     std::condition_variable wakeUpCv;
+    std::atomic<std::size_t> wheelCursors[numberOfPriorities];
+    std::atomic<Wheel const *> wheels[numberOfPriorities];
+    // Threads might still use a wheel after it has been replaced, so we keep
+    // all wheels until the shared state is destroyed. Wheels are only
+    // replaced when queues are created or changed, so this is not a problem.
+    std::vector<std::unique_ptr<Wheel>> wheelStorage;
+
+    SharedState();
   };
 
   std::shared_ptr<SharedState> sharedState;
 
+  // We do not want to allow copy or move construction and assignment.
+  ThreadPoolExecutor(ThreadPoolExecutor const &) = delete;
+  ThreadPoolExecutor(ThreadPoolExecutor &&) = delete;
+  ThreadPoolExecutor &operator=(ThreadPoolExecutor const &) = delete;
+  ThreadPoolExecutor &operator=(ThreadPoolExecutor &&) = delete;
+
+  bool enqueue(Queue &queue, Task &task);
+
   static void processTasks(std::shared_ptr<SharedState> sharedState);
 
+  static void rebuildWheel(SharedState &state, Priority priority);
+
+  static bool retireThread(SharedState &state, int threadLimit);
+
+  static void startThreadIfNeeded(std::shared_ptr<SharedState> const &state,
+      std::size_t queuedTasks);
+
+  static bool takeTask(SharedState &state, Task &task);
+
+  static void validateWeight(int weight);
+
+  static void validateConfiguration(Configuration const &configuration);
+
+  static void wakeUpBlockedSubmitter(SharedState &state);
+
 };
 
-template<class Function, class... Args>
-std::future<
-  typename std::result_of<
-    typename std::decay<Function>::type(typename std::decay<Args>::type...)
-  >::type
-> ThreadPoolExecutor::submit(Function &&f, Args &&... args) {
-  // We have to use a shared_ptr because packaged_task is not copyable, so the
-  // lambda expression below could not be put inside the pendingTasks list if
-  // we used packaged_task directly.
-  auto task = std::make_shared<std::packaged_task<decltype(f(args...))()>>(
-    std::bind(std::forward<Function>(f), std::forward<Args>(args)...)
-  );
-  auto future = task->get_future();
-  auto runFunc = [task]() {(*task)();};
-  {
-    std::lock_guard<std::mutex> lock(this->sharedState->mutex);
-    this->sharedState->pendingTasks.push_back(runFunc);
-    if (this->sharedState->idleThreads) {
-      // We decrement idleThreads here instead of in the thread that is woken
-      // up. If we did it the other way round, this method might run again
-      // before the woken-up thread acquires the mutex and we might thus not
-      // create a new thread when we actually have to. By decrementing the
-      // counter here, we can avoid this situation, because decrementing the
-      // counter and waking up a thread happens as an atomic action without
-      // releasing the lock on the mutex in between.
-      --this->sharedState->idleThreads;
-      this->sharedState->wakeUpCv.notify_one();
-    } else {
-      // We create the thread and detach it right away. The thread does not
-      // reference this object, only the shared state, and the latter is
-      // referenced through a shared_ptr, so it will stay alive as long as
-      // there is a thread.
-      std::thread(
-        &ThreadPoolExecutor::processTasks, this->sharedState
-      ).detach();
-    }
+template<typename Function>
+void ThreadPoolExecutor::submit(Queue &queue, Function &&function) {
+  Task task(std::forward<Function>(function));
+  if (!enqueue(queue, task)) {
+    // The rejection policy tells us to run the task in this thread.
+    task();
   }
-  return future;
 }
 
 /**
  * Provides a shared executor instance.
  *
- * The returned instance keeps up to four idle threads.
+ * By default, the returned instance keeps up to four idle threads, uses at
+ * most 16 threads, and queues up to 1024 tasks. Tasks exceeding this limit
+ * are run in the submitting thread. The configuration can be changed through
+ * the executeConfigureThreadPool iocsh command.
  */
 ThreadPoolExecutor &sharedThreadPoolExecutor();
 
@@ -0,0 +1,421 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+/*
+ * Benchmark for running commands, independent of an IOC.
+ *
+ * This program measures the rate and latency of runs of the Command class
+ * for different workloads: running /bin/true, capturing 1 MB of standard
+ * output, supplying 8 MB of standard input, and running 100 commands
+ * concurrently (submitted through the shared thread pool, like the run
+ * records do). Each workload is measured with each spawn method, first
+ * without any special conditions, then with RLIMIT_NOFILE raised to its hard
+ * limit, and finally with a large resident set size of this process.
+ *
+ * The results are written to the standard output in JSON format, so that they
+ * can be compared between releases. Progress is reported on the standard error
+ * output. The program is not built by default (see the Makefile).
+ *
+ * Usage: commandBenchmark [<runs per workload> [<simulated RSS in MB>]]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <sys/resource.h>
+}
+
+#include "Command.h"
+#include "SpawnMethod.h"
+#include "ThreadPoolExecutor.h"
+
+using namespace epics::execute;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * Number of commands that run concurrently in the concurrent workload.
+ */
+constexpr int concurrentCommands = 100;
+
+/**
+ * Size of the output that is captured in the stdout workload.
+ */
+constexpr std::size_t stdoutSize = 1024 * 1024;
+
+/**
+ * Size of the input that is supplied in the stdin workload.
+ */
+constexpr std::size_t stdinSize = 8 * 1024 * 1024;
+
+/**
+ * Length of each line (including the newline character) of the input that is
+ * supplied in the stdin workload.
+ */
+constexpr std::size_t stdinLineLength = 64;
+
+enum class Workload {
+  trueProgram,
+  stdoutCapture,
+  stdinSupply,
+  concurrent,
+};
+
+struct Measurement {
+  std::string scenario;
+  SpawnMethod spawnMethod;
+  Workload workload;
+  std::size_t failures;
+  std::vector<std::int64_t> latencies;
+  double seconds;
+};
+
+char const *spawnMethodName(SpawnMethod method) {
+  switch (method) {
+  case SpawnMethod::vfork:
+    return "vfork";
+  case SpawnMethod::posixSpawn:
+    return "posix_spawn";
+  case SpawnMethod::fork:
+  default:
+    return "fork";
+  }
+}
+
+char const *workloadName(Workload workload) {
+  switch (workload) {
+  case Workload::stdoutCapture:
+    return "stdout_1mb";
+  case Workload::stdinSupply:
+    return "stdin_8mb";
+  case Workload::concurrent:
+    return "concurrent_100";
+  case Workload::trueProgram:
+  default:
+    return "true";
+  }
+}
+
+/**
+ * Commands used by the workloads. Each command creates a queue in the shared
+ * thread pool, and these queues are never removed, so we create the commands
+ * once and only change their spawn method for each measurement.
+ */
+struct Commands {
+  std::unique_ptr<Command> trueProgram;
+  std::unique_ptr<Command> stdoutCapture;
+  std::unique_ptr<Command> stdinSupply;
+  std::vector<std::unique_ptr<Command>> concurrent;
+};
+
+std::unique_ptr<Command> createCommand(Workload workload) {
+  std::unique_ptr<Command> command;
+  switch (workload) {
+  case Workload::stdoutCapture:
+    command.reset(new Command("/bin/sh", true, "stdout"));
+    command->setArgument(1, "-c");
+    command->setArgument(2,
+        "exec head -c " + std::to_string(stdoutSize) + " /dev/zero");
+    command->ensureStdOutCapacity(stdoutSize);
+    break;
+  case Workload::stdinSupply:
+    command.reset(new Command("/bin/sh", true, "stdin"));
+    command->setArgument(1, "-c");
+    // We count lines instead of bytes, because "wc -c" might only look at
+    // the size of the file instead of reading the data.
+    command->setArgument(2, "exec wc -l");
+    command->ensureStdOutCapacity(64);
+    {
+      std::vector<char> input(stdinSize, 'x');
+      for (std::size_t i = stdinLineLength - 1; i < stdinSize;
+          i += stdinLineLength) {
+        input[i] = '\n';
+      }
+      command->setStdInBuffer(input);
+    }
+    break;
+  case Workload::concurrent:
+    command.reset(new Command("/bin/true", true, "concurrent"));
+    break;
+  case Workload::trueProgram:
+  default:
+    command.reset(new Command("/bin/true", true, "true"));
+    break;
+  }
+  return command;
+}
+
+/**
+ * Tells whether the result of the last run of the command is the expected
+ * one for the workload.
+ */
+bool checkResult(Command const &command, Workload workload) {
+  auto result = command.getResult();
+  if (result->exitCode != 0) {
+    return false;
+  }
+  switch (workload) {
+  case Workload::stdoutCapture:
+    return result->getStdOutSize() == stdoutSize;
+  case Workload::stdinSupply:
+    {
+      auto output = command.getStdOutBuffer();
+      output.push_back(0);
+      return std::strtoull(output.data(), nullptr, 10)
+          == stdinSize / stdinLineLength;
+    }
+  default:
+    return true;
+  }
+}
+
+/**
+ * Runs a command sequentially and records the duration of each run.
+ */
+void runSequential(Measurement &measurement, Command &command, int runs) {
+  command.setSpawnMethod(measurement.spawnMethod);
+  auto startTime = Clock::now();
+  for (int i = 0; i < runs; ++i) {
+    auto runStartTime = Clock::now();
+    try {
+      command.run();
+      if (!checkResult(command, measurement.workload)) {
+        ++measurement.failures;
+      }
+    } catch (...) {
+      ++measurement.failures;
+    }
+    measurement.latencies.push_back(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - runStartTime).count());
+  }
+  measurement.seconds = std::chrono::duration<double>(
+      Clock::now() - startTime).count();
+}
+
+/**
+ * Starts a run of each of the commands at the same time (through the shared
+ * thread pool) and waits until all of them have completed. This is repeated
+ * for the specified number of rounds. The latency of a run is the time from
+ * submitting it to the thread pool until its completion handler is called.
+ */
+void runConcurrent(Measurement &measurement,
+    std::vector<std::unique_ptr<Command>> const &commands, int rounds) {
+  for (auto &command : commands) {
+    command->setSpawnMethod(measurement.spawnMethod);
+  }
+  std::mutex mutex;
+  std::condition_variable completedCv;
+  auto startTime = Clock::now();
+  for (int round = 0; round < rounds; ++round) {
+    std::vector<std::int64_t> latencies(commands.size());
+    std::size_t completed = 0;
+    std::size_t failures = 0;
+    for (std::size_t i = 0; i < commands.size(); ++i) {
+      auto command = commands[i].get();
+      auto latency = &latencies[i];
+      auto submitTime = Clock::now();
+      auto completionHandler = [&, latency, submitTime](
+          std::exception_ptr error, std::shared_ptr<Command::Result const>) {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        *latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            now - submitTime).count();
+        if (error) {
+          ++failures;
+        }
+        if (++completed == commands.size()) {
+          completedCv.notify_all();
+        }
+      };
+      sharedThreadPoolExecutor().submit(command->getExecutorQueue(),
+          [command, completionHandler]() {
+        try {
+          command->runAsync(completionHandler);
+        } catch (...) {
+          completionHandler(std::current_exception(),
+              std::shared_ptr<Command::Result const>());
+        }
+      });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    completedCv.wait(lock, [&]() { return completed == commands.size(); });
+    measurement.failures += failures;
+    measurement.latencies.insert(measurement.latencies.end(),
+        latencies.begin(), latencies.end());
+  }
+  measurement.seconds = std::chrono::duration<double>(
+      Clock::now() - startTime).count();
+}
+
+void runScenario(std::string const &scenario, Commands const &commands,
+    int runs, std::vector<Measurement> &measurements) {
+  for (auto spawnMethod : {SpawnMethod::fork, SpawnMethod::vfork,
+      SpawnMethod::posixSpawn}) {
+    for (auto workload : {Workload::trueProgram, Workload::stdoutCapture,
+        Workload::stdinSupply, Workload::concurrent}) {
+      Measurement measurement;
+      measurement.scenario = scenario;
+      measurement.spawnMethod = spawnMethod;
+      measurement.workload = workload;
+      measurement.failures = 0;
+      switch (workload) {
+      // Moving the data takes much longer than creating the process, so we
+      // use fewer runs for these workloads.
+      case Workload::stdoutCapture:
+        runSequential(measurement, *commands.stdoutCapture,
+            std::max(runs / 10, 10));
+        break;
+      case Workload::stdinSupply:
+        runSequential(measurement, *commands.stdinSupply,
+            std::max(runs / 10, 10));
+        break;
+      case Workload::concurrent:
+        runConcurrent(measurement, commands.concurrent,
+            std::max(runs / 20, 1));
+        break;
+      case Workload::trueProgram:
+      default:
+        runSequential(measurement, *commands.trueProgram, runs);
+        break;
+      }
+      std::sort(measurement.latencies.begin(), measurement.latencies.end());
+      std::fprintf(stderr, "%-12s %-12s %-15s %10.1f runs/s, p99 %10.1f us\n",
+          scenario.c_str(), spawnMethodName(spawnMethod),
+          workloadName(workload),
+          measurement.latencies.size() / measurement.seconds,
+          measurement.latencies[measurement.latencies.size() * 99 / 100]
+            / 1000.0);
+      measurements.push_back(std::move(measurement));
+    }
+  }
+}
+
+void printMeasurement(Measurement const &measurement, bool last) {
+  auto &latencies = measurement.latencies;
+  auto runs = latencies.size();
+  double sum = 0.0;
+  for (auto latency : latencies) {
+    sum += latency;
+  }
+  auto percentile = [&latencies, runs](std::size_t percent) {
+    return latencies[std::min(runs * percent / 100, runs - 1)] / 1000.0;
+  };
+  std::printf("    {\"scenario\": \"%s\", \"spawn_method\": \"%s\", "
+      "\"workload\": \"%s\", \"runs\": %zu, \"failures\": %zu, "
+      "\"runs_per_second\": %.1f, \"latency_us\": {\"mean\": %.1f, "
+      "\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f}}%s\n",
+      measurement.scenario.c_str(),
+      spawnMethodName(measurement.spawnMethod),
+      workloadName(measurement.workload), runs, measurement.failures,
+      runs / measurement.seconds, sum / runs / 1000.0, percentile(50),
+      percentile(90), percentile(99), latencies.back() / 1000.0,
+      last ? "" : ",");
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv) {
+  int runs = 200;
+  long rssMegabytes = 1024;
+  if (argc > 1) {
+    runs = std::atoi(argv[1]);
+  }
+  if (argc > 2) {
+    rssMegabytes = std::atol(argv[2]);
+  }
+  if (runs < 1 || rssMegabytes < 0 || argc > 3) {
+    std::fprintf(stderr,
+        "Usage: %s [<runs per workload> [<simulated RSS in MB>]]\n", argv[0]);
+    return 1;
+  }
+  std::vector<Measurement> measurements;
+  ::rlimit originalNoFileLimit;
+  if (::getrlimit(RLIMIT_NOFILE, &originalNoFileLimit)) {
+    std::perror("getrlimit(RLIMIT_NOFILE) failed");
+    return 1;
+  }
+  Commands commands;
+  commands.trueProgram = createCommand(Workload::trueProgram);
+  commands.stdoutCapture = createCommand(Workload::stdoutCapture);
+  commands.stdinSupply = createCommand(Workload::stdinSupply);
+  for (int i = 0; i < concurrentCommands; ++i) {
+    commands.concurrent.push_back(createCommand(Workload::concurrent));
+  }
+  runScenario("baseline", commands, runs, measurements);
+  // A high limit for the number of file descriptors makes the child process
+  // spend more time on closing file descriptors before executing the program,
+  // unless it can use close_range(). If the hard limit is unlimited, we use
+  // the highest value that Linux accepts by default.
+  auto highNoFileLimit = originalNoFileLimit;
+  highNoFileLimit.rlim_cur = originalNoFileLimit.rlim_max == RLIM_INFINITY
+      ? 1048576 : originalNoFileLimit.rlim_max;
+  if (::setrlimit(RLIMIT_NOFILE, &highNoFileLimit)) {
+    std::perror("setrlimit(RLIMIT_NOFILE) failed");
+    highNoFileLimit = originalNoFileLimit;
+  }
+  runScenario("high_nofile", commands, runs, measurements);
+  ::setrlimit(RLIMIT_NOFILE, &originalNoFileLimit);
+  // A large resident set size makes fork() slower, because the page tables
+  // have to be copied. We touch every page, so that it is actually mapped.
+  std::unique_ptr<char[]> ballast(new char[rssMegabytes * 1024 * 1024]);
+  std::memset(ballast.get(), 1, rssMegabytes * 1024 * 1024);
+  runScenario("large_rss", commands, runs, measurements);
+  ballast.reset();
+  std::size_t failures = 0;
+  std::printf("{\n  \"benchmark\": \"commandBenchmark\",\n"
+      "  \"runs_per_workload\": %d,\n"
+      "  \"scenarios\": {\"baseline\": {\"nofile\": %llu, \"rss_mb\": 0}, "
+      "\"high_nofile\": {\"nofile\": %llu, \"rss_mb\": 0}, "
+      "\"large_rss\": {\"nofile\": %llu, \"rss_mb\": %ld}},\n"
+      "  \"results\": [\n", runs,
+      static_cast<unsigned long long>(originalNoFileLimit.rlim_cur),
+      static_cast<unsigned long long>(highNoFileLimit.rlim_cur),
+      static_cast<unsigned long long>(originalNoFileLimit.rlim_cur),
+      rssMegabytes);
+  for (std::size_t i = 0; i < measurements.size(); ++i) {
+    printMeasurement(measurements[i], i + 1 == measurements.size());
+    failures += measurements[i].failures;
+  }
+  std::printf("  ]\n}\n");
+  // If a run failed, the results are not meaningful, so we signal this
+  // through the exit code.
+  return failures ? 2 : 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+extern "C" {
+#include <dbAccess.h>
+#include <epicsExport.h>
+#include <iocsh.h>
+} // extern "C"
+
+#include "CommandRegistry.h"
+#include "errorPrint.h"
+
+using namespace epics::execute;
+
+namespace {
+
+/**
+ * Appends a macro definition to a list of macro substitutions that is passed
+ * to dbLoadRecords.
+ */
+void appendMacro(std::string &macros, char const *name,
+    std::string const &value) {
+  if (!macros.empty()) {
+    macros += ",";
+  }
+  macros += name;
+  macros += "=";
+  macros += value;
+}
+
+/**
+ * Loads the records for one command of the load test. Throws a
+ * std::runtime_error if dbLoadRecords reports an error.
+ */
+void loadRecords(char const *templateFile, std::string const &macros) {
+  if (::dbLoadRecords(templateFile, macros.c_str())) {
+    throw std::runtime_error(
+        std::string("Could not load ") + templateFile + " with macros \""
+        + macros + "\".");
+  }
+}
+
+} // anonymous namespace
+
+extern "C" {
+
+// Data structures needed for the iocsh executeLoadTestCreate function.
+static const iocshArg iocshExecuteLoadTestCreateArg0 = { "prefix",
+    iocshArgString };
+static const iocshArg iocshExecuteLoadTestCreateArg1 = { "number of commands",
+    iocshArgInt };
+static const iocshArg iocshExecuteLoadTestCreateArg2 = {
+    "number of parameters", iocshArgInt };
+static const iocshArg iocshExecuteLoadTestCreateArg3 = { "scan period",
+    iocshArgString };
+static const iocshArg iocshExecuteLoadTestCreateArg4 = { "command path",
+    iocshArgString };
+static const iocshArg iocshExecuteLoadTestCreateArg5 = { "macros",
+    iocshArgString };
+static const iocshArg * const iocshExecuteLoadTestCreateArgs[] = {
+    &iocshExecuteLoadTestCreateArg0, &iocshExecuteLoadTestCreateArg1,
+    &iocshExecuteLoadTestCreateArg2, &iocshExecuteLoadTestCreateArg3,
+    &iocshExecuteLoadTestCreateArg4, &iocshExecuteLoadTestCreateArg5};
+static const iocshFuncDef iocshExecuteLoadTestCreateFuncDef = {
+    "executeLoadTestCreate", 6, iocshExecuteLoadTestCreateArgs };
+
+static void iocshExecuteLoadTestCreateFunc(const iocshArgBuf *args) noexcept {
+  char *prefixCStr = args[0].sval;
+  int numberOfCommands = args[1].ival;
+  int numberOfParameters = args[2].ival;
+  char *scanCStr = args[3].sval;
+  char *commandPathCStr = args[4].sval;
+  char *macrosCStr = args[5].sval;
+  // Verify that the required parameters are set.
+  if (!prefixCStr || !std::strlen(prefixCStr)) {
+    errorPrintf(
+        "Could not create the load test: Prefix must be specified.");
+    return;
+  }
+  if (numberOfCommands < 1) {
+    errorPrintf(
+        "Could not create the load test: Number of commands must be "
+        "positive.");
+    return;
+  }
+  if (numberOfParameters < 0) {
+    errorPrintf(
+        "Could not create the load test: Number of parameters must not be "
+        "negative.");
+    return;
+  }
+  if (!scanCStr || !std::strlen(scanCStr)) {
+    errorPrintf(
+        "Could not create the load test: Scan period must be specified.");
+    return;
+  }
+  if (!commandPathCStr || !std::strlen(commandPathCStr)) {
+    errorPrintf(
+        "Could not create the load test: Command path must be specified.");
+    return;
+  }
+  auto prefix = std::string(prefixCStr);
+  try {
+    // The substitution files understood by dbLoadRecords cannot express
+    // loops, so we create the commands and load the records for each of them
+    // here. The templates are expected in the db directory below the current
+    // working directory, which is the case when the startup script has
+    // changed to ${TOP}.
+    for (int i = 1; i <= numberOfCommands; ++i) {
+      auto commandId = "loadTest" + std::to_string(i);
+      auto recordPrefix = "Cmd" + std::to_string(i) + ":";
+      CommandRegistry::getInstance().createCommand(commandId, commandPathCStr,
+          true);
+      std::string macros;
+      appendMacro(macros, "P", prefix);
+      appendMacro(macros, "R", recordPrefix);
+      appendMacro(macros, "CMD", commandId);
+      appendMacro(macros, "SCAN", scanCStr);
+      // Additional macros (e.g. for the histogram) are passed through to
+      // the template for the command.
+      if (macrosCStr && std::strlen(macrosCStr)) {
+        macros += ",";
+        macros += macrosCStr;
+      }
+      loadRecords("db/executeLoadTestChannel.template", macros);
+      for (int j = 1; j <= numberOfParameters; ++j) {
+        macros.clear();
+        appendMacro(macros, "P", prefix);
+        appendMacro(macros, "R", recordPrefix);
+        appendMacro(macros, "CMD", commandId);
+        appendMacro(macros, "ARG", std::to_string(j));
+        loadRecords("db/executeLoadTestParameter.template", macros);
+      }
+    }
+  } catch (std::exception &e) {
+    errorPrintf(
+        "Could not create the load test: %s", e.what());
+  } catch (...) {
+    errorPrintf(
+        "Could not create the load test: Unknown error.");
+  }
+}
+
+/**
+ * Registrar that registers the iocsh commands of the load-test IOC.
+ */
+static void executeLoadTestRegistrar() {
+  ::iocshRegister(&iocshExecuteLoadTestCreateFuncDef,
+      iocshExecuteLoadTestCreateFunc);
+}
+
+epicsExportRegistrar(executeLoadTestRegistrar);
+
+} // extern "C"
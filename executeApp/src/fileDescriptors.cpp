@@ -0,0 +1,192 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#include <cstdint>
+#include <system_error>
+
+extern "C" {
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif // __linux__
+}
+
+#include "fileDescriptors.h"
+
+namespace epics {
+namespace execute {
+
+namespace {
+
+#ifdef __linux__
+
+#ifndef CLOSE_RANGE_CLOEXEC
+#define CLOSE_RANGE_CLOEXEC (1U << 2)
+#endif // CLOSE_RANGE_CLOEXEC
+
+/**
+ * Directory entry as returned by the getdents64 system call. glibc does not
+ * provide a definition for this structure.
+ */
+struct LinuxDirent64 {
+  std::uint64_t d_ino;
+  std::int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[1];
+};
+
+/**
+ * Calls close_range() for [lowFd, highFd] and returns true on success. If the
+ * kernel does not support close_range() or does not support the specified
+ * flags, false is returned.
+ */
+bool closeRange(unsigned int lowFd, unsigned int highFd, unsigned int flags) {
+#ifdef SYS_close_range
+  return ::syscall(SYS_close_range, lowFd, highFd, flags) == 0;
+#else
+  (void) lowFd;
+  (void) highFd;
+  (void) flags;
+  return false;
+#endif // SYS_close_range
+}
+
+/**
+ * Closes the file descriptors by enumerating /proc/self/fd. We use the
+ * getdents64 system call directly instead of opendir() and readdir(), because
+ * the latter allocate memory and thus are not async-signal-safe. Returns false
+ * if /proc/self/fd cannot be opened.
+ */
+bool closeFileDescriptorsFromProc(int lowFd, int exceptFd) {
+  int dirFd = ::open("/proc/self/fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dirFd == -1) {
+    return false;
+  }
+  alignas(LinuxDirent64) char buffer[4096];
+  long bytesRead;
+  // The entries of /proc/self/fd are generated in the order of the file
+  // descriptor numbers, so closing file descriptors while enumerating them
+  // does not cause entries to be skipped.
+  while ((bytesRead = ::syscall(SYS_getdents64, dirFd, buffer,
+      sizeof(buffer))) > 0) {
+    long offset = 0;
+    while (offset < bytesRead) {
+      auto entry = reinterpret_cast<LinuxDirent64 *>(buffer + offset);
+      offset += entry->d_reclen;
+      // We parse the number ourselves, because strtol is not guaranteed to be
+      // async-signal-safe. The "." and ".." entries are skipped because they
+      // do not start with a digit.
+      char const *c = entry->d_name;
+      if (*c < '0' || *c > '9') {
+        continue;
+      }
+      int fd = 0;
+      for (; *c >= '0' && *c <= '9'; ++c) {
+        fd = fd * 10 + (*c - '0');
+      }
+      if (fd >= lowFd && fd != exceptFd && fd != dirFd) {
+        ::close(fd);
+      }
+    }
+  }
+  ::close(dirFd);
+  return true;
+}
+
+#endif // __linux__
+
+} // anonymous namespace
+
+void closeFileDescriptors(int lowFd, int exceptFd, int maxFd,
+    bool closeOnExec) noexcept {
+#ifdef __linux__
+  // close_range() is available since Linux 5.9 and the CLOSE_RANGE_CLOEXEC
+  // flag since Linux 5.11. When an exception FD is specified, we have to use
+  // two ranges.
+  unsigned int flagsToTry[2] = {closeOnExec ? CLOSE_RANGE_CLOEXEC : 0U, 0U};
+  for (auto flags : flagsToTry) {
+    bool success;
+    if (exceptFd < lowFd) {
+      success = closeRange(lowFd, ~0U, flags);
+    } else {
+      success = (exceptFd == lowFd || closeRange(lowFd, exceptFd - 1, flags))
+          && closeRange(exceptFd + 1, ~0U, flags);
+    }
+    if (success) {
+      return;
+    }
+  }
+  if (closeFileDescriptorsFromProc(lowFd, exceptFd)) {
+    return;
+  }
+#else
+  (void) closeOnExec;
+#endif // __linux__
+  // There is no platform-independent way for finding the open file
+  // descriptors, so we have to try all of them.
+  for (int fd = lowFd; fd <= maxFd; ++fd) {
+    if (fd != exceptFd) {
+      ::close(fd);
+    }
+  }
+}
+
+void createPipe(int fds[2]) {
+#ifdef __linux__
+  if (::pipe2(fds, O_CLOEXEC)) {
+    throw std::system_error(std::error_code(errno, std::system_category()),
+        "pipe2() failed");
+  }
+#else
+  if (::pipe(fds)) {
+    throw std::system_error(std::error_code(errno, std::system_category()),
+        "pipe() failed");
+  }
+  // On platforms that do not have pipe2(), there is a short period of time
+  // in which the file descriptors do not have the close-on-exec flag set.
+  // Child processes created by this library close all file descriptors
+  // anyway, so this is not a problem for them.
+  ::fcntl(fds[0], F_SETFD, ::fcntl(fds[0], F_GETFD) | FD_CLOEXEC);
+  ::fcntl(fds[1], F_SETFD, ::fcntl(fds[1], F_GETFD) | FD_CLOEXEC);
+#endif // __linux__
+}
+
+void setNonBlocking(int fd) {
+  int flags = ::fcntl(fd, F_GETFL);
+  if (flags == -1 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+    throw std::system_error(std::error_code(errno, std::system_category()),
+        "fcntl() failed");
+  }
+}
+
+} // namespace execute
+} // namespace epics
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_FILE_DESCRIPTORS_H
+#define EPICS_EXEC_FILE_DESCRIPTORS_H
+
+namespace epics {
+namespace execute {
+
+/**
+ * Closes all file descriptors that are greater than or equal to lowFd, except
+ * for exceptFd (if not -1).
+ *
+ * On Linux, this uses close_range() if the kernel supports it and falls back
+ * to enumerating /proc/self/fd otherwise. Only if neither of these mechanisms
+ * is available, all file descriptors up to maxFd are closed one by one. If
+ * closeOnExec is true, the file descriptors might only be marked with the
+ * close-on-exec flag instead of being closed right away. This is sufficient
+ * (and faster) when the calling code is going to call execve().
+ *
+ * This function is async-signal-safe, so it can be used in a child process
+ * before calling execve().
+ */
+void closeFileDescriptors(int lowFd, int exceptFd, int maxFd,
+    bool closeOnExec) noexcept;
+
+/**
+ * Creates a pipe. Both file descriptors have the close-on-exec flag set. Where
+ * supported, the flag is set atomically when creating the pipe, so that the
+ * file descriptors cannot leak into child processes created concurrently by
+ * other threads.
+ *
+ * @throws std::system_error if the pipe cannot be created.
+ */
+void createPipe(int fds[2]);
+
+/**
+ * Sets the O_NONBLOCK flag on a file descriptor. For pipes, the flag only
+ * affects the end of the pipe that is referenced by the file descriptor, so
+ * the other end can be passed to a child process that expects blocking I/O.
+ *
+ * @throws std::system_error if the flag cannot be set.
+ */
+void setNonBlocking(int fd);
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_FILE_DESCRIPTORS_H
@@ -1,6 +1,6 @@
 /*
- * Copyright 2018-2021 aquenos GmbH.
- * Copyright 2018-2021 Karlsruhe Institute of Technology.
+ * Copyright 2018-2026 aquenos GmbH.
+ * Copyright 2018-2026 Karlsruhe Institute of Technology.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as
@@ -32,6 +32,7 @@
 
 #include <aaiRecord.h>
 #include <aaoRecord.h>
+#include <aiRecord.h>
 #include <aoRecord.h>
 #include <biRecord.h>
 #include <boRecord.h>
@@ -57,12 +58,15 @@
 #endif
 
 #include "AaiDeviceSupport.h"
+#include "AaiStatsDeviceSupport.h"
 #include "AaoOutputParameterDeviceSupport.h"
 #include "AaoStdInDeviceSupport.h"
+#include "DaemonDeviceSupport.h"
 #include "ExitCodeDeviceSupport.h"
 #include "OutputParameterDeviceSupport.h"
 #include "RecordAddress.h"
 #include "RunDeviceSupport.h"
+#include "StatsDeviceSupport.h"
 #include "StringinDeviceSupport.h"
 #include "StringoutStdInDeviceSupport.h"
 #include "errorPrint.h"
@@ -79,6 +83,25 @@ using namespace epics::execute;
 
 namespace {
 
+/**
+ * Factory for creating the device support for an aai record. Depending on the
+ * type specified in the record's address, this factory creates an
+ * AaiDeviceSupport or an AaiStatsDeviceSupport.
+ */
+struct AaiDeviceSupportFactory {
+  static BaseDeviceSupport<::aaiRecord> *createDeviceSupport(
+      ::aaiRecord *record) {
+    auto address = RecordAddress::parse(record->inp,
+        RecordAddress::Type::standardError
+        | RecordAddress::Type::standardOutput | RecordAddress::Type::stats);
+    if (address.getType() == RecordAddress::Type::stats) {
+      return new AaiStatsDeviceSupport(record, address);
+    } else {
+      return new AaiDeviceSupport(record, address);
+    }
+  }
+};
+
 /**
  * Factory for creating the device support for an aao record. Depending on the
  * type specified in the record's address, this factory creates an
@@ -118,14 +141,42 @@ struct BoDeviceSupportFactory {
 };
 
 /**
- * Factory for creating the ExitCodeDeviceSupport.
+ * Factory for creating the device support for an integer input record.
+ * Depending on the type specified in the record's address, this factory
+ * creates an ExitCodeDeviceSupport or a DaemonDeviceSupport.
  */
 template<typename RecordType, RecordValFieldName ValFieldName>
-struct ExitCodeDeviceSupportFactory {
+struct IntegerInputDeviceSupportFactory {
   static BaseDeviceSupport<RecordType> *createDeviceSupport(
       RecordType *record) {
-    auto address = RecordAddress::parse(record->inp, RecordAddress::Type::exitCode);
-    return new ExitCodeDeviceSupport<RecordType, ValFieldName>(record, address);
+    auto address = RecordAddress::parse(record->inp,
+        RecordAddress::Type::daemon | RecordAddress::Type::exitCode);
+    if (address.getType() == RecordAddress::Type::daemon) {
+      return new DaemonDeviceSupport<RecordType, ValFieldName>(record, address);
+    } else {
+      return new ExitCodeDeviceSupport<RecordType, ValFieldName>(record,
+          address);
+    }
+  }
+};
+
+/**
+ * Factory for creating the device support for a longin record. Depending on
+ * the type specified in the record's address, this factory creates an
+ * ExitCodeDeviceSupport, a DaemonDeviceSupport, or a StatsDeviceSupport.
+ */
+struct LonginDeviceSupportFactory {
+  static BaseDeviceSupport<::longinRecord> *createDeviceSupport(
+      ::longinRecord *record) {
+    auto address = RecordAddress::parse(record->inp,
+        RecordAddress::Type::daemon | RecordAddress::Type::exitCode
+        | RecordAddress::Type::stats);
+    if (address.getType() == RecordAddress::Type::stats) {
+      return new StatsDeviceSupport<::longinRecord>(record, address);
+    } else {
+      return IntegerInputDeviceSupportFactory<::longinRecord,
+          RecordValFieldName::val>::createDeviceSupport(record);
+    }
   }
 };
 
@@ -180,6 +231,19 @@ struct OutputParameterDeviceSupportFactory {
   }
 };
 
+/**
+ * Factory for creating the StatsDeviceSupport.
+ */
+template<typename RecordType>
+struct StatsDeviceSupportFactory {
+  static BaseDeviceSupport<RecordType> *createDeviceSupport(
+      RecordType *record) {
+    auto address = RecordAddress::parse(record->inp,
+        RecordAddress::Type::stats);
+    return new StatsDeviceSupport<RecordType>(record, address);
+  }
+};
+
 /**
  * Factory for creating the device support for a stringout record. Depending on
  * the type specified in the record's address, this factory creates an
@@ -219,7 +283,7 @@ auto constexpr rvalField = RecordValFieldName::rval;
  */
 template<>
 struct DeviceSupportFactories<::aaiRecord> {
-  using Factory = OutputDeviceSupportFactory<::aaiRecord, AaiDeviceSupport>;
+  using Factory = AaiDeviceSupportFactory;
 };
 
 /**
@@ -230,6 +294,14 @@ struct DeviceSupportFactories<::aaoRecord> {
   using Factory = AaoDeviceSupportFactory;
 };
 
+/**
+ * Template specialzation for the ai record.
+ */
+template<>
+struct DeviceSupportFactories<::aiRecord> {
+  using Factory = StatsDeviceSupportFactory<::aiRecord>;
+};
+
 /**
  * Template specialzation for the ao record.
  */
@@ -243,7 +315,7 @@ struct DeviceSupportFactories<::aoRecord> {
  */
 template<>
 struct DeviceSupportFactories<::biRecord> {
-  using Factory = ExitCodeDeviceSupportFactory<::biRecord, rvalField>;
+  using Factory = IntegerInputDeviceSupportFactory<::biRecord, rvalField>;
 };
 
 /**
@@ -259,7 +331,7 @@ struct DeviceSupportFactories<::boRecord> {
  */
 template<>
 struct DeviceSupportFactories<::longinRecord> {
-  using Factory = ExitCodeDeviceSupportFactory<::longinRecord, valField>;
+  using Factory = LonginDeviceSupportFactory;
 };
 
 /**
@@ -294,7 +366,7 @@ struct DeviceSupportFactories<::lsoRecord> {
  */
 template<>
 struct DeviceSupportFactories<::mbbiRecord> {
-  using Factory = ExitCodeDeviceSupportFactory<::mbbiRecord, rvalField>;
+  using Factory = IntegerInputDeviceSupportFactory<::mbbiRecord, rvalField>;
 };
 
 /**
@@ -302,7 +374,8 @@ struct DeviceSupportFactories<::mbbiRecord> {
  */
 template<>
 struct DeviceSupportFactories<::mbbiDirectRecord> {
-  using Factory = ExitCodeDeviceSupportFactory<::mbbiDirectRecord, rvalField>;
+  using Factory =
+      IntegerInputDeviceSupportFactory<::mbbiDirectRecord, rvalField>;
 };
 
 /**
@@ -411,6 +484,38 @@ long processRecord(void *recordVoid) noexcept {
   }
 }
 
+/**
+ * Provides the I/O scan list for records that use I/O Intr scanning. Only
+ * device supports that override BaseDeviceSupport::getIoScanPvt support this
+ * kind of scanning.
+ */
+template<typename RecordType>
+long getIoIntInfo(int, ::dbCommon *recordCommon, ::IOSCANPVT *ioScanPvt)
+    noexcept {
+  if (!recordCommon) {
+    errorExtendedPrintf(
+        "I/O Intr registration failed: Pointer to record structure is null.");
+    return -1;
+  }
+  auto record = reinterpret_cast<RecordType *>(recordCommon);
+  auto deviceSupport =
+      static_cast<BaseDeviceSupport<RecordType> *>(record->dpvt);
+  if (!deviceSupport) {
+    errorExtendedPrintf(
+        "%s I/O Intr registration failed: Record has not been initialized.",
+        record->name);
+    return -1;
+  }
+  *ioScanPvt = deviceSupport->getIoScanPvt();
+  if (!*ioScanPvt) {
+    errorExtendedPrintf(
+        "%s I/O Intr registration failed: Not supported for this address.",
+        record->name);
+    return -1;
+  }
+  return 0;
+}
+
 /**
  * Type alias for the get_ioint_info functions. These functions have a slightly
  * different signature than the other functions, even though the definition in
@@ -434,8 +539,8 @@ typedef struct {
 
 template<typename RecordType>
 constexpr DeviceSupportStruct deviceSupportStruct() {
-  return {5, nullptr, nullptr, initRecord<RecordType>, nullptr,
-      processRecord<RecordType>};
+  return {5, nullptr, nullptr, initRecord<RecordType>,
+      getIoIntInfo<RecordType>, processRecord<RecordType>};
 }
 
 } // anonymous namespace
@@ -454,6 +559,23 @@ epicsExportAddress(dset, devAaiExecute);
 auto devAaoExecute = deviceSupportStruct<::aaoRecord>();
 epicsExportAddress(dset, devAaoExecute);
 
+/**
+ * ai record type. This record type expects an additional field
+ * (special_linconv) in the device support structure, so we cannot use the usual
+ * template function.
+ */
+struct {
+  long numberOfFunctionPointers;
+  DEVSUPFUN report;
+  DEVSUPFUN init;
+  DEVSUPFUN init_record;
+  DEVSUPFUN_GET_IOINT_INFO get_ioint_info;
+  DEVSUPFUN read;
+  DEVSUPFUN special_linconv;
+} devAiExecute = {6, nullptr, nullptr, initRecord<::aiRecord>,
+    getIoIntInfo<::aiRecord>, processRecord<::aiRecord, true>, nullptr};
+epicsExportAddress(dset, devAiExecute);
+
 /**
  * ao record type.  This record type expects an additional field
  * (special_linconv) in the device support structure, so we cannot use the usual
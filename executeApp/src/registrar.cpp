@@ -1,6 +1,6 @@
 /*
- * Copyright 2018 aquenos GmbH.
- * Copyright 2018 Karlsruhe Institute of Technology.
+ * Copyright 2018-2026 aquenos GmbH.
+ * Copyright 2018-2026 Karlsruhe Institute of Technology.
  *
  * This program is free software: you can redistribute it and/or modify
  * it under the terms of the GNU Lesser General Public License as
@@ -27,17 +27,27 @@
  * of the GNU LGPL version 3 or newer.
  */
 
+#include <chrono>
+#include <cmath>
 #include <cstring>
 #include <regex>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 extern "C" {
 #include <epicsExport.h>
+#include <epicsStdio.h>
+#include <initHooks.h>
 #include <iocsh.h>
 } // extern "C"
 
+#include "BaseEnvironment.h"
 #include "CommandRegistry.h"
+#include "ForkServer.h"
+#include "RunTrace.h"
+#include "Supervisor.h"
+#include "ThreadPoolExecutor.h"
 #include "errorPrint.h"
 
 using namespace epics::execute;
@@ -93,11 +103,796 @@ static void iocshExecuteAddCommandFunc(const iocshArgBuf *args) noexcept {
   }
 }
 
+// Data structures needed for the iocsh executeBufferPoolStatus function.
+static const iocshFuncDef iocshExecuteBufferPoolStatusFuncDef = {
+    "executeBufferPoolStatus", 0, nullptr };
+
+static void iocshExecuteBufferPoolStatusFunc(const iocshArgBuf *) noexcept {
+  std::size_t totalBytes = 0;
+  ::epicsStdoutPrintf("%-24s %8s %16s %16s\n", "Command", "Buffers",
+      "Pooled [bytes]", "Peak [bytes]");
+  try {
+    for (auto &entry : CommandRegistry::getInstance().getCommands()) {
+      auto statistics = entry.second->getBufferPoolStatistics();
+      ::epicsStdoutPrintf("%-24s %8zu %16zu %16zu\n", entry.first.c_str(),
+          statistics.buffers, statistics.bytes, statistics.peakBytes);
+      totalBytes += statistics.bytes;
+    }
+  } catch (std::exception &e) {
+    errorPrintf(
+        "Could not get the buffer pool status: %s", e.what());
+    return;
+  }
+  // The peaks of the individual pools might have happened at different
+  // times, so we only print the total of the memory that is pooled right now.
+  ::epicsStdoutPrintf("%-24s %8s %16zu\n", "(total)", "", totalBytes);
+}
+
+// Data structures needed for the iocsh executeConfigureLineStream function.
+static const iocshArg iocshExecuteConfigureLineStreamArg0 = { "command ID",
+    iocshArgString };
+static const iocshArg iocshExecuteConfigureLineStreamArg1 = {
+    "max. lines per update", iocshArgInt };
+static const iocshArg iocshExecuteConfigureLineStreamArg2 = {
+    "max. update delay", iocshArgInt };
+static const iocshArg iocshExecuteConfigureLineStreamArg3 = {
+    "max. buffered lines", iocshArgInt };
+static const iocshArg * const iocshExecuteConfigureLineStreamArgs[] = {
+    &iocshExecuteConfigureLineStreamArg0, &iocshExecuteConfigureLineStreamArg1,
+    &iocshExecuteConfigureLineStreamArg2, &iocshExecuteConfigureLineStreamArg3};
+static const iocshFuncDef iocshExecuteConfigureLineStreamFuncDef = {
+    "executeConfigureLineStream", 4, iocshExecuteConfigureLineStreamArgs };
+
+static void iocshExecuteConfigureLineStreamFunc(
+    const iocshArgBuf *args) noexcept {
+  char *commandIdCStr = args[0].sval;
+  int maxUpdateLines = args[1].ival;
+  int maxUpdateDelay = args[2].ival;
+  int maxBufferedLines = args[3].ival;
+  if (!commandIdCStr || !std::strlen(commandIdCStr)) {
+    errorPrintf(
+        "Could not configure the line stream: Command ID must be specified.");
+    return;
+  }
+  if (maxUpdateLines < 0 || maxUpdateDelay < 0) {
+    errorPrintf(
+        "Could not configure the line stream: The max. lines per update and the max. update delay must not be negative.");
+    return;
+  }
+  auto command = CommandRegistry::getInstance().getCommand(commandIdCStr);
+  if (!command) {
+    errorPrintf(
+        "Could not configure the line stream: Command \"%s\" is not defined.",
+        commandIdCStr);
+    return;
+  }
+  try {
+    auto lineStream = command->getStdOutLineStream();
+    auto options = lineStream->getOptions();
+    options.maxUpdateLines = maxUpdateLines;
+    options.maxUpdateDelay = std::chrono::milliseconds(maxUpdateDelay);
+    // If the number of buffered lines is not specified, we keep the current
+    // limit.
+    if (maxBufferedLines > 0) {
+      options.maxBufferedLines = maxBufferedLines;
+    }
+    lineStream->setOptions(options);
+  } catch (std::exception &e) {
+    errorPrintf(
+        "Could not configure the line stream: %s", e.what());
+  } catch (...) {
+    errorPrintf(
+        "Could not configure the line stream: Unknown error.");
+  }
+}
+
+// Data structures needed for the iocsh executeConfigureThreadPool function.
+static const iocshArg iocshExecuteConfigureThreadPoolArg0 = {
+    "min. threads", iocshArgInt };
+static const iocshArg iocshExecuteConfigureThreadPoolArg1 = {
+    "max. threads", iocshArgInt };
+static const iocshArg iocshExecuteConfigureThreadPoolArg2 = {
+    "max. queue size", iocshArgInt };
+static const iocshArg iocshExecuteConfigureThreadPoolArg3 = {
+    "rejection policy", iocshArgString };
+static const iocshArg iocshExecuteConfigureThreadPoolArg4 = {
+    "idle timeout", iocshArgDouble };
+static const iocshArg * const iocshExecuteConfigureThreadPoolArgs[] = {
+    &iocshExecuteConfigureThreadPoolArg0, &iocshExecuteConfigureThreadPoolArg1,
+    &iocshExecuteConfigureThreadPoolArg2, &iocshExecuteConfigureThreadPoolArg3,
+    &iocshExecuteConfigureThreadPoolArg4};
+static const iocshFuncDef iocshExecuteConfigureThreadPoolFuncDef = {
+    "executeConfigureThreadPool", 5, iocshExecuteConfigureThreadPoolArgs };
+
+static void iocshExecuteConfigureThreadPoolFunc(
+    const iocshArgBuf *args) noexcept {
+  int minThreads = args[0].ival;
+  int maxThreads = args[1].ival;
+  int maxQueueSize = args[2].ival;
+  char *rejectionPolicyCStr = args[3].sval;
+  double idleTimeout = args[4].dval;
+  if (maxQueueSize < 0) {
+    errorPrintf(
+        "Could not configure the thread pool: The max. queue size must not be negative.");
+    return;
+  }
+  if (!(idleTimeout >= 0.0) || idleTimeout > 86400.0) {
+    errorPrintf(
+        "Could not configure the thread pool: The idle timeout must be between 0 and 86400 seconds.");
+    return;
+  }
+  auto &executor = sharedThreadPoolExecutor();
+  auto configuration = executor.getConfiguration();
+  // If no rejection policy is specified, we keep the current one.
+  auto rejectionPolicyString = std::string(
+      rejectionPolicyCStr ? rejectionPolicyCStr : "");
+  if (rejectionPolicyString == "block") {
+    configuration.rejectionPolicy = ThreadPoolExecutor::RejectionPolicy::block;
+  } else if (rejectionPolicyString == "caller_runs") {
+    configuration.rejectionPolicy =
+        ThreadPoolExecutor::RejectionPolicy::callerRuns;
+  } else if (rejectionPolicyString == "abort") {
+    configuration.rejectionPolicy = ThreadPoolExecutor::RejectionPolicy::abort;
+  } else if (!rejectionPolicyString.empty()) {
+    errorPrintf(
+        "Could not configure the thread pool: Rejection policy must be one of \"block\", \"caller_runs\", or \"abort\".");
+    return;
+  }
+  configuration.minThreads = minThreads;
+  configuration.maxThreads = maxThreads;
+  configuration.maxQueueSize = maxQueueSize;
+  configuration.idleTimeout = std::chrono::milliseconds(
+      static_cast<std::chrono::milliseconds::rep>(
+          std::round(idleTimeout * 1000.0)));
+  try {
+    executor.configure(configuration);
+  } catch (std::exception &e) {
+    errorPrintf(
+        "Could not configure the thread pool: %s", e.what());
+  } catch (...) {
+    errorPrintf(
+        "Could not configure the thread pool: Unknown error.");
+  }
+}
+
+// Data structures needed for the iocsh executeRefreshEnvironment function.
+static const iocshFuncDef iocshExecuteRefreshEnvironmentFuncDef = {
+    "executeRefreshEnvironment", 0, nullptr };
+
+static void iocshExecuteRefreshEnvironmentFunc(
+    const iocshArgBuf *) noexcept {
+  try {
+    BaseEnvironment::getInstance().refresh();
+  } catch (std::exception &e) {
+    errorPrintf(
+        "Could not refresh the environment: %s", e.what());
+  } catch (...) {
+    errorPrintf(
+        "Could not refresh the environment: Unknown error.");
+  }
+}
+
+// Data structures needed for the iocsh executeSetBaseEnvironment function.
+static const iocshArg iocshExecuteSetBaseEnvironmentArg0 = { "mode",
+    iocshArgString };
+static const iocshArg iocshExecuteSetBaseEnvironmentArg1 = {
+    "variable names", iocshArgString };
+static const iocshArg * const iocshExecuteSetBaseEnvironmentArgs[] = {
+    &iocshExecuteSetBaseEnvironmentArg0, &iocshExecuteSetBaseEnvironmentArg1};
+static const iocshFuncDef iocshExecuteSetBaseEnvironmentFuncDef = {
+    "executeSetBaseEnvironment", 2, iocshExecuteSetBaseEnvironmentArgs };
+
+static void iocshExecuteSetBaseEnvironmentFunc(
+    const iocshArgBuf *args) noexcept {
+  char *modeCStr = args[0].sval;
+  char *namesCStr = args[1].sval;
+  auto modeString = std::string(modeCStr ? modeCStr : "");
+  BaseEnvironment::Mode mode;
+  if (modeString == "inherit") {
+    mode = BaseEnvironment::Mode::inherit;
+  } else if (modeString == "empty") {
+    mode = BaseEnvironment::Mode::empty;
+  } else if (modeString == "whitelist") {
+    mode = BaseEnvironment::Mode::whitelist;
+  } else {
+    errorPrintf(
+        "Could not set the base environment: Mode must be one of \"inherit\", \"empty\", or \"whitelist\".");
+    return;
+  }
+  try {
+    // The variable names are separated by commas or spaces.
+    std::vector<std::string> names;
+    auto namesString = std::string(namesCStr ? namesCStr : "");
+    std::regex separator("[ ,]+");
+    for (std::sregex_token_iterator name(namesString.begin(),
+        namesString.end(), separator, -1), end; name != end; ++name) {
+      if (name->length()) {
+        names.push_back(*name);
+      }
+    }
+    BaseEnvironment::getInstance().setMode(mode, names);
+  } catch (std::exception &e) {
+    errorPrintf(
+        "Could not set the base environment: %s", e.what());
+  } catch (...) {
+    errorPrintf(
+        "Could not set the base environment: Unknown error.");
+  }
+}
+
+// Data structures needed for the iocsh executeSetCaptureMode function.
+static const iocshArg iocshExecuteSetCaptureModeArg0 = { "command ID",
+    iocshArgString };
+static const iocshArg iocshExecuteSetCaptureModeArg1 = { "capture mode",
+    iocshArgString };
+static const iocshArg iocshExecuteSetCaptureModeArg2 = { "stream",
+    iocshArgString };
+static const iocshArg * const iocshExecuteSetCaptureModeArgs[] = {
+    &iocshExecuteSetCaptureModeArg0, &iocshExecuteSetCaptureModeArg1,
+    &iocshExecuteSetCaptureModeArg2};
+static const iocshFuncDef iocshExecuteSetCaptureModeFuncDef = {
+    "executeSetCaptureMode", 3, iocshExecuteSetCaptureModeArgs };
+
+static void iocshExecuteSetCaptureModeFunc(
+    const iocshArgBuf *args) noexcept {
+  char *commandIdCStr = args[0].sval;
+  char *captureModeCStr = args[1].sval;
+  char *streamCStr = args[2].sval;
+  if (!commandIdCStr || !std::strlen(commandIdCStr)) {
+    errorPrintf(
+        "Could not set the capture mode: Command ID must be specified.");
+    return;
+  }
+  auto captureModeString = std::string(
+      captureModeCStr ? captureModeCStr : "");
+  CaptureMode captureMode;
+  if (captureModeString == "pipe") {
+    captureMode = CaptureMode::pipe;
+  } else if (captureModeString == "file") {
+    captureMode = CaptureMode::file;
+  } else {
+    errorPrintf(
+        "Could not set the capture mode: Capture mode must be one of \"pipe\" or \"file\".");
+    return;
+  }
+  // If no stream is specified, the mode applies to both streams.
+  auto streamString = std::string(streamCStr ? streamCStr : "");
+  bool setStdErr = streamString.empty() || streamString == "stderr";
+  bool setStdOut = streamString.empty() || streamString == "stdout";
+  if (!setStdErr && !setStdOut) {
+    errorPrintf(
+        "Could not set the capture mode: Stream must be one of \"stdout\" or \"stderr\" or be empty.");
+    return;
+  }
+  auto command = CommandRegistry::getInstance().getCommand(commandIdCStr);
+  if (!command) {
+    errorPrintf(
+        "Could not set the capture mode: Command \"%s\" is not defined.",
+        commandIdCStr);
+    return;
+  }
+  try {
+    if (setStdErr) {
+      command->setStdErrCaptureMode(captureMode);
+    }
+    if (setStdOut) {
+      command->setStdOutCaptureMode(captureMode);
+    }
+  } catch (std::exception &e) {
+    errorPrintf(
+        "Could not set the capture mode: %s", e.what());
+  } catch (...) {
+    errorPrintf(
+        "Could not set the capture mode: Unknown error.");
+  }
+}
+
+// Data structures needed for the iocsh executeSetExecutionMode function.
+static const iocshArg iocshExecuteSetExecutionModeArg0 = { "command ID",
+    iocshArgString };
+static const iocshArg iocshExecuteSetExecutionModeArg1 = { "execution mode",
+    iocshArgString };
+static const iocshArg * const iocshExecuteSetExecutionModeArgs[] = {
+    &iocshExecuteSetExecutionModeArg0, &iocshExecuteSetExecutionModeArg1};
+static const iocshFuncDef iocshExecuteSetExecutionModeFuncDef = {
+    "executeSetExecutionMode", 2, iocshExecuteSetExecutionModeArgs };
+
+static void iocshExecuteSetExecutionModeFunc(
+    const iocshArgBuf *args) noexcept {
+  char *commandIdCStr = args[0].sval;
+  char *executionModeCStr = args[1].sval;
+  if (!commandIdCStr || !std::strlen(commandIdCStr)) {
+    errorPrintf(
+        "Could not set the execution mode: Command ID must be specified.");
+    return;
+  }
+  auto executionModeString = std::string(
+      executionModeCStr ? executionModeCStr : "");
+  ExecutionMode executionMode;
+  if (executionModeString == "process") {
+    executionMode = ExecutionMode::process;
+  } else if (executionModeString == "coprocess") {
+    executionMode = ExecutionMode::coprocess;
+  } else {
+    errorPrintf(
+        "Could not set the execution mode: Execution mode must be one of \"process\" or \"coprocess\".");
+    return;
+  }
+  auto command = CommandRegistry::getInstance().getCommand(commandIdCStr);
+  if (!command) {
+    errorPrintf(
+        "Could not set the execution mode: Command \"%s\" is not defined.",
+        commandIdCStr);
+    return;
+  }
+  try {
+    command->setExecutionMode(executionMode);
+  } catch (std::exception &e) {
+    errorPrintf(
+        "Could not set the execution mode: %s", e.what());
+  } catch (...) {
+    errorPrintf(
+        "Could not set the execution mode: Unknown error.");
+  }
+}
+
+// Data structures needed for the iocsh executeSetOverflowPolicy function.
+static const iocshArg iocshExecuteSetOverflowPolicyArg0 = { "command ID",
+    iocshArgString };
+static const iocshArg iocshExecuteSetOverflowPolicyArg1 = { "overflow policy",
+    iocshArgString };
+static const iocshArg iocshExecuteSetOverflowPolicyArg2 = { "stream",
+    iocshArgString };
+static const iocshArg * const iocshExecuteSetOverflowPolicyArgs[] = {
+    &iocshExecuteSetOverflowPolicyArg0, &iocshExecuteSetOverflowPolicyArg1,
+    &iocshExecuteSetOverflowPolicyArg2};
+static const iocshFuncDef iocshExecuteSetOverflowPolicyFuncDef = {
+    "executeSetOverflowPolicy", 3, iocshExecuteSetOverflowPolicyArgs };
+
+static void iocshExecuteSetOverflowPolicyFunc(
+    const iocshArgBuf *args) noexcept {
+  char *commandIdCStr = args[0].sval;
+  char *overflowPolicyCStr = args[1].sval;
+  char *streamCStr = args[2].sval;
+  if (!commandIdCStr || !std::strlen(commandIdCStr)) {
+    errorPrintf(
+        "Could not set the overflow policy: Command ID must be specified.");
+    return;
+  }
+  auto overflowPolicyString = std::string(
+      overflowPolicyCStr ? overflowPolicyCStr : "");
+  OverflowPolicy overflowPolicy;
+  if (overflowPolicyString == "keep_head") {
+    overflowPolicy = OverflowPolicy::keepHead;
+  } else if (overflowPolicyString == "keep_tail") {
+    overflowPolicy = OverflowPolicy::keepTail;
+  } else if (overflowPolicyString == "kill") {
+    overflowPolicy = OverflowPolicy::kill;
+  } else {
+    errorPrintf(
+        "Could not set the overflow policy: Overflow policy must be one of \"keep_head\", \"keep_tail\", or \"kill\".");
+    return;
+  }
+  // If no stream is specified, the policy applies to both streams.
+  auto streamString = std::string(streamCStr ? streamCStr : "");
+  bool setStdErr = streamString.empty() || streamString == "stderr";
+  bool setStdOut = streamString.empty() || streamString == "stdout";
+  if (!setStdErr && !setStdOut) {
+    errorPrintf(
+        "Could not set the overflow policy: Stream must be one of \"stdout\" or \"stderr\" or be empty.");
+    return;
+  }
+  auto command = CommandRegistry::getInstance().getCommand(commandIdCStr);
+  if (!command) {
+    errorPrintf(
+        "Could not set the overflow policy: Command \"%s\" is not defined.",
+        commandIdCStr);
+    return;
+  }
+  try {
+    if (setStdErr) {
+      command->setStdErrOverflowPolicy(overflowPolicy);
+    }
+    if (setStdOut) {
+      command->setStdOutOverflowPolicy(overflowPolicy);
+    }
+  } catch (std::exception &e) {
+    errorPrintf(
+        "Could not set the overflow policy: %s", e.what());
+  } catch (...) {
+    errorPrintf(
+        "Could not set the overflow policy: Unknown error.");
+  }
+}
+
+// Data structures needed for the iocsh executeSetPriority function.
+static const iocshArg iocshExecuteSetPriorityArg0 = { "command ID",
+    iocshArgString };
+static const iocshArg iocshExecuteSetPriorityArg1 = { "priority",
+    iocshArgString };
+static const iocshArg iocshExecuteSetPriorityArg2 = { "weight",
+    iocshArgInt };
+static const iocshArg * const iocshExecuteSetPriorityArgs[] = {
+    &iocshExecuteSetPriorityArg0, &iocshExecuteSetPriorityArg1,
+    &iocshExecuteSetPriorityArg2};
+static const iocshFuncDef iocshExecuteSetPriorityFuncDef = {
+    "executeSetPriority", 3, iocshExecuteSetPriorityArgs };
+
+static void iocshExecuteSetPriorityFunc(const iocshArgBuf *args) noexcept {
+  char *commandIdCStr = args[0].sval;
+  char *priorityCStr = args[1].sval;
+  int weight = args[2].ival;
+  if (!commandIdCStr || !std::strlen(commandIdCStr)) {
+    errorPrintf(
+        "Could not set the priority: Command ID must be specified.");
+    return;
+  }
+  // If no priority is specified, we use the normal priority.
+  auto priorityString = std::string(priorityCStr ? priorityCStr : "");
+  ThreadPoolExecutor::Priority priority;
+  if (priorityString == "high") {
+    priority = ThreadPoolExecutor::Priority::high;
+  } else if (priorityString.empty() || priorityString == "normal") {
+    priority = ThreadPoolExecutor::Priority::normal;
+  } else if (priorityString == "low") {
+    priority = ThreadPoolExecutor::Priority::low;
+  } else {
+    errorPrintf(
+        "Could not set the priority: Priority must be one of \"high\", \"normal\", or \"low\".");
+    return;
+  }
+  // If no weight is specified, we use a weight of one.
+  if (weight == 0) {
+    weight = 1;
+  }
+  auto command = CommandRegistry::getInstance().getCommand(commandIdCStr);
+  if (!command) {
+    errorPrintf(
+        "Could not set the priority: Command \"%s\" is not defined.",
+        commandIdCStr);
+    return;
+  }
+  try {
+    sharedThreadPoolExecutor().setQueueScheduling(
+        command->getExecutorQueue(), priority, weight);
+  } catch (std::exception &e) {
+    errorPrintf(
+        "Could not set the priority: %s", e.what());
+  } catch (...) {
+    errorPrintf(
+        "Could not set the priority: Unknown error.");
+  }
+}
+
+// Data structures needed for the iocsh executeSetSpawnMethod function.
+static const iocshArg iocshExecuteSetSpawnMethodArg0 = { "spawn method",
+    iocshArgString };
+static const iocshArg iocshExecuteSetSpawnMethodArg1 = { "command ID",
+    iocshArgString };
+static const iocshArg * const iocshExecuteSetSpawnMethodArgs[] = {
+    &iocshExecuteSetSpawnMethodArg0, &iocshExecuteSetSpawnMethodArg1};
+static const iocshFuncDef iocshExecuteSetSpawnMethodFuncDef = {
+    "executeSetSpawnMethod", 2, iocshExecuteSetSpawnMethodArgs };
+
+static void iocshExecuteSetSpawnMethodFunc(const iocshArgBuf *args) noexcept {
+  char *spawnMethodCStr = args[0].sval;
+  char *commandIdCStr = args[1].sval;
+  if (!spawnMethodCStr || !std::strlen(spawnMethodCStr)) {
+    errorPrintf(
+        "Could not set the spawn method: Spawn method must be specified.");
+    return;
+  }
+  auto spawnMethodString = std::string(spawnMethodCStr);
+  SpawnMethod spawnMethod;
+  if (spawnMethodString == "fork") {
+    spawnMethod = SpawnMethod::fork;
+  } else if (spawnMethodString == "vfork") {
+    spawnMethod = SpawnMethod::vfork;
+  } else if (spawnMethodString == "posix_spawn") {
+    spawnMethod = SpawnMethod::posixSpawn;
+  } else {
+    errorPrintf(
+        "Could not set the spawn method: Spawn method must be one of \"fork\", \"vfork\", or \"posix_spawn\".");
+    return;
+  }
+  // If no command ID is specified, we change the default spawn method.
+  if (!commandIdCStr || !std::strlen(commandIdCStr)) {
+    Command::setDefaultSpawnMethod(spawnMethod);
+    return;
+  }
+  auto command = CommandRegistry::getInstance().getCommand(commandIdCStr);
+  if (!command) {
+    errorPrintf(
+        "Could not set the spawn method: Command \"%s\" is not defined.",
+        commandIdCStr);
+    return;
+  }
+  command->setSpawnMethod(spawnMethod);
+}
+
+// Data structures needed for the iocsh executeSetConcurrency function.
+static const iocshArg iocshExecuteSetConcurrencyArg0 = { "command ID",
+    iocshArgString };
+static const iocshArg iocshExecuteSetConcurrencyArg1 = {
+    "max. concurrent runs", iocshArgInt };
+static const iocshArg iocshExecuteSetConcurrencyArg2 = { "result order",
+    iocshArgString };
+static const iocshArg * const iocshExecuteSetConcurrencyArgs[] = {
+    &iocshExecuteSetConcurrencyArg0, &iocshExecuteSetConcurrencyArg1,
+    &iocshExecuteSetConcurrencyArg2};
+static const iocshFuncDef iocshExecuteSetConcurrencyFuncDef = {
+    "executeSetConcurrency", 3, iocshExecuteSetConcurrencyArgs };
+
+static void iocshExecuteSetConcurrencyFunc(const iocshArgBuf *args) noexcept {
+  char *commandIdCStr = args[0].sval;
+  int maxConcurrentRuns = args[1].ival;
+  char *resultOrderCStr = args[2].sval;
+  if (!commandIdCStr || !std::strlen(commandIdCStr)) {
+    errorPrintf(
+        "Could not set the concurrency: Command ID must be specified.");
+    return;
+  }
+  // If no result order is specified, we use the completion order.
+  auto resultOrderString = std::string(
+      resultOrderCStr ? resultOrderCStr : "");
+  ResultOrder resultOrder;
+  if (resultOrderString.empty() || resultOrderString == "completion") {
+    resultOrder = ResultOrder::completion;
+  } else if (resultOrderString == "submission") {
+    resultOrder = ResultOrder::submission;
+  } else {
+    errorPrintf(
+        "Could not set the concurrency: Result order must be one of \"completion\" or \"submission\".");
+    return;
+  }
+  auto command = CommandRegistry::getInstance().getCommand(commandIdCStr);
+  if (!command) {
+    errorPrintf(
+        "Could not set the concurrency: Command \"%s\" is not defined.",
+        commandIdCStr);
+    return;
+  }
+  try {
+    command->setConcurrency(maxConcurrentRuns, resultOrder);
+  } catch (std::exception &e) {
+    errorPrintf(
+        "Could not set the concurrency: %s", e.what());
+  } catch (...) {
+    errorPrintf(
+        "Could not set the concurrency: Unknown error.");
+  }
+}
+
+// Data structures needed for the iocsh executeStartForkServer function.
+static const iocshFuncDef iocshExecuteStartForkServerFuncDef = {
+    "executeStartForkServer", 0, nullptr };
+
+static void iocshExecuteStartForkServerFunc(const iocshArgBuf *) noexcept {
+  try {
+    ForkServer::getInstance().start();
+  } catch (std::exception &e) {
+    errorPrintf(
+        "Could not start the fork server: %s", e.what());
+  } catch (...) {
+    errorPrintf(
+        "Could not start the fork server: Unknown error.");
+  }
+}
+
+// Data structures needed for the iocsh executeSupervise function.
+static const iocshArg iocshExecuteSuperviseArg0 = { "command ID",
+    iocshArgString };
+static const iocshArg iocshExecuteSuperviseArg1 = { "min. restart delay",
+    iocshArgDouble };
+static const iocshArg iocshExecuteSuperviseArg2 = { "max. restart delay",
+    iocshArgDouble };
+static const iocshArg * const iocshExecuteSuperviseArgs[] = {
+    &iocshExecuteSuperviseArg0, &iocshExecuteSuperviseArg1,
+    &iocshExecuteSuperviseArg2};
+static const iocshFuncDef iocshExecuteSuperviseFuncDef = {
+    "executeSupervise", 3, iocshExecuteSuperviseArgs };
+
+static void iocshExecuteSuperviseFunc(const iocshArgBuf *args) noexcept {
+  char *commandIdCStr = args[0].sval;
+  double minRestartDelay = args[1].dval;
+  double maxRestartDelay = args[2].dval;
+  if (!commandIdCStr || !std::strlen(commandIdCStr)) {
+    errorPrintf(
+        "Could not supervise the command: Command ID must be specified.");
+    return;
+  }
+  if (!(minRestartDelay >= 0.0) || minRestartDelay > 86400.0
+      || !(maxRestartDelay >= 0.0) || maxRestartDelay > 86400.0) {
+    errorPrintf(
+        "Could not supervise the command: The restart delays must be between 0 and 86400 seconds.");
+    return;
+  }
+  auto command = CommandRegistry::getInstance().getCommand(commandIdCStr);
+  if (!command) {
+    errorPrintf(
+        "Could not supervise the command: Command \"%s\" is not defined.",
+        commandIdCStr);
+    return;
+  }
+  try {
+    auto supervisor = command->supervise();
+    auto options = supervisor->getOptions();
+    // If a delay is not specified (zero), we keep the default.
+    if (minRestartDelay > 0.0) {
+      options.minRestartDelay = std::chrono::milliseconds(
+          static_cast<std::chrono::milliseconds::rep>(
+              std::round(minRestartDelay * 1000.0)));
+    }
+    if (maxRestartDelay > 0.0) {
+      options.maxRestartDelay = std::chrono::milliseconds(
+          static_cast<std::chrono::milliseconds::rep>(
+              std::round(maxRestartDelay * 1000.0)));
+    }
+    supervisor->setOptions(options);
+  } catch (std::exception &e) {
+    errorPrintf(
+        "Could not supervise the command: %s", e.what());
+  } catch (...) {
+    errorPrintf(
+        "Could not supervise the command: Unknown error.");
+  }
+}
+
+// Data structures needed for the iocsh executeThreadPoolStatus function.
+static const iocshFuncDef iocshExecuteThreadPoolStatusFuncDef = {
+    "executeThreadPoolStatus", 0, nullptr };
+
+static void iocshExecuteThreadPoolStatusFunc(const iocshArgBuf *) noexcept {
+  auto &executor = sharedThreadPoolExecutor();
+  auto configuration = executor.getConfiguration();
+  char const *rejectionPolicy;
+  switch (configuration.rejectionPolicy) {
+  case ThreadPoolExecutor::RejectionPolicy::block:
+    rejectionPolicy = "block";
+    break;
+  case ThreadPoolExecutor::RejectionPolicy::callerRuns:
+    rejectionPolicy = "caller_runs";
+    break;
+  case ThreadPoolExecutor::RejectionPolicy::abort:
+  default:
+    rejectionPolicy = "abort";
+    break;
+  }
+  ::epicsStdoutPrintf(
+      "Threads: %d (%d idle, min. %d, max. %d)\n"
+      "Queued tasks: %zu (max. %zu)\n"
+      "Rejection policy: %s\n"
+      "Idle timeout: %.3f s\n",
+      executor.getThreadCount(), executor.getIdleThreadCount(),
+      configuration.minThreads, configuration.maxThreads,
+      executor.getQueueSize(), configuration.maxQueueSize, rejectionPolicy,
+      configuration.idleTimeout.count() / 1000.0);
+  ::epicsStdoutPrintf("%-24s %-8s %6s %12s %16s %16s\n", "Queue", "Priority",
+      "Weight", "Tasks", "Mean wait [ms]", "Max. wait [ms]");
+  for (auto queue : executor.getQueues()) {
+    auto statistics = queue->getStatistics();
+    char const *priority;
+    switch (queue->getPriority()) {
+    case ThreadPoolExecutor::Priority::high:
+      priority = "high";
+      break;
+    case ThreadPoolExecutor::Priority::low:
+      priority = "low";
+      break;
+    case ThreadPoolExecutor::Priority::normal:
+    default:
+      priority = "normal";
+      break;
+    }
+    double meanWaitTime = statistics.tasks
+        ? statistics.totalWaitTime.count() / 1e6 / statistics.tasks : 0.0;
+    ::epicsStdoutPrintf("%-24s %-8s %6d %12llu %16.3f %16.3f\n",
+        queue->getName().empty() ? "(default)" : queue->getName().c_str(),
+        priority, queue->getWeight(),
+        static_cast<unsigned long long>(statistics.tasks), meanWaitTime,
+        statistics.maxWaitTime.count() / 1e6);
+  }
+}
+
+// Data structures needed for the iocsh executeTraceDump function.
+static const iocshArg iocshExecuteTraceDumpArg0 = { "file name",
+    iocshArgString };
+static const iocshArg * const iocshExecuteTraceDumpArgs[] = {
+    &iocshExecuteTraceDumpArg0};
+static const iocshFuncDef iocshExecuteTraceDumpFuncDef = {
+    "executeTraceDump", 1, iocshExecuteTraceDumpArgs };
+
+static void iocshExecuteTraceDumpFunc(const iocshArgBuf *args) noexcept {
+  char *fileNameCStr = args[0].sval;
+  if (!fileNameCStr || !std::strlen(fileNameCStr)) {
+    errorPrintf(
+        "Could not dump the run trace: File name must be specified.");
+    return;
+  }
+  try {
+    RunTrace::getInstance().writeChromeTrace(fileNameCStr);
+  } catch (std::exception &e) {
+    errorPrintf(
+        "Could not dump the run trace: %s", e.what());
+  } catch (...) {
+    errorPrintf(
+        "Could not dump the run trace: Unknown error.");
+  }
+}
+
+/**
+ * Init hook that takes a snapshot of the environment when iocInit starts, so
+ * that commands see the variables that have been set in the startup script.
+ * Once the IOC is running, the init hook starts the programs of supervised
+ * commands, so that records using I/O Intr scanning see their first output.
+ */
+static void executeInitHook(initHookState state) noexcept {
+  if (state == initHookAtBeginning) {
+    try {
+      BaseEnvironment::getInstance().refresh();
+    } catch (std::exception &e) {
+      errorPrintf(
+          "Could not take a snapshot of the environment: %s", e.what());
+    } catch (...) {
+      errorPrintf(
+          "Could not take a snapshot of the environment: Unknown error.");
+    }
+  } else if (state == initHookAfterIocRunning) {
+    for (auto const &entry : CommandRegistry::getInstance().getCommands()) {
+      auto supervisor = entry.second->getSupervisor();
+      if (!supervisor) {
+        continue;
+      }
+      try {
+        supervisor->start();
+      } catch (std::exception &e) {
+        errorPrintf(
+            "Could not start command \"%s\": %s", entry.first.c_str(),
+            e.what());
+      } catch (...) {
+        errorPrintf(
+            "Could not start command \"%s\": Unknown error.",
+            entry.first.c_str());
+      }
+    }
+  }
+}
+
 /**
- * Registrar that registers the iocsh commands.
+ * Registrar that registers the iocsh commands and the init hook.
  */
 static void executeRegistrar() {
+  ::initHookRegister(executeInitHook);
   ::iocshRegister(&iocshExecuteAddCommandFuncDef, iocshExecuteAddCommandFunc);
+  ::iocshRegister(&iocshExecuteBufferPoolStatusFuncDef,
+      iocshExecuteBufferPoolStatusFunc);
+  ::iocshRegister(&iocshExecuteConfigureLineStreamFuncDef,
+      iocshExecuteConfigureLineStreamFunc);
+  ::iocshRegister(&iocshExecuteConfigureThreadPoolFuncDef,
+      iocshExecuteConfigureThreadPoolFunc);
+  ::iocshRegister(&iocshExecuteRefreshEnvironmentFuncDef,
+      iocshExecuteRefreshEnvironmentFunc);
+  ::iocshRegister(&iocshExecuteSetBaseEnvironmentFuncDef,
+      iocshExecuteSetBaseEnvironmentFunc);
+  ::iocshRegister(&iocshExecuteSetCaptureModeFuncDef,
+      iocshExecuteSetCaptureModeFunc);
+  ::iocshRegister(&iocshExecuteSetConcurrencyFuncDef,
+      iocshExecuteSetConcurrencyFunc);
+  ::iocshRegister(&iocshExecuteSetExecutionModeFuncDef,
+      iocshExecuteSetExecutionModeFunc);
+  ::iocshRegister(&iocshExecuteSetOverflowPolicyFuncDef,
+      iocshExecuteSetOverflowPolicyFunc);
+  ::iocshRegister(&iocshExecuteSetPriorityFuncDef,
+      iocshExecuteSetPriorityFunc);
+  ::iocshRegister(&iocshExecuteSetSpawnMethodFuncDef,
+      iocshExecuteSetSpawnMethodFunc);
+  ::iocshRegister(&iocshExecuteStartForkServerFuncDef,
+      iocshExecuteStartForkServerFunc);
+  ::iocshRegister(&iocshExecuteSuperviseFuncDef,
+      iocshExecuteSuperviseFunc);
+  ::iocshRegister(&iocshExecuteThreadPoolStatusFuncDef,
+      iocshExecuteThreadPoolStatusFunc);
+  ::iocshRegister(&iocshExecuteTraceDumpFuncDef, iocshExecuteTraceDumpFunc);
 }
 
 epicsExportRegistrar(executeRegistrar);
@@ -0,0 +1,433 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <system_error>
+
+extern "C" {
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif // __linux__
+}
+
+#include "fileDescriptors.h"
+#include "spawnProcess.h"
+
+namespace epics {
+namespace execute {
+
+namespace {
+
+/**
+ * Size of the stack that is allocated for the child process when using
+ * clone(). The child process only runs a few system calls before calling
+ * execve(), so it does not need a large stack.
+ */
+constexpr std::size_t cloneStackSize = 64 * 1024;
+
+/**
+ * Data that is passed to the child process when using clone(). As the child
+ * shares the address space with the parent process, it can report the error
+ * number of a failed execve() call through this structure.
+ */
+struct CloneContext {
+
+  SpawnParameters const *parameters;
+  int execveErrorNumber;
+
+};
+
+/**
+ * Makes the specified file descriptor available as the target file
+ * descriptor. If the file descriptor is -1, /dev/null is opened instead.
+ *
+ * This function is only called in the child process, so it must only use
+ * async-signal-safe functions.
+ */
+void redirectFd(int fd, int targetFd, int openFlags) {
+  if (fd == -1) {
+    fd = ::open("/dev/null", openFlags);
+    // If we cannot open /dev/null, we leave the target FD as it is. This
+    // matches the behavior that we have always had in this case.
+    if (fd == -1) {
+      return;
+    }
+  }
+  if (fd != targetFd) {
+    ::dup2(fd, targetFd);
+  } else {
+    // dup2() clears the close-on-exec flag, but if the file descriptor
+    // already has the right number, we have to clear it ourselves.
+    ::fcntl(fd, F_SETFD, 0);
+  }
+}
+
+/**
+ * Prepares the child process and executes the program. This function only
+ * returns if execve() fails. In this case, it returns the error number. The
+ * file descriptor keepFd (if not -1) is not closed before calling execve().
+ *
+ * This function is used for both fork() and clone(CLONE_VM | CLONE_VFORK). In
+ * the latter case, the child process shares the address space with the parent
+ * process, so it must not modify any data structures and must only use
+ * async-signal-safe functions.
+ */
+int prepareAndExecute(SpawnParameters const &parameters, int keepFd) {
+  // The file descriptors that are not needed any longer (including the ones
+  // that we pass as the standard file descriptors) are closed by the loop
+  // below.
+  redirectFd(parameters.stdinFd, STDIN_FILENO, O_RDONLY);
+  redirectFd(parameters.stdoutFd, STDOUT_FILENO, O_WRONLY);
+  redirectFd(parameters.stderrFd, STDERR_FILENO, O_WRONLY);
+  // We close all unused file descriptors. We do not want the child process to
+  // have access to any file descriptors that do not have the close-on-exec
+  // flag set. First of all, this might give the child process access to
+  // things that it should not be able to access, but more importantly due to
+  // this process being multi-threaded, there is no reliable way of always
+  // setting the close-on-exec flag, and leaking pipes intended for other
+  // child processes into the wrong child process can cause the pipe not to be
+  // closed when the child process quits, causing a thread that is trying to
+  // read from that pipe to hang longer than necessary.
+  closeFileDescriptors(STDERR_FILENO + 1, keepFd, parameters.maxFd, true);
+  // We reset all signal handlers to SIG_DFL, because the process may have
+  // inherited signals where the handler has been set to SIG_IGN. We ignore
+  // any errors. We have to do this before unblocking the signals: When using
+  // clone(CLONE_VM), a signal handler inherited from the parent process would
+  // run on the shared address space.
+  struct sigaction signalAction;
+  ::memset(&signalAction, 0, sizeof(signalAction));
+  signalAction.sa_handler = SIG_DFL;
+  for (int signalNumber = 1; signalNumber < NSIG; ++signalNumber) {
+    ::sigaction(signalNumber, &signalAction, nullptr);
+  }
+  // The EPICS IOC blocks a few signals. We do not want these signals to be
+  // blocked for the child process, so we unblock all signals. If sigemptyset
+  // fails (which is extremely unlikely), we do not call sigprocmask. If
+  // sigprocmask fails, we ignore this and continue with the signal mask from
+  // EPICS.
+  ::sigset_t signalSet;
+  // We cannot use the qualified form for sigemptyset, because it is a
+  // preprocessor macro on some platforms.
+  if (!sigemptyset(&signalSet)) {
+    ::sigprocmask(SIG_SETMASK, &signalSet, nullptr);
+  }
+  // Using a const cast here is not really clean, but it should be okay
+  // because execve does not modify the arrays.
+  ::execve(parameters.path, const_cast<char * const *>(parameters.argv),
+      const_cast<char * const *>(parameters.envp));
+  // On success, the call to execve does not return.
+  return errno;
+}
+
+/**
+ * Creates a child process with fork(). The status pipe is used for reporting
+ * the error number of a failed execve() call and is closed by this function.
+ * This function does not allocate memory and does not throw. If fork()
+ * fails, -1 is returned and forkErrorNumber is set.
+ */
+::pid_t forkAndExecute(SpawnParameters const &parameters, int statusPipe[2],
+    int &forkErrorNumber, int &execveErrorNumber) noexcept {
+  forkErrorNumber = 0;
+  auto childPid = ::fork();
+  if (childPid == 0) {
+    // This code runs in the newly created child process. We must not close
+    // the write end of the status pipe before calling execve(), so we pass it
+    // as the exception to the code closing the file descriptors.
+    ::close(statusPipe[0]);
+    int errorNumber = prepareAndExecute(parameters, statusPipe[1]);
+    // If we get here, execve failed. We ignore errors when writing the error
+    // number: In this case, the parent process is going to see the end of the
+    // stream and the child process exits with an exit code indicating the
+    // problem.
+    while (::write(statusPipe[1], &errorNumber, sizeof(errorNumber)) == -1
+        && errno == EINTR) {
+    }
+    // Now we kill the child process.
+    ::_exit(127);
+  } else if (childPid == -1) {
+    // errno may be a preprocessor macro, so we cannot use the qualified form.
+    forkErrorNumber = errno;
+    ::close(statusPipe[0]);
+    ::close(statusPipe[1]);
+    return -1;
+  }
+  ::close(statusPipe[1]);
+  int errorNumber = 0;
+  ::ssize_t bytesRead;
+  do {
+    bytesRead = ::read(statusPipe[0], &errorNumber, sizeof(errorNumber));
+  } while (bytesRead == -1 && errno == EINTR);
+  ::close(statusPipe[0]);
+  if (bytesRead == sizeof(errorNumber)) {
+    // The child process has already exited (or is just about to), but we
+    // still have to reap it.
+    ::waitpid(childPid, nullptr, 0);
+    execveErrorNumber = errorNumber;
+    return -1;
+  }
+  return childPid;
+}
+
+::pid_t spawnWithFork(SpawnParameters const &parameters,
+    int &execveErrorNumber) {
+  // We use a pipe for getting information about a problem that happens after
+  // forking, but before the command is successfully executed. Both ends have
+  // the close-on-exec flag set, so when execve() succeeds, the write end is
+  // closed and the parent process reads the end of the stream. If execve()
+  // fails, the child process writes the error number into the pipe.
+  int statusPipe[2];
+  createPipe(statusPipe);
+  int forkErrorNumber;
+  auto childPid = forkAndExecute(parameters, statusPipe, forkErrorNumber,
+      execveErrorNumber);
+  if (forkErrorNumber) {
+    throw std::system_error(
+        std::error_code(forkErrorNumber, std::system_category()),
+        "fork() failed");
+  }
+  return childPid;
+}
+
+#ifdef __linux__
+int cloneChildMain(void *contextVoid) {
+  auto context = static_cast<CloneContext *>(contextVoid);
+  // As we share the address space with the parent process, which is suspended
+  // until we call execve() or exit, we can write the error number directly
+  // into its data structure.
+  context->execveErrorNumber = prepareAndExecute(*context->parameters, -1);
+  ::_exit(127);
+}
+
+/**
+ * Creates a child process with clone(CLONE_VM | CLONE_VFORK), which runs on
+ * the specified stack until it calls execve(). This function does not
+ * allocate memory and does not throw. If clone() fails, -1 is returned and
+ * cloneErrorNumber is set.
+ */
+::pid_t cloneAndExecute(SpawnParameters const &parameters, char *stack,
+    std::size_t stackSize, int &cloneErrorNumber,
+    int &execveErrorNumber) noexcept {
+  CloneContext context;
+  context.parameters = &parameters;
+  context.execveErrorNumber = 0;
+  // The stack grows downwards on all platforms supported by Linux that we care
+  // about, so we pass a pointer to the end of the allocated memory. We align
+  // it to 16 bytes, which is sufficient for all common ABIs.
+  auto stackTop = reinterpret_cast<char *>(
+      (reinterpret_cast<std::uintptr_t>(stack + stackSize))
+      & ~static_cast<std::uintptr_t>(15));
+  // We block all signals while the child process is running on our address
+  // space. Otherwise, a signal handler could run in the child process before
+  // it has reset the signal handlers, and such a signal handler would operate
+  // on the parent's data structures.
+  ::sigset_t allSignals;
+  ::sigset_t oldSignals;
+  sigfillset(&allSignals);
+  ::pthread_sigmask(SIG_SETMASK, &allSignals, &oldSignals);
+  // Due to CLONE_VFORK, this call only returns after the child process has
+  // called execve() or has exited.
+  auto childPid = ::clone(cloneChildMain, stackTop,
+      CLONE_VM | CLONE_VFORK | SIGCHLD, &context);
+  cloneErrorNumber = childPid == -1 ? errno : 0;
+  ::pthread_sigmask(SIG_SETMASK, &oldSignals, nullptr);
+  if (childPid == -1) {
+    return -1;
+  }
+  if (context.execveErrorNumber) {
+    // The child process has already exited, but we still have to reap it.
+    ::waitpid(childPid, nullptr, 0);
+    execveErrorNumber = context.execveErrorNumber;
+    return -1;
+  }
+  return childPid;
+}
+
+::pid_t spawnWithClone(SpawnParameters const &parameters,
+    int &execveErrorNumber) {
+  std::unique_ptr<char[]> stack(new char[cloneStackSize]);
+  int cloneErrorNumber;
+  auto childPid = cloneAndExecute(parameters, stack.get(), cloneStackSize,
+      cloneErrorNumber, execveErrorNumber);
+  if (cloneErrorNumber) {
+    throw std::system_error(
+        std::error_code(cloneErrorNumber, std::system_category()),
+        "clone() failed");
+  }
+  return childPid;
+}
+#endif // __linux__
+
+/**
+ * Registers a file action for the specified file descriptor. This is the
+ * posix_spawn() equivalent of redirectFd().
+ */
+int addRedirectFileAction(::posix_spawn_file_actions_t *fileActions, int fd,
+    int targetFd, int openFlags) {
+  if (fd == -1) {
+    return ::posix_spawn_file_actions_addopen(fileActions, targetFd,
+        "/dev/null", openFlags, 0);
+  } else {
+    return ::posix_spawn_file_actions_adddup2(fileActions, fd, targetFd);
+  }
+}
+
+::pid_t spawnWithPosixSpawn(SpawnParameters const &parameters,
+    int &execveErrorNumber) {
+  ::posix_spawn_file_actions_t fileActions;
+  ::posix_spawnattr_t attributes;
+  int errorNumber = ::posix_spawn_file_actions_init(&fileActions);
+  if (errorNumber) {
+    throw std::system_error(
+        std::error_code(errorNumber, std::system_category()),
+        "posix_spawn_file_actions_init() failed");
+  }
+  errorNumber = ::posix_spawnattr_init(&attributes);
+  if (errorNumber) {
+    ::posix_spawn_file_actions_destroy(&fileActions);
+    throw std::system_error(
+        std::error_code(errorNumber, std::system_category()),
+        "posix_spawnattr_init() failed");
+  }
+  errorNumber = addRedirectFileAction(&fileActions, parameters.stdinFd,
+      STDIN_FILENO, O_RDONLY);
+  if (!errorNumber) {
+    errorNumber = addRedirectFileAction(&fileActions, parameters.stdoutFd,
+        STDOUT_FILENO, O_WRONLY);
+  }
+  if (!errorNumber) {
+    errorNumber = addRedirectFileAction(&fileActions, parameters.stderrFd,
+        STDERR_FILENO, O_WRONLY);
+  }
+#if defined(__GLIBC__) && (__GLIBC__ > 2 \
+    || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+  // If the C library supports it, we close all other file descriptors, just
+  // like we do when using fork(). Otherwise, we have to rely on the
+  // close-on-exec flag being set on the file descriptors.
+  if (!errorNumber) {
+    errorNumber = ::posix_spawn_file_actions_addclosefrom_np(&fileActions,
+        STDERR_FILENO + 1);
+  }
+#endif
+  // The signal handling matches the one in prepareAndExecute(): All signals
+  // are unblocked and all signal handlers are reset to their default.
+  ::sigset_t signalSet;
+  if (!errorNumber) {
+    sigemptyset(&signalSet);
+    errorNumber = ::posix_spawnattr_setsigmask(&attributes, &signalSet);
+  }
+  if (!errorNumber) {
+    sigfillset(&signalSet);
+    errorNumber = ::posix_spawnattr_setsigdefault(&attributes, &signalSet);
+  }
+  if (!errorNumber) {
+    errorNumber = ::posix_spawnattr_setflags(&attributes,
+        POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+  }
+  if (errorNumber) {
+    ::posix_spawnattr_destroy(&attributes);
+    ::posix_spawn_file_actions_destroy(&fileActions);
+    throw std::system_error(
+        std::error_code(errorNumber, std::system_category()),
+        "Preparing posix_spawn() failed");
+  }
+  ::pid_t childPid;
+  // Using a const cast here is not really clean, but it should be okay
+  // because posix_spawn does not modify the arrays.
+  errorNumber = ::posix_spawn(&childPid, parameters.path, &fileActions,
+      &attributes, const_cast<char * const *>(parameters.argv),
+      const_cast<char * const *>(parameters.envp));
+  ::posix_spawnattr_destroy(&attributes);
+  ::posix_spawn_file_actions_destroy(&fileActions);
+  if (errorNumber) {
+    // posix_spawn() does not distinguish between a failure to create the
+    // process and a failure of execve(). In both cases, there is no child
+    // process that we would have to reap. Most of the time, the error will be
+    // caused by execve(), so we report it as such.
+    execveErrorNumber = errorNumber;
+    return -1;
+  }
+  return childPid;
+}
+
+} // anonymous namespace
+
+::pid_t spawnProcess(SpawnMethod method, SpawnParameters const &parameters,
+    int &execveErrorNumber) {
+  execveErrorNumber = 0;
+  switch (method) {
+  case SpawnMethod::vfork:
+#ifdef __linux__
+    return spawnWithClone(parameters, execveErrorNumber);
+#else
+    // clone() is only available on Linux, so we fall back to fork().
+    return spawnWithFork(parameters, execveErrorNumber);
+#endif // __linux__
+  case SpawnMethod::posixSpawn:
+    return spawnWithPosixSpawn(parameters, execveErrorNumber);
+  case SpawnMethod::fork:
+  default:
+    return spawnWithFork(parameters, execveErrorNumber);
+  }
+}
+
+::pid_t spawnProcessWithoutAllocation(SpawnParameters const &parameters,
+    char *stack, std::size_t stackSize, int &errorNumber,
+    int &execveErrorNumber) noexcept {
+  execveErrorNumber = 0;
+#ifdef __linux__
+  return cloneAndExecute(parameters, stack, stackSize, errorNumber,
+      execveErrorNumber);
+#else
+  (void) stack;
+  (void) stackSize;
+  // createPipe() might throw, so we create the pipe ourselves. The calling
+  // process is single-threaded, so setting the close-on-exec flag after
+  // creating the pipe is not a problem.
+  int statusPipe[2];
+  if (::pipe(statusPipe)) {
+    errorNumber = errno;
+    return -1;
+  }
+  ::fcntl(statusPipe[0], F_SETFD, FD_CLOEXEC);
+  ::fcntl(statusPipe[1], F_SETFD, FD_CLOEXEC);
+  return forkAndExecute(parameters, statusPipe, errorNumber,
+      execveErrorNumber);
+#endif // __linux__
+}
+
+} // namespace execute
+} // namespace epics
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+#ifndef EPICS_EXEC_SPAWN_PROCESS_H
+#define EPICS_EXEC_SPAWN_PROCESS_H
+
+#include <cstddef>
+
+extern "C" {
+#include <sys/types.h>
+}
+
+#include "SpawnMethod.h"
+
+namespace epics {
+namespace execute {
+
+/**
+ * Parameters describing the process that is created by spawnProcess().
+ *
+ * All pointers must stay valid until spawnProcess() returns. The file
+ * descriptors are not closed by spawnProcess(), so the calling code has to
+ * close them after the process has been created.
+ */
+struct SpawnParameters {
+
+  /**
+   * Path to the executable.
+   */
+  char const *path = nullptr;
+
+  /**
+   * Null-terminated array of null-terminated strings that is passed as the
+   * argument vector.
+   */
+  char const * const *argv = nullptr;
+
+  /**
+   * Null-terminated array of null-terminated strings (in the form NAME=VALUE)
+   * that is passed as the environment.
+   */
+  char const * const *envp = nullptr;
+
+  /**
+   * File descriptor that is used as the child's standard input. If -1, the
+   * standard input is bound to /dev/null.
+   */
+  int stdinFd = -1;
+
+  /**
+   * File descriptor that is used as the child's standard output. If -1, the
+   * standard output is bound to /dev/null.
+   */
+  int stdoutFd = -1;
+
+  /**
+   * File descriptor that is used as the child's standard error output. If -1,
+   * the standard error output is bound to /dev/null.
+   */
+  int stderrFd = -1;
+
+  /**
+   * Greatest file descriptor number that might be open in the parent process.
+   * The child process closes all file descriptors starting at 3 before calling
+   * execve(). This number is only used if the platform does not provide a
+   * way for finding the open file descriptors (see closeFileDescriptors()).
+   */
+  int maxFd = 0;
+
+};
+
+/**
+ * Creates a child process that executes the program described by the
+ * specified parameters, using the specified method.
+ *
+ * In the child process, the standard file descriptors are set up as specified,
+ * all other file descriptors are closed, all signal handlers are reset to their
+ * default, and all signals are unblocked before calling execve().
+ *
+ * This function only returns after the child process has called execve(), so
+ * a failure of execve() is detected right away. In this case, the child
+ * process has already been reaped, -1 is returned, and execveErrorNumber is
+ * set to the error number reported by execve(). When using SpawnMethod::fork,
+ * the error is reported through a pipe that has the close-on-exec flag set.
+ * The other methods report it through their own mechanisms.
+ *
+ * @return process ID of the child process or -1 if execve() failed.
+ * @throws std::system_error if the child process cannot be created.
+ */
+::pid_t spawnProcess(SpawnMethod method, SpawnParameters const &parameters,
+    int &execveErrorNumber);
+
+/**
+ * Creates a child process like spawnProcess() does for SpawnMethod::vfork,
+ * but without allocating memory on the heap and without throwing exceptions.
+ * This is needed in a process that has been forked from a multi-threaded
+ * process (like the fork server), because the heap might be in an
+ * inconsistent state in such a process. The calling process must be
+ * single-threaded.
+ *
+ * The child process runs on the specified stack until it calls execve(), so
+ * the stack must stay valid until this function returns. On platforms other
+ * than Linux, fork() is used and the stack is not needed.
+ *
+ * If the child process cannot be created, -1 is returned and errorNumber is
+ * set to the reason. If execve() fails, -1 is returned and execveErrorNumber
+ * is set. Otherwise, both error numbers are set to zero.
+ *
+ * @return process ID of the child process or -1 if it could not be created
+ *     or execve() failed.
+ */
+::pid_t spawnProcessWithoutAllocation(SpawnParameters const &parameters,
+    char *stack, std::size_t stackSize, int &errorNumber,
+    int &execveErrorNumber) noexcept;
+
+} // namespace execute
+} // namespace epics
+
+#endif // EPICS_EXEC_SPAWN_PROCESS_H
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2026 aquenos GmbH.
+ * Copyright 2026 Karlsruhe Institute of Technology.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ * This software has been developed by aquenos GmbH on behalf of the
+ * Karlsruhe Institute of Technology's Institute for Beam Physics and
+ * Technology.
+ *
+ * This software contains code originally developed by aquenos GmbH for
+ * the s7nodave EPICS device support. aquenos GmbH has relicensed the
+ * affected portions of code from the s7nodave EPICS device support
+ * (originally licensed under the terms of the GNU GPL) under the terms
+ * of the GNU LGPL version 3 or newer.
+ */
+
+/*
+ * Microbenchmark for the ThreadPoolExecutor.
+ *
+ * This program measures the time between submitting a task and the task
+ * starting to run in a thread of the pool (submit-to-start latency) and the
+ * rate at which tasks can be submitted, using 1, 8, and 64 threads that submit
+ * tasks concurrently. It is not built by default (see the Makefile).
+ *
+ * Usage: threadPoolBenchmark [<tasks per producer>]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "ThreadPoolExecutor.h"
+
+using namespace epics::execute;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+  double submitsPerSecond;
+  double meanLatency;
+  double medianLatency;
+  double p99Latency;
+  double maxLatency;
+};
+
+Result runBenchmark(int producers, int tasksPerProducer) {
+  ThreadPoolExecutor::Configuration configuration;
+  configuration.minThreads = 4;
+  configuration.maxThreads = 16;
+  configuration.maxQueueSize = 1024;
+  configuration.rejectionPolicy = ThreadPoolExecutor::RejectionPolicy::block;
+  configuration.idleTimeout = std::chrono::seconds(10);
+  ThreadPoolExecutor executor(configuration);
+  auto totalTasks = static_cast<std::size_t>(producers) * tasksPerProducer;
+  // Each task stores its latency (in nanoseconds) in its own slot, so that
+  // the tasks do not contend on anything but the executor.
+  std::vector<std::int64_t> latencies(totalTasks);
+  std::atomic<std::size_t> completedTasks(0);
+  std::atomic<bool> go(false);
+  std::vector<std::thread> producerThreads;
+  for (int producer = 0; producer < producers; ++producer) {
+    producerThreads.emplace_back([&, producer]() {
+      while (!go.load()) {
+        std::this_thread::yield();
+      }
+      for (int i = 0; i < tasksPerProducer; ++i) {
+        auto slot = &latencies[static_cast<std::size_t>(producer)
+            * tasksPerProducer + i];
+        auto submitTime = Clock::now();
+        executor.submit([slot, submitTime, &completedTasks]() {
+          *slot = std::chrono::duration_cast<std::chrono::nanoseconds>(
+              Clock::now() - submitTime).count();
+          completedTasks.fetch_add(1, std::memory_order_release);
+        });
+      }
+    });
+  }
+  auto startTime = Clock::now();
+  go.store(true);
+  for (auto &thread : producerThreads) {
+    thread.join();
+  }
+  auto submitDuration = std::chrono::duration<double>(
+      Clock::now() - startTime).count();
+  while (completedTasks.load(std::memory_order_acquire) != totalTasks) {
+    std::this_thread::yield();
+  }
+  std::sort(latencies.begin(), latencies.end());
+  double sum = 0.0;
+  for (auto latency : latencies) {
+    sum += latency;
+  }
+  Result result;
+  result.submitsPerSecond = totalTasks / submitDuration;
+  result.meanLatency = sum / totalTasks / 1000.0;
+  result.medianLatency = latencies[totalTasks / 2] / 1000.0;
+  result.p99Latency = latencies[totalTasks * 99 / 100] / 1000.0;
+  result.maxLatency = latencies.back() / 1000.0;
+  return result;
+}
+
+} // anonymous namespace
+
+int main(int argc, char **argv) {
+  int tasksPerProducer = 20000;
+  if (argc > 1) {
+    tasksPerProducer = std::atoi(argv[1]);
+  }
+  if (tasksPerProducer < 1) {
+    std::fprintf(stderr, "Usage: %s [<tasks per producer>]\n", argv[0]);
+    return 1;
+  }
+  std::printf("%9s %14s %12s %12s %12s %12s\n", "producers", "submits/s",
+      "mean [us]", "median [us]", "p99 [us]", "max [us]");
+  for (int producers : {1, 8, 64}) {
+    auto result = runBenchmark(producers, tasksPerProducer);
+    std::printf("%9d %14.0f %12.2f %12.2f %12.2f %12.2f\n", producers,
+        result.submitsPerSecond, result.meanLatency, result.medianLatency,
+        result.p99Latency, result.maxLatency);
+  }
+  return 0;
+}
@@ -0,0 +1,38 @@
+#!../../bin/linux-x86_64/executeLoadTest
+
+# Startup script for the load-test IOC. This IOC is only built when running
+# "make EXECUTE_BUILD_BENCHMARKS=YES". See the section "Load-testing an IOC"
+# in README.md for details.
+
+< envPaths
+
+cd "${TOP}"
+
+# The load test only uses the loopback interface.
+epicsEnvSet("EPICS_CAS_INTF_ADDR_LIST", "127.0.0.1")
+epicsEnvSet("EPICS_CAS_AUTO_BEACON_ADDR_LIST", "NO")
+epicsEnvSet("EPICS_CAS_BEACON_ADDR_LIST", "127.0.0.1")
+epicsEnvSet("EPICS_CA_AUTO_ADDR_LIST", "NO")
+epicsEnvSet("EPICS_CA_ADDR_LIST", "127.0.0.1")
+
+# Parameters of the load test. Each of the COMMANDS commands is triggered once
+# per SCAN period and gets PARAMETERS arguments.
+epicsEnvSet("P", "ExecLoad:")
+epicsEnvSet("COMMANDS", "10")
+epicsEnvSet("PARAMETERS", "4")
+epicsEnvSet("SCAN", ".1 second")
+epicsEnvSet("PROGRAM", "/bin/echo")
+epicsEnvSet("MAX_LATENCY", "100")
+epicsEnvSet("BINS", "100")
+
+dbLoadDatabase "dbd/executeLoadTest.dbd"
+executeLoadTest_registerRecordDeviceDriver pdbbase
+
+executeLoadTestCreate("$(P)", $(COMMANDS), $(PARAMETERS), "$(SCAN)", "$(PROGRAM)", "MAX_LATENCY=$(MAX_LATENCY),BINS=$(BINS)")
+dbLoadRecords("db/executeLoadTest.template", "P=$(P)")
+
+cd "${TOP}/iocBoot/iocExecuteLoadTest"
+iocInit
+
+# Start the load test right away.
+dbpf "$(P)Enable" 1